@@ -0,0 +1,9 @@
+#version 100
+
+precision mediump float;
+
+uniform sampler2D panel_texture;
+
+varying vec2 fragment_uv;
+
+void main() { gl_FragColor = texture2D(panel_texture, fragment_uv); }
@@ -0,0 +1,13 @@
+#version 100
+
+attribute vec2 position;
+
+varying vec2 fragment_uv;
+
+void main()
+{
+    // The quad covers the whole viewport, so its corners are the corners
+    // of the texture too.
+    fragment_uv = position * 0.5 + 0.5;
+    gl_Position = vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 100
+
+precision mediump float;
+
+uniform sampler2D sprite_texture;
+
+varying vec2 fragment_uv;
+varying vec4 fragment_tint;
+
+void main()
+{
+    gl_FragColor = texture2D(sprite_texture, fragment_uv) * fragment_tint;
+}
@@ -0,0 +1,21 @@
+#version 100
+
+attribute vec2 position;
+attribute vec2 uv;
+attribute vec4 tint;
+
+// The size of the panel being drawn to, in pixels.
+uniform vec2 viewport;
+
+varying vec2 fragment_uv;
+varying vec4 fragment_tint;
+
+void main()
+{
+    fragment_uv = uv;
+    fragment_tint = tint;
+
+    // Sprites are positioned in pixels from the top-left of the panel.
+    vec2 normalized = position / viewport * 2.0 - 1.0;
+    gl_Position = vec4(normalized.x, -normalized.y, 0.0, 1.0);
+}
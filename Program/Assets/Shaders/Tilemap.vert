@@ -0,0 +1,23 @@
+#version 100
+
+attribute vec2 position;
+attribute vec2 uv;
+attribute vec4 tint;
+
+// The size of the panel being drawn to, in pixels.
+uniform vec2 viewport;
+// Where the chunk's top-left corner sits within the panel, in pixels.
+uniform vec2 offset;
+
+varying vec2 fragment_uv;
+varying vec4 fragment_tint;
+
+void main()
+{
+    fragment_uv = uv;
+    fragment_tint = tint;
+
+    // Chunk vertices are positioned in pixels from the chunk's top-left.
+    vec2 normalized = (position + offset) / viewport * 2.0 - 1.0;
+    gl_Position = vec4(normalized.x, -normalized.y, 0.0, 1.0);
+}
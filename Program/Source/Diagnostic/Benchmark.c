@@ -0,0 +1,275 @@
+#include "Benchmark.h"
+#include "Time.h"             // Benchmark timing
+#include <Memory/Array.h>     // Array containers
+#include <Memory/Fill.h>      // Fill kernels
+#include <Output/Messages.h>  // Result reporting
+#include <Rendering/Atlas.h>  // Atlas packer
+#include <Rendering/Sprite.h> // Sprite batcher
+#include <stdlib.h>
+
+/**
+ * @brief A stand-in for a small game object, about the size of what a
+ * typical entity or sprite record would be.
+ */
+typedef struct
+{
+    float position[2];
+    float velocity[2];
+    uint32_t sprite;
+    uint32_t flags;
+    uint64_t padding;
+} benchmark_entity_t;
+
+/**
+ * @brief Somewhere to write results so the compiler can't throw away the
+ * work that produced them.
+ */
+static volatile float benchmark_sink = 0;
+
+/**
+ * @brief Report a single benchmark's timing.
+ * @param name The name of the benchmark.
+ * @param time The total time taken in nanoseconds.
+ * @param count The amount of operations the time covers.
+ */
+static void ReportBenchmark(const char* name, uint64_t time, size_t count)
+{
+    ReportMessage("benchmark %-28s %10lu us total, %7.2f ns per op", name,
+                  time / 1000, (double)time / count);
+}
+
+/**
+ * @brief Compare pushing onto and walking over the pointer-based array and
+ * the flat array.
+ */
+static void BenchmarkArrays(void)
+{
+    benchmark_entity_t entity = {{1, 2}, {0.5f, 0.25f}, 0, 0, 0};
+
+    // The pointer-based array is given all of its slots up front, since
+    // growing it one slot at a time raises a warning per push. Even so,
+    // every push is its own allocation.
+    uint64_t start = GetCurrentTimeNS();
+    array_t array = CreateArray(BENCHMARK_ELEMENT_COUNT);
+    for (size_t i = 0; i < BENCHMARK_ELEMENT_COUNT; i++)
+    {
+        entity.sprite = i;
+        AddArrayValueRaw(&array, &entity, sizeof(entity));
+    }
+    ReportBenchmark("array_t push", GetCurrentTimeNS() - start,
+                    BENCHMARK_ELEMENT_COUNT);
+
+    start = GetCurrentTimeNS();
+    float sum = 0;
+    for (size_t i = 0; i < array.occupied; i++)
+    {
+        benchmark_entity_t* value = GetArrayValue(array, i)->_p;
+        sum += value->position[0] + value->velocity[0];
+    }
+    ReportBenchmark("array_t walk", GetCurrentTimeNS() - start,
+                    BENCHMARK_ELEMENT_COUNT);
+    benchmark_sink = sum;
+
+    start = GetCurrentTimeNS();
+    DestroyArray(&array);
+    ReportBenchmark("array_t destroy", GetCurrentTimeNS() - start,
+                    BENCHMARK_ELEMENT_COUNT);
+
+    // The flat array starts empty and grows as it goes.
+    start = GetCurrentTimeNS();
+    flat_array_t flat_array = CreateFlatArray(sizeof(entity), 0);
+    for (size_t i = 0; i < BENCHMARK_ELEMENT_COUNT; i++)
+    {
+        entity.sprite = i;
+        AddFlatArrayValue(&flat_array, &entity);
+    }
+    ReportBenchmark("flat_array_t push", GetCurrentTimeNS() - start,
+                    BENCHMARK_ELEMENT_COUNT);
+
+    start = GetCurrentTimeNS();
+    sum = 0;
+    for (size_t i = 0; i < flat_array.occupied; i++)
+    {
+        benchmark_entity_t* value = GetFlatArrayValue(flat_array, i);
+        sum += value->position[0] + value->velocity[0];
+    }
+    ReportBenchmark("flat_array_t walk", GetCurrentTimeNS() - start,
+                    BENCHMARK_ELEMENT_COUNT);
+    benchmark_sink = sum;
+
+    start = GetCurrentTimeNS();
+    while (flat_array.occupied > 0) RemoveFlatArrayValue(&flat_array, 0);
+    ReportBenchmark("flat_array_t swap-remove", GetCurrentTimeNS() - start,
+                    BENCHMARK_ELEMENT_COUNT);
+
+    // Bulk appending the contents of one array onto another grows it once.
+    flat_array_t source = CreateFlatArray(sizeof(entity), 0);
+    for (size_t i = 0; i < BENCHMARK_ELEMENT_COUNT; i++)
+        AddFlatArrayValue(&source, &entity);
+    start = GetCurrentTimeNS();
+    AppendFlatArrayValues(&flat_array, source._a._p, source.occupied);
+    ReportBenchmark("flat_array_t bulk append", GetCurrentTimeNS() - start,
+                    BENCHMARK_ELEMENT_COUNT);
+
+    DestroyFlatArray(&source);
+    DestroyFlatArray(&flat_array);
+}
+
+/**
+ * @brief Report a single benchmark's throughput.
+ * @param name The name of the benchmark.
+ * @param variant The kernel variant the benchmark ran with.
+ * @param time The total time taken in nanoseconds.
+ * @param bytes The amount of bytes written over that time.
+ */
+static void ReportThroughput(const char* name, fill_variant_t variant,
+                             uint64_t time, size_t bytes)
+{
+    ReportMessage("benchmark %-14s %-8s %7.2f GB/s", name,
+                  GetFillVariantName(variant), (double)bytes / time);
+}
+
+/**
+ * @brief Measure every supported fill kernel variant clearing, filling a
+ * rectangle within, and copying a 4K XRGB8888 frame.
+ */
+static void BenchmarkFills(void)
+{
+    const size_t frame_size = BENCHMARK_FRAME_WIDTH *
+                              BENCHMARK_FRAME_HEIGHT * sizeof(uint32_t);
+    ptr_t frame = AllocateBlock(frame_size);
+    ptr_t copy = AllocateBlock(frame_size);
+    // Touch everything once so page faults don't land in the timings.
+    ZeroBlock(&frame), ZeroBlock(&copy);
+
+    fill_variant_t default_variant = GetFillVariant();
+    for (fill_variant_t variant = fill_scalar;
+         variant < fill_variant_count; variant++)
+    {
+        if (!SetFillVariant(variant)) continue;
+
+        uint64_t start = GetCurrentTimeNS();
+        for (size_t i = 0; i < BENCHMARK_FRAME_COUNT; i++)
+            FillPixels(frame._p, 0xFF000000 | i,
+                       BENCHMARK_FRAME_WIDTH * BENCHMARK_FRAME_HEIGHT);
+        ReportThroughput("4K clear", variant, GetCurrentTimeNS() - start,
+                         frame_size * BENCHMARK_FRAME_COUNT);
+
+        // A centered 1080p rectangle, which has to be filled row by row.
+        uint8_t* corner = (uint8_t*)frame._p +
+                          (BENCHMARK_FRAME_HEIGHT / 4) *
+                              BENCHMARK_FRAME_WIDTH * 4 +
+                          BENCHMARK_FRAME_WIDTH;
+        start = GetCurrentTimeNS();
+        for (size_t i = 0; i < BENCHMARK_FRAME_COUNT; i++)
+            FillPixelRect(corner, BENCHMARK_FRAME_WIDTH * 4,
+                          BENCHMARK_FRAME_WIDTH / 2,
+                          BENCHMARK_FRAME_HEIGHT / 2, 0xFFFFFFFF);
+        ReportThroughput("1080p rect", variant, GetCurrentTimeNS() - start,
+                         frame_size / 4 * BENCHMARK_FRAME_COUNT);
+
+        start = GetCurrentTimeNS();
+        for (size_t i = 0; i < BENCHMARK_FRAME_COUNT; i++)
+            CopyPixels(copy._p, frame._p, frame_size);
+        ReportThroughput("4K copy", variant, GetCurrentTimeNS() - start,
+                         frame_size * BENCHMARK_FRAME_COUNT);
+    }
+    SetFillVariant(default_variant);
+
+    FreeBlock(&frame);
+    FreeBlock(&copy);
+}
+
+/**
+ * @brief Measure the CPU side of the sprite batcher--sorting the batch and
+ * building its vertices and draw calls--at a few sprite counts. Sprites
+ * are spread randomly over a handful of textures, like they would be over
+ * a handful of atlas pages.
+ */
+static void BenchmarkSprites(void)
+{
+    const size_t sprite_counts[] = {10000, 50000, 100000};
+    for (size_t i = 0; i < sizeof(sprite_counts) / sizeof(size_t); i++)
+    {
+        uint64_t total = 0;
+        srand(1);
+        for (size_t frame = 0; frame < BENCHMARK_SPRITE_FRAMES; frame++)
+        {
+            BeginSpriteBatch(BENCHMARK_FRAME_WIDTH,
+                             BENCHMARK_FRAME_HEIGHT);
+            for (size_t j = 0; j < sprite_counts[i]; j++)
+            {
+                sprite_t sprite = {
+                    .x = rand() % BENCHMARK_FRAME_WIDTH,
+                    .y = rand() % BENCHMARK_FRAME_HEIGHT,
+                    .width = 16,
+                    .height = 16,
+                    .uv = {0, 0, 1, 1},
+                    .tint = 0xFFFFFFFF,
+                    .texture = 1 + rand() % BENCHMARK_SPRITE_TEXTURES};
+                DrawSprite(&sprite);
+            }
+
+            uint64_t start = GetCurrentTimeNS();
+            BuildSpriteBatch();
+            total += GetCurrentTimeNS() - start;
+        }
+
+        ReportMessage("benchmark %6zu sprites: %7.1f us build, %zu draw "
+                      "call(s)",
+                      sprite_counts[i],
+                      total / 1000.0 / BENCHMARK_SPRITE_FRAMES,
+                      GetSpriteDrawCalls());
+    }
+    DestroySpriteBatcher();
+}
+
+/**
+ * @brief Measure packing a startup-sized set of images into the atlas.
+ * The images are generated rather than decoded, so this only covers the
+ * packer and page copies; the atlas reports its own timings.
+ */
+static void BenchmarkAtlas(void)
+{
+    const size_t largest = BENCHMARK_ATLAS_IMAGE_SIZE;
+    ptr_t pixels = AllocateBlock(largest * largest * 4);
+    FillBlock(&pixels, 0xFFFFFFFF, pixels.size);
+
+    srand(1);
+    for (size_t i = 0; i < BENCHMARK_ATLAS_IMAGES; i++)
+        (void)AddAtlasPixels(pixels._p, 8 + rand() % (largest - 7),
+                             8 + rand() % (largest - 7));
+    FreeBlock(&pixels);
+
+    uint64_t start = GetCurrentTimeNS();
+    BuildAtlas();
+    ReportBenchmark("atlas build", GetCurrentTimeNS() - start,
+                    BENCHMARK_ATLAS_IMAGES);
+    DestroyAtlas();
+}
+
+/**
+ * @brief Measure what recording a message costs the thread that logs it.
+ * Formatting and writing happen on the flusher thread, and aren't timed.
+ */
+static void BenchmarkMessages(void)
+{
+    FlushMessages();
+    uint64_t start = GetCurrentTimeNS();
+    for (size_t i = 0; i < BENCHMARK_MESSAGE_COUNT; i++)
+        ReportMessage("benchmark message %zu of %d", i,
+                      BENCHMARK_MESSAGE_COUNT);
+    const uint64_t time = GetCurrentTimeNS() - start;
+
+    FlushMessages();
+    ReportBenchmark("message record", time, BENCHMARK_MESSAGE_COUNT);
+}
+
+void RunBenchmarks(void)
+{
+    BenchmarkArrays();
+    BenchmarkFills();
+    BenchmarkSprites();
+    BenchmarkAtlas();
+    BenchmarkMessages();
+}
@@ -0,0 +1,69 @@
+/**
+ * @file Benchmark.h
+ * @author Israfiel (https://github.com/israfiel-a)
+ * @brief Provides microbenchmarks for the engine's core systems, run when
+ * the application is started with the --benchmark flag.
+ * @date 2024-08-22
+ *
+ * @copyright (c) 2024 - Israfiel
+ */
+
+#ifndef _MSENG_BENCHMARK_DIAGNOSTIC_SYSTEM_
+#define _MSENG_BENCHMARK_DIAGNOSTIC_SYSTEM_
+
+/**
+ * @brief The amount of elements each container benchmark works on.
+ */
+#define BENCHMARK_ELEMENT_COUNT 100000
+
+/**
+ * @brief The width of the frame the fill benchmarks work on, in pixels.
+ */
+#define BENCHMARK_FRAME_WIDTH 3840
+
+/**
+ * @brief The height of the frame the fill benchmarks work on, in pixels.
+ */
+#define BENCHMARK_FRAME_HEIGHT 2160
+
+/**
+ * @brief The amount of times each fill benchmark is repeated.
+ */
+#define BENCHMARK_FRAME_COUNT 50
+
+/**
+ * @brief The amount of frames each sprite benchmark builds.
+ */
+#define BENCHMARK_SPRITE_FRAMES 20
+
+/**
+ * @brief The amount of textures the sprite benchmark spreads its sprites
+ * over.
+ */
+#define BENCHMARK_SPRITE_TEXTURES 4
+
+/**
+ * @brief The amount of images the atlas benchmark packs.
+ */
+#define BENCHMARK_ATLAS_IMAGES 500
+
+/**
+ * @brief The largest the atlas benchmark's images get on either side, in
+ * pixels.
+ */
+#define BENCHMARK_ATLAS_IMAGE_SIZE 128
+
+/**
+ * @brief The amount of messages the logging benchmark records. This has
+ * to stay under @ref MESSAGE_RING_SIZE, or it'd be timing drops.
+ */
+#define BENCHMARK_MESSAGE_COUNT 100
+
+/**
+ * @brief Run every benchmark, reporting the results through the message
+ * interface. This doesn't need a window, and shouldn't be run with one
+ * open, since the rendering thread would skew the timings.
+ */
+void RunBenchmarks(void);
+
+#endif // _MSENG_BENCHMARK_DIAGNOSTIC_SYSTEM_
@@ -0,0 +1,275 @@
+#include "Statistics.h"
+#include "Time.h"            // Window timing
+#include <Memory/Thread.h>   // Contended locks
+#include <Output/Messages.h> // Statistics reporting
+#include <pthread.h>
+#include <string.h>
+
+/**
+ * @brief The values below this are kept exactly, one per bucket.
+ */
+#define HISTOGRAM_EXACT (1u << FRAME_HISTOGRAM_PRECISION)
+
+/**
+ * @brief The buckets in each power of two past @ref HISTOGRAM_EXACT.
+ */
+#define HISTOGRAM_HALF (HISTOGRAM_EXACT / 2)
+
+/**
+ * @brief The amount of buckets in a histogram, enough for any frame time
+ * in microseconds that fits in 32 bits.
+ */
+#define HISTOGRAM_BUCKETS                                                 \
+    (HISTOGRAM_EXACT + (32 - FRAME_HISTOGRAM_PRECISION) * HISTOGRAM_HALF)
+
+/**
+ * @brief A histogram of frame times in microseconds, with buckets that
+ * grow with the value so every bucket is the same relative width.
+ */
+typedef struct
+{
+    uint32_t counts[HISTOGRAM_BUCKETS];
+    size_t total;
+} frame_histogram_t;
+
+/**
+ * @brief A recent frame.
+ */
+typedef struct
+{
+    uint64_t end;
+    uint64_t duration;
+    bool hitch;
+} frame_record_t;
+
+/**
+ * @brief The recent frames, and the amount ever recorded. The newest is
+ * at (count - 1) % @ref FRAME_HISTORY_SIZE.
+ */
+static frame_record_t frame_history[FRAME_HISTORY_SIZE];
+static size_t frame_history_count = 0;
+
+/**
+ * @brief The whole run's frames, alongside what the histogram can't hold
+ * exactly.
+ */
+static frame_histogram_t run_histogram;
+static uint64_t run_total = 0, run_worst = 0;
+static size_t run_hitches = 0;
+
+/**
+ * @brief The running average frame time hitches are measured against, or
+ * 0 before the first frame.
+ */
+static uint64_t running_average = 0;
+
+/**
+ * @brief Guards everything above, which is recorded by the rendering
+ * thread and read by anyone.
+ */
+static pthread_mutex_t statistics_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Get the bucket a frame time lands in.
+ * @param value The frame time, in microseconds.
+ * @return The bucket's index.
+ */
+static size_t GetHistogramBucket(uint32_t value)
+{
+    if (value < HISTOGRAM_EXACT) return value;
+
+    const uint32_t shift =
+        31 - __builtin_clz(value) - (FRAME_HISTOGRAM_PRECISION - 1);
+    return HISTOGRAM_EXACT + (shift - 1) * HISTOGRAM_HALF +
+           ((value >> shift) - HISTOGRAM_HALF);
+}
+
+/**
+ * @brief Get the highest frame time that lands in a bucket.
+ * @param bucket The bucket's index.
+ * @return The frame time, in nanoseconds.
+ */
+static uint64_t GetHistogramValue(size_t bucket)
+{
+    if (bucket < HISTOGRAM_EXACT) return (uint64_t)bucket * 1000;
+
+    const size_t shift = (bucket - HISTOGRAM_EXACT) / HISTOGRAM_HALF + 1;
+    const uint64_t top =
+        (bucket - HISTOGRAM_EXACT) % HISTOGRAM_HALF + HISTOGRAM_HALF;
+    return (((top + 1) << shift) - 1) * 1000;
+}
+
+/**
+ * @brief Add a frame time to a histogram.
+ * @param histogram The histogram.
+ * @param duration The frame time, in nanoseconds.
+ */
+static void AddHistogramValue(frame_histogram_t* histogram,
+                              uint64_t duration)
+{
+    const uint64_t value = duration / 1000;
+    histogram->counts[GetHistogramBucket(
+        value > UINT32_MAX ? UINT32_MAX : (uint32_t)value)]++;
+    histogram->total++;
+}
+
+/**
+ * @brief Find a percentile in a histogram.
+ * @param histogram The histogram.
+ * @param percentile The percentile, from 0 to 100.
+ * @return The highest frame time in the bucket the percentile lands in,
+ * in nanoseconds.
+ */
+static uint64_t GetHistogramPercentile(const frame_histogram_t* histogram,
+                                       double percentile)
+{
+    if (histogram->total == 0) return 0;
+
+    size_t rank = (size_t)(percentile / 100.0 * histogram->total + 0.5);
+    if (rank == 0) rank = 1;
+    if (rank > histogram->total) rank = histogram->total;
+
+    size_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += histogram->counts[i];
+        if (seen >= rank) return GetHistogramValue(i);
+    }
+    return GetHistogramValue(HISTOGRAM_BUCKETS - 1);
+}
+
+void RecordFrameTime(uint64_t end, uint64_t duration)
+{
+    LockMutex(&statistics_mutex, "statistics lock");
+    const bool hitch =
+        running_average != 0 &&
+        duration > running_average * FRAME_HITCH_FACTOR;
+    // Hitches are left out of the average, so a run of them doesn't
+    // raise the bar and hide the ones after.
+    if (running_average == 0) running_average = duration;
+    else if (!hitch)
+        running_average = running_average -
+                          running_average / FRAME_AVERAGE_WEIGHT +
+                          duration / FRAME_AVERAGE_WEIGHT;
+
+    frame_history[frame_history_count++ % FRAME_HISTORY_SIZE] =
+        (frame_record_t){end, duration, hitch};
+    AddHistogramValue(&run_histogram, duration);
+    run_total += duration;
+    if (duration > run_worst) run_worst = duration;
+    if (hitch) run_hitches++;
+    pthread_mutex_unlock(&statistics_mutex);
+}
+
+/**
+ * @brief A histogram of just the frames within a window, rebuilt for every
+ * query that asks for one. This is guarded by the statistics mutex, and
+ * kept here since it's too big to want on every caller's stack.
+ */
+static frame_histogram_t window_histogram;
+
+/**
+ * @brief Gather the recent frames within a window into @ref
+ * window_histogram. This must be called with the statistics mutex held.
+ * @param window How far back to look, in nanoseconds.
+ * @param statistics Where to write everything but the percentiles.
+ */
+static void GatherRecentFrames(uint64_t window,
+                               frame_statistics_t* statistics)
+{
+    memset(&window_histogram, 0, sizeof(frame_histogram_t));
+    const uint64_t now = GetCurrentTimeNS();
+    const size_t kept = frame_history_count < FRAME_HISTORY_SIZE
+                            ? frame_history_count
+                            : FRAME_HISTORY_SIZE;
+
+    uint64_t total = 0;
+    // Newest first, so we can stop at the first frame outside the window.
+    for (size_t i = 0; i < kept; i++)
+    {
+        const frame_record_t* record =
+            &frame_history[(frame_history_count - 1 - i) %
+                           FRAME_HISTORY_SIZE];
+        if (now - record->end > window) break;
+
+        AddHistogramValue(&window_histogram, record->duration);
+        total += record->duration;
+        if (record->duration > statistics->worst)
+            statistics->worst = record->duration;
+        if (record->hitch) statistics->hitches++;
+    }
+
+    statistics->frames = window_histogram.total;
+    if (window_histogram.total != 0)
+        statistics->average = total / window_histogram.total;
+}
+
+/**
+ * @brief Summarize everything but the percentiles of a stretch of frames.
+ * This must be called with the statistics mutex held.
+ * @param window How far back to look, in nanoseconds, or 0 for the whole
+ * run.
+ * @param statistics Where to write the summary.
+ * @return The histogram to take the percentiles from.
+ */
+static const frame_histogram_t*
+SummarizeFrames(uint64_t window, frame_statistics_t* statistics)
+{
+    *statistics = (frame_statistics_t){0};
+    if (window != 0)
+    {
+        GatherRecentFrames(window, statistics);
+        return &window_histogram;
+    }
+
+    statistics->frames = run_histogram.total;
+    statistics->hitches = run_hitches;
+    statistics->worst = run_worst;
+    if (run_histogram.total != 0)
+        statistics->average = run_total / run_histogram.total;
+    return &run_histogram;
+}
+
+bool GetFrameStatistics(uint64_t window, frame_statistics_t* statistics)
+{
+    LockMutex(&statistics_mutex, "statistics lock");
+    const frame_histogram_t* histogram =
+        SummarizeFrames(window, statistics);
+    statistics->p50 = GetHistogramPercentile(histogram, 50.0);
+    statistics->p95 = GetHistogramPercentile(histogram, 95.0);
+    statistics->p99 = GetHistogramPercentile(histogram, 99.0);
+    pthread_mutex_unlock(&statistics_mutex);
+
+    // A bucket's top can be past the worst frame that landed in it.
+    if (statistics->p50 > statistics->worst)
+        statistics->p50 = statistics->worst;
+    if (statistics->p95 > statistics->worst)
+        statistics->p95 = statistics->worst;
+    if (statistics->p99 > statistics->worst)
+        statistics->p99 = statistics->worst;
+    return statistics->frames != 0;
+}
+
+uint64_t GetFramePercentile(uint64_t window, double percentile)
+{
+    frame_statistics_t statistics;
+    LockMutex(&statistics_mutex, "statistics lock");
+    const uint64_t value = GetHistogramPercentile(
+        SummarizeFrames(window, &statistics), percentile);
+    pthread_mutex_unlock(&statistics_mutex);
+
+    return value > statistics.worst ? statistics.worst : value;
+}
+
+void ReportFrameStatistics(void)
+{
+    frame_statistics_t statistics;
+    if (!GetFrameStatistics(0, &statistics)) return;
+
+    ReportMessage("frame times: %.1f us p50, %.1f us p95, %.1f us p99, "
+                  "%.1f us worst",
+                  statistics.p50 / 1000.0, statistics.p95 / 1000.0,
+                  statistics.p99 / 1000.0, statistics.worst / 1000.0);
+    ReportMessage("%zu hitch(es) in %zu frame(s)", statistics.hitches,
+                  statistics.frames);
+}
@@ -0,0 +1,99 @@
+/**
+ * @file Statistics.h
+ * @author Israfiel (https://github.com/israfiel-a)
+ * @brief Provides rolling frame time statistics. The rendering thread
+ * records how long every frame took to draw, which is kept both in a ring
+ * of recent frames, for questions about the last few seconds, and in a
+ * histogram of the whole run. Nothing here allocates, so it's safe to ask
+ * for statistics every frame.
+ * @date 2024-09-01
+ *
+ * @copyright (c) 2024 - Israfiel
+ */
+
+#ifndef _MSENG_STATISTICS_DIAGNOSTIC_SYSTEM_
+#define _MSENG_STATISTICS_DIAGNOSTIC_SYSTEM_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The amount of recent frames kept. Statistics over a window of
+ * time only see this many frames, however long the window.
+ */
+#define FRAME_HISTORY_SIZE 1024
+
+/**
+ * @brief The bits of precision the histogram keeps. A frame time lands in
+ * a bucket within one part in 2 ^ (this - 1) of it, about 1.6%.
+ */
+#define FRAME_HISTOGRAM_PRECISION 7
+
+/**
+ * @brief How many times longer than the running average a frame has to
+ * take to count as a hitch.
+ */
+#define FRAME_HITCH_FACTOR 2
+
+/**
+ * @brief How heavily the running average weighs each new frame, as one
+ * over this.
+ */
+#define FRAME_AVERAGE_WEIGHT 32
+
+/**
+ * @brief A summary of a stretch of frames. All times are in nanoseconds.
+ */
+typedef struct
+{
+    size_t frames;
+    /**
+     * @brief How many of the frames were hitches; see @ref
+     * FRAME_HITCH_FACTOR.
+     */
+    size_t hitches;
+    uint64_t average;
+    uint64_t p50;
+    uint64_t p95;
+    uint64_t p99;
+    /**
+     * @brief The longest frame. Unlike the percentiles, this is exact.
+     */
+    uint64_t worst;
+} frame_statistics_t;
+
+/**
+ * @brief Record a drawn frame. This must only be called by the rendering
+ * thread.
+ * @param end When the frame finished, as given by @ref GetCurrentTimeNS.
+ * @param duration How long the frame took to draw.
+ */
+void RecordFrameTime(uint64_t end, uint64_t duration);
+
+/**
+ * @brief Summarize recent frames. This is safe to call from any thread.
+ * @param window How far back to look, in nanoseconds, or 0 for the whole
+ * run.
+ * @param statistics Where to write the summary.
+ * @return true There were frames to summarize.
+ * @return false There weren't, and the summary is all 0.
+ */
+bool GetFrameStatistics(uint64_t window, frame_statistics_t* statistics);
+
+/**
+ * @brief Get a single percentile of recent frame times. This is safe to
+ * call from any thread.
+ * @param window How far back to look, in nanoseconds, or 0 for the whole
+ * run.
+ * @param percentile The percentile, from 0 to 100.
+ * @return The frame time, in nanoseconds, or 0 if there were no frames.
+ */
+uint64_t GetFramePercentile(uint64_t window, double percentile);
+
+/**
+ * @brief Report the frame time percentiles and hitches of the whole run.
+ */
+void ReportFrameStatistics(void);
+
+#endif // _MSENG_STATISTICS_DIAGNOSTIC_SYSTEM_
@@ -1,34 +1,113 @@
 #include "Time.h"
-#include <Output/Error.h> // Error reporting functionality
+#include <Memory/Allocate.h> // Zone buffer allocation
+#include <Output/Error.h>    // Error reporting functionality
+#include <Output/Messages.h> // Zone reporting
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdio.h>
 
-static uint64_t start_time = 0;
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>     // Invariant timestamp counter check
+#include <x86intrin.h> // Timestamp counter reads
+#define TIME_X86
+#endif
+
+/**
+ * @brief When @ref GetCurrentTime was first called, in nanoseconds.
+ */
+static atomic_uint_least64_t start_time = 0;
+
+/**
+ * @brief Makes sure the precise clock is only calibrated once.
+ */
+static pthread_once_t calibration_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief The nanoseconds in one tick of the timestamp counter, or 0 if the
+ * counter isn't used. Alongside it, a counter reading and the monotonic
+ * time it was taken at, which every other reading is measured from.
+ */
+static double tick_length = 0;
+static uint64_t base_ticks = 0, base_time = 0;
+
+/**
+ * @brief A single thread's zones.
+ */
+typedef struct zone_buffer
+{
+    zone_t zones[ZONE_BUFFER_SIZE];
+    /**
+     * @brief The amount of zones ever finished on the thread. Only the
+     * last @ref ZONE_BUFFER_SIZE of them are kept.
+     */
+    atomic_size_t count;
+    uint32_t thread;
+    const char* name;
+    /**
+     * @brief How many zones are currently open, and their names and
+     * starting times. This can go past @ref ZONE_DEPTH_LIMIT, but only
+     * the zones within it are kept.
+     */
+    uint32_t depth;
+    const char* open_names[ZONE_DEPTH_LIMIT];
+    uint64_t open_starts[ZONE_DEPTH_LIMIT];
+    struct zone_buffer* next;
+} zone_buffer_t;
+
+/**
+ * @brief The calling thread's zones, or NULL if it's never begun one.
+ */
+static _Thread_local zone_buffer_t* thread_zones = NULL;
+
+/**
+ * @brief Every thread's zones, newest thread first. Buffers are never
+ * freed, so a thread's zones can still be read after it's gone.
+ */
+static zone_buffer_t* zone_buffers = NULL;
+static uint32_t zone_thread_count = 0;
+static pthread_mutex_t zone_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 uint64_t GetCurrentTime(void)
 {
-    // On Linux, clock_gettime(MONO) reports seconds since system booted,
-    // so we just multiply it by a thousand to get milliseconds.
+    const uint64_t now = GetCurrentTimeNS();
+    uint_least64_t expected = 0;
+    if (atomic_compare_exchange_strong(&start_time, &expected, now))
+        return 0;
+    return NSEC_TO_MSEC(now - expected);
+}
+
+uint64_t GetCurrentTimeNS(void)
+{
     struct timespec retrieved_time;
     int time_get_return = clock_gettime(CLOCK_MONOTONIC, &retrieved_time);
     if (time_get_return == -1) ReportError(time_get_failure);
 
-    if (start_time == 0)
-    {
-        start_time = NSEC_TO_MSEC(retrieved_time.tv_nsec);
-        return 0;
-    }
-    return NSEC_TO_MSEC(retrieved_time.tv_nsec) - start_time;
+    return (uint64_t)retrieved_time.tv_sec * 1000000000 +
+           retrieved_time.tv_nsec;
+}
+
+uint64_t GetCoarseTimeNS(void)
+{
+    struct timespec retrieved_time;
+    int time_get_return =
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &retrieved_time);
+    if (time_get_return == -1) ReportError(time_get_failure);
+
+    return (uint64_t)retrieved_time.tv_sec * 1000000000 +
+           retrieved_time.tv_nsec;
 }
 
 void GetTimeString(char* buffer, size_t buffer_length)
 {
-    if (buffer_length < 13)
-    {
-        buffer = NULL;
-        return;
-    }
+    FormatTimeString(GetCurrentTime(), buffer, buffer_length);
+}
+
+void FormatTimeString(uint64_t time, char* buffer, size_t buffer_length)
+{
+    if (buffer_length < 13) return;
 
-    uint64_t ms = GetCurrentTime(), s = 0, m = 0;
+    uint64_t ms = time, s = 0, m = 0;
     if (ms >= 1000)
     {
         s = ms / 1000;
@@ -42,3 +121,190 @@ void GetTimeString(char* buffer, size_t buffer_length)
 
     snprintf(buffer, buffer_length, "%03lu::%02lu::%03lu", ms, s, m);
 }
+
+/**
+ * @brief Measure the timestamp counter against the monotonic clock. The
+ * counter is only used if the processor says it ticks at a constant rate
+ * no matter the power state, and in step on every core.
+ */
+static void CalibrateTimestampCounter(void)
+{
+#ifdef TIME_X86
+    uint32_t eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) ||
+        !(edx & (1 << 8)))
+        return;
+
+    const uint64_t first_time = GetCurrentTimeNS();
+    const uint64_t first_ticks = __rdtsc();
+    const struct timespec wait = {0, CLOCK_CALIBRATION_TIME};
+    nanosleep(&wait, NULL);
+    const uint64_t last_time = GetCurrentTimeNS();
+    const uint64_t last_ticks = __rdtsc();
+    if (last_ticks <= first_ticks) return;
+
+    base_ticks = last_ticks;
+    base_time = last_time;
+    tick_length =
+        (double)(last_time - first_time) / (last_ticks - first_ticks);
+#endif
+}
+
+void CalibratePreciseClock(void)
+{
+    pthread_once(&calibration_once, CalibrateTimestampCounter);
+}
+
+uint64_t GetPreciseTimeNS(void)
+{
+    pthread_once(&calibration_once, CalibrateTimestampCounter);
+#ifdef TIME_X86
+    if (tick_length != 0)
+        return base_time +
+               (int64_t)((int64_t)(__rdtsc() - base_ticks) * tick_length);
+#endif
+    return GetCurrentTimeNS();
+}
+
+const char* GetPreciseClockSource(void)
+{
+    pthread_once(&calibration_once, CalibrateTimestampCounter);
+    return tick_length != 0 ? "tsc" : "monotonic";
+}
+
+/**
+ * @brief Get the calling thread's zones, making and registering them the
+ * first time.
+ * @return The thread's zones.
+ */
+static zone_buffer_t* GetThreadZones(void)
+{
+    if (thread_zones != NULL) return thread_zones;
+
+    zone_buffer_t* buffer =
+        AllocateZeroedBlock(sizeof(zone_buffer_t))._p;
+    pthread_mutex_lock(&zone_mutex);
+    buffer->thread = zone_thread_count++;
+    buffer->next = zone_buffers;
+    zone_buffers = buffer;
+    pthread_mutex_unlock(&zone_mutex);
+
+    thread_zones = buffer;
+    return buffer;
+}
+
+void SetZoneThreadName_(const char* name)
+{
+    zone_buffer_t* buffer = GetThreadZones();
+    pthread_mutex_lock(&zone_mutex);
+    buffer->name = name;
+    pthread_mutex_unlock(&zone_mutex);
+}
+
+void BeginZone_(const char* name)
+{
+    zone_buffer_t* buffer = GetThreadZones();
+    if (buffer->depth < ZONE_DEPTH_LIMIT)
+    {
+        buffer->open_names[buffer->depth] = name;
+        buffer->open_starts[buffer->depth] = GetPreciseTimeNS();
+    }
+    buffer->depth++;
+}
+
+void EndZone_(void)
+{
+    const uint64_t end = GetPreciseTimeNS();
+    zone_buffer_t* buffer = thread_zones;
+    if (buffer == NULL || buffer->depth == 0) return;
+
+    const uint32_t depth = --buffer->depth;
+    if (depth >= ZONE_DEPTH_LIMIT) return;
+
+    const size_t count =
+        atomic_load_explicit(&buffer->count, memory_order_relaxed);
+    buffer->zones[count % ZONE_BUFFER_SIZE] = (zone_t){
+        buffer->open_names[depth], buffer->open_starts[depth],
+        end - buffer->open_starts[depth], depth, buffer->thread};
+    atomic_store_explicit(&buffer->count, count + 1,
+                          memory_order_release);
+}
+
+void IterateZoneThreads(void (*func)(uint32_t thread, const char* name,
+                                     void* data),
+                        void* data)
+{
+    pthread_mutex_lock(&zone_mutex);
+    for (zone_buffer_t* buffer = zone_buffers; buffer != NULL;
+         buffer = buffer->next)
+        func(buffer->thread, buffer->name, data);
+    pthread_mutex_unlock(&zone_mutex);
+}
+
+void IterateZones(void (*func)(const zone_t* zone, void* data),
+                  void* data)
+{
+    pthread_mutex_lock(&zone_mutex);
+    for (zone_buffer_t* buffer = zone_buffers; buffer != NULL;
+         buffer = buffer->next)
+    {
+        const size_t count =
+            atomic_load_explicit(&buffer->count, memory_order_acquire);
+        const size_t first =
+            count > ZONE_BUFFER_SIZE ? count - ZONE_BUFFER_SIZE : 0;
+        for (size_t i = first; i < count; i++)
+            func(&buffer->zones[i % ZONE_BUFFER_SIZE], data);
+    }
+    pthread_mutex_unlock(&zone_mutex);
+}
+
+/**
+ * @brief The totals of every zone sharing one name.
+ */
+typedef struct
+{
+    const char* name;
+    uint64_t count;
+    uint64_t total;
+    uint64_t longest;
+} zone_totals_t;
+
+/**
+ * @brief Add a zone to the totals of its name, for @ref
+ * ReportZoneStatistics.
+ * @param zone The zone.
+ * @param data The totals, @ref ZONE_NAME_LIMIT long and ended by the first
+ * entry without a name.
+ */
+static void AddZoneTotals(const zone_t* zone, void* data)
+{
+    zone_totals_t* totals = data;
+    size_t i = 0;
+    // Names are compared by address; they're all literals.
+    while (i < ZONE_NAME_LIMIT && totals[i].name != NULL &&
+           totals[i].name != zone->name)
+        i++;
+    if (i == ZONE_NAME_LIMIT) return;
+
+    totals[i].name = zone->name;
+    totals[i].count++;
+    totals[i].total += zone->duration;
+    if (zone->duration > totals[i].longest)
+        totals[i].longest = zone->duration;
+}
+
+void ReportZoneStatistics(void)
+{
+    zone_totals_t totals[ZONE_NAME_LIMIT] = {0};
+    IterateZones(AddZoneTotals, totals);
+    if (totals[0].name == NULL) return;
+
+    ReportMessage("zones timed with the %s clock",
+                  GetPreciseClockSource());
+    for (size_t i = 0; i < ZONE_NAME_LIMIT && totals[i].name != NULL; i++)
+        ReportMessage("zone %-24s %8lu time(s), %9.1f us average, %9.1f "
+                      "us longest",
+                      totals[i].name, totals[i].count,
+                      totals[i].total / 1000.0 / totals[i].count,
+                      totals[i].longest / 1000.0);
+}
@@ -12,13 +12,85 @@
 #define _MSENG_TIME_DIAGNOSTIC_SYSTEM_
 
 #include <inttypes.h>
+#include <stddef.h>
 #include <time.h>
 
 /**
  * @brief A simple macro to convert nanoseconds to milliseconds. This is
  * literally just a division by 1000000.
  */
-#define NSEC_TO_MSEC(value) (uint64_t) value / 1000000
+#define NSEC_TO_MSEC(value) ((uint64_t)(value) / 1000000)
+
+/**
+ * @brief How long, in nanoseconds, the timestamp counter is measured
+ * against the monotonic clock when the precise clock is calibrated.
+ */
+#define CLOCK_CALIBRATION_TIME 10000000
+
+/**
+ * @brief The amount of finished zones each thread keeps. Past this, a
+ * thread's oldest zones are written over. Buffers are zeroed lazily by the
+ * system, so a thread only costs as much memory as it's used.
+ */
+#define ZONE_BUFFER_SIZE 65536
+
+/**
+ * @brief The deepest zones can be nested on one thread. Zones nested any
+ * deeper aren't recorded.
+ */
+#define ZONE_DEPTH_LIMIT 32
+
+/**
+ * @brief The most differently named zones @ref ReportZoneStatistics
+ * keeps totals for.
+ */
+#define ZONE_NAME_LIMIT 64
+
+/**
+ * @brief A finished timing zone.
+ */
+typedef struct
+{
+    /**
+     * @brief The name the zone was begun with.
+     */
+    const char* name;
+    /**
+     * @brief When the zone began, as given by @ref GetPreciseTimeNS.
+     */
+    uint64_t start;
+    /**
+     * @brief How long the zone lasted, in nanoseconds.
+     */
+    uint64_t duration;
+    /**
+     * @brief How many zones the zone was nested within.
+     */
+    uint32_t depth;
+    /**
+     * @brief The thread the zone ran on, counting up from 0 in the order
+     * threads first began a zone.
+     */
+    uint32_t thread;
+} zone_t;
+
+/**
+ * @brief Begin a named timing zone on the calling thread. Every begun zone
+ * must be ended by @ref EndZone on the same thread, innermost first. Both
+ * compile down to nothing unless MSENG_ZONES is defined, which it is for
+ * debug builds.
+ * @param name The name of the zone. This must be a string literal, or
+ * otherwise outlive the program, since only its address is kept.
+ */
+#ifdef MSENG_ZONES
+#define BeginZone(name) BeginZone_(name)
+#define EndZone() EndZone_()
+#define SetZoneThreadName(name) SetZoneThreadName_(name)
+#else
+#define BeginZone(name) ((void)0)
+#define EndZone() ((void)0)
+#define SetZoneThreadName(name) ((void)0)
+#endif
 
 /**
  * @brief Get the current time since the start of the application in
@@ -27,6 +99,24 @@
  */
 uint64_t GetCurrentTime(void);
 
+/**
+ * @brief Get the current value of the monotonic clock in nanoseconds.
+ * Unlike @ref GetCurrentTime, this is not relative to the start of the
+ * application, so it's only useful for measuring the distance between two
+ * points in time.
+ * @return The nanosecond representation of the time.
+ */
+uint64_t GetCurrentTimeNS(void);
+
+/**
+ * @brief Get the current value of the coarse monotonic clock in
+ * nanoseconds. This only moves every few milliseconds, but it's a fraction
+ * of the cost of @ref GetCurrentTimeNS, so it suits stamping things that
+ * happen often but don't need to be timed precisely.
+ * @return The nanosecond representation of the time.
+ */
+uint64_t GetCoarseTimeNS(void);
+
 /**
  * @brief Get a string-formatted version of the current time, in the format
  * of ms::s::m.
@@ -37,4 +127,86 @@ uint64_t GetCurrentTime(void);
  */
 void GetTimeString(char* buffer, size_t buffer_length);
 
+/**
+ * @brief Format a time taken earlier by @ref GetCurrentTime the same way
+ * @ref GetTimeString formats the current time.
+ * @param time The time in milliseconds.
+ * @param buffer The buffer to insert the string into. If the length of
+ * this buffer is less than 13, nothing is written.
+ * @param buffer_length The length of the buffer.
+ */
+void FormatTimeString(uint64_t time, char* buffer, size_t buffer_length);
+
+/**
+ * @brief Measure the timestamp counter against the monotonic clock, so
+ * @ref GetPreciseTimeNS can read it. This takes @ref
+ * CLOCK_CALIBRATION_TIME, and only ever happens once; the precise clock
+ * does it itself the first time it's read, but calling this early keeps
+ * that wait off of anything being timed.
+ */
+void CalibratePreciseClock(void);
+
+/**
+ * @brief Get the current time in nanoseconds, on the same scale as @ref
+ * GetCurrentTimeNS. On processors with an invariant timestamp counter,
+ * this reads the counter rather than asking the kernel, which is several
+ * times cheaper.
+ * @return The nanosecond representation of the time.
+ */
+uint64_t GetPreciseTimeNS(void);
+
+/**
+ * @brief Get the name of what @ref GetPreciseTimeNS reads.
+ * @return "tsc" or "monotonic".
+ */
+const char* GetPreciseClockSource(void);
+
+/**
+ * @brief Begin a timing zone. Use @ref BeginZone instead of calling this
+ * directly.
+ * @param name The name of the zone.
+ */
+void BeginZone_(const char* name);
+
+/**
+ * @brief End the innermost timing zone. Use @ref EndZone instead of
+ * calling this directly.
+ */
+void EndZone_(void);
+
+/**
+ * @brief Name the calling thread, for anything that shows its zones. Use
+ * @ref SetZoneThreadName instead of calling this directly, so it compiles
+ * down to nothing along with the zones.
+ * @param name The name, which must outlive the program.
+ */
+void SetZoneThreadName_(const char* name);
+
+/**
+ * @brief Call a function on every thread that's ever begun a zone or been
+ * named.
+ * @param func The function to call, given the thread's number and its
+ * name, or NULL if it was never named.
+ * @param data Passed through to the function untouched.
+ */
+void IterateZoneThreads(void (*func)(uint32_t thread, const char* name,
+                                     void* data),
+                        void* data);
+
+/**
+ * @brief Call a function on every finished zone still kept, thread by
+ * thread and oldest first. Zones finished while this runs may or may not
+ * be seen, so it's best called once the threads being timed are done.
+ * @param func The function to call.
+ * @param data Passed through to the function untouched.
+ */
+void IterateZones(void (*func)(const zone_t* zone, void* data),
+                  void* data);
+
+/**
+ * @brief Report how many times each zone ran, and for how long on average
+ * and at most.
+ */
+void ReportZoneStatistics(void);
+
 #endif // _MSENG_TIME_DIAGNOSTIC_SYSTEM_
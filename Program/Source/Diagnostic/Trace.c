@@ -0,0 +1,140 @@
+#include "Trace.h"
+#include "Time.h" // Zones
+#include <Output/Warning.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Where the trace is written, or NULL if tracing is off.
+ */
+static const char* trace_path = NULL;
+
+/**
+ * @brief The state carried through the zone iterators.
+ */
+typedef struct
+{
+    FILE* file;
+    /**
+     * @brief The earliest zone's start, which every timestamp is made
+     * relative to.
+     */
+    uint64_t origin;
+    /**
+     * @brief Whether an event has been written yet, and so whether the
+     * next one needs a comma before it.
+     */
+    bool written;
+} trace_writer_t;
+
+void EnableTracing(const char* path)
+{
+#ifndef MSENG_ZONES
+    ReportWarning(untimed_trace);
+#endif
+    trace_path = path != NULL ? path : TRACE_DEFAULT_PATH;
+}
+
+bool IsTracing(void) { return trace_path != NULL; }
+
+/**
+ * @brief Write a string as a JSON string, escaping whatever has to be.
+ * @param file The file.
+ * @param string The string.
+ */
+static void WriteTraceString(FILE* file, const char* string)
+{
+    fputc('"', file);
+    for (; *string != '\0'; string++)
+    {
+        if (*string == '"' || *string == '\\') fputc('\\', file);
+        if ((unsigned char)*string >= 0x20) fputc(*string, file);
+    }
+    fputc('"', file);
+}
+
+/**
+ * @brief Start an event, putting a comma between it and the last one.
+ * @param writer The writer.
+ */
+static void BeginTraceEvent(trace_writer_t* writer)
+{
+    fputs(writer->written ? ",\n" : "\n", writer->file);
+    writer->written = true;
+}
+
+/**
+ * @brief Find the earliest zone, for @ref WriteTrace.
+ * @param zone The zone.
+ * @param data The earliest start so far.
+ */
+static void FindTraceOrigin(const zone_t* zone, void* data)
+{
+    uint64_t* origin = data;
+    if (zone->start < *origin) *origin = zone->start;
+}
+
+/**
+ * @brief Write a thread's name as a metadata event, for @ref WriteTrace.
+ * @param thread The thread's number.
+ * @param name The thread's name, or NULL if it has none.
+ * @param data The writer.
+ */
+static void WriteTraceThread(uint32_t thread, const char* name, void* data)
+{
+    if (name == NULL) return;
+
+    trace_writer_t* writer = data;
+    BeginTraceEvent(writer);
+    fprintf(writer->file,
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+            "\"tid\":%u,\"args\":{\"name\":",
+            thread);
+    WriteTraceString(writer->file, name);
+    fputs("}}", writer->file);
+}
+
+/**
+ * @brief Write a zone as a complete event, for @ref WriteTrace.
+ * @param zone The zone.
+ * @param data The writer.
+ */
+static void WriteTraceZone(const zone_t* zone, void* data)
+{
+    trace_writer_t* writer = data;
+    BeginTraceEvent(writer);
+    fputs("{\"name\":", writer->file);
+    WriteTraceString(writer->file, zone->name);
+    fprintf(writer->file,
+            ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,"
+            "\"dur\":%.3f}",
+            zone->thread, (zone->start - writer->origin) / 1000.0,
+            zone->duration / 1000.0);
+}
+
+void WriteTrace(void)
+{
+    if (trace_path == NULL) return;
+
+    FILE* file = fopen(trace_path, "w");
+    if (file == NULL)
+    {
+        ReportWarning(unwritable_trace);
+        return;
+    }
+
+    trace_writer_t writer = {file, UINT64_MAX, false};
+    IterateZones(FindTraceOrigin, &writer.origin);
+
+    fputs("{\"traceEvents\":[", file);
+    BeginTraceEvent(&writer);
+    fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+          "\"args\":{\"name\":",
+          file);
+    WriteTraceString(file, TITLE);
+    fputs("}}", file);
+    IterateZoneThreads(WriteTraceThread, &writer);
+    IterateZones(WriteTraceZone, &writer);
+    fputs("\n],\"displayTimeUnit\":\"ns\"}\n", file);
+    fclose(file);
+}
@@ -0,0 +1,53 @@
+/**
+ * @file Trace.h
+ * @author Israfiel (https://github.com/israfiel-a)
+ * @brief Provides an export of every thread's timing zones in the Chrome
+ * trace event format, which can be opened in Perfetto or about:tracing to
+ * see where each thread spent its time frame by frame. Tracing is turned
+ * on with the --trace flag or the @ref TRACE_ENVIRONMENT_VARIABLE, and
+ * the trace is written when the window is destroyed.
+ * @date 2024-08-31
+ *
+ * @copyright (c) 2024 - Israfiel
+ */
+
+#ifndef _MSENG_TRACE_DIAGNOSTIC_SYSTEM_
+#define _MSENG_TRACE_DIAGNOSTIC_SYSTEM_
+
+#include <stdbool.h>
+
+/**
+ * @brief The environment variable that turns tracing on. A value of 1
+ * writes the trace to @ref TRACE_DEFAULT_PATH, and anything else is taken
+ * as the path to write it to.
+ */
+#define TRACE_ENVIRONMENT_VARIABLE "MORNINGSTAR_TRACE"
+
+/**
+ * @brief Where the trace is written if no path is given.
+ */
+#define TRACE_DEFAULT_PATH "morningstar-trace.json"
+
+/**
+ * @brief Turn tracing on. Zones are only timed if MSENG_ZONES is defined,
+ * so without it this warns and the trace comes out empty.
+ * @param path Where to write the trace, or NULL for @ref
+ * TRACE_DEFAULT_PATH. This must outlive the program.
+ */
+void EnableTracing(const char* path);
+
+/**
+ * @brief Check whether tracing has been turned on.
+ * @return true @ref WriteTrace will write a trace.
+ * @return false It'll do nothing.
+ */
+bool IsTracing(void);
+
+/**
+ * @brief Write every zone still kept to the trace file, if tracing is on.
+ * Only the last @ref ZONE_BUFFER_SIZE zones of each thread are kept, so
+ * this covers the end of a long run rather than all of it.
+ */
+void WriteTrace(void);
+
+#endif // _MSENG_TRACE_DIAGNOSTIC_SYSTEM_
@@ -0,0 +1,173 @@
+#include "Events.h"
+#include "Hardware.h" // The input callback group
+#include "Keyboard.h" // Keyboard state
+#include <stdatomic.h>
+
+/**
+ * @brief The internal input callback group.
+ */
+extern input_callback_group_t input_callbacks;
+
+/**
+ * @brief The ring itself.
+ */
+static input_event_t ring[INPUT_RING_SIZE];
+
+/**
+ * @brief The index of the next slot the producer will write. Only the
+ * producer writes this; it's kept on its own cache line so the two sides
+ * don't fight over one.
+ */
+static _Alignas(64) atomic_size_t ring_head = 0;
+
+/**
+ * @brief The index of the next slot the consumer will read. Only the
+ * consumer writes this.
+ */
+static _Alignas(64) atomic_size_t ring_tail = 0;
+
+/**
+ * @brief The amount of events dropped because the ring was full.
+ */
+static atomic_uint_fast64_t dropped_events = 0;
+
+bool PushInputEvent(const input_event_t* event)
+{
+    size_t head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring_tail, memory_order_acquire);
+    if (head - tail == INPUT_RING_SIZE)
+    {
+        atomic_fetch_add_explicit(&dropped_events, 1,
+                                  memory_order_relaxed);
+        return false;
+    }
+
+    ring[head & (INPUT_RING_SIZE - 1)] = *event;
+    atomic_store_explicit(&ring_head, head + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Fold an event into the polled input state as it leaves the ring,
+ * so that state is up to date no matter how the ring is drained.
+ * @param event The event being drained.
+ */
+static void RecordInputEvent(const input_event_t* event)
+{
+    if (event->type == key_event)
+        RecordKeyState_(event->code, event->pressed);
+    else if (event->type == keyboard_leave_event) ClearKeyState_();
+}
+
+bool PopInputEvent(input_event_t* event)
+{
+    size_t tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring_head, memory_order_acquire);
+    if (head == tail) return false;
+
+    *event = ring[tail & (INPUT_RING_SIZE - 1)];
+    atomic_store_explicit(&ring_tail, tail + 1, memory_order_release);
+    RecordInputEvent(event);
+    return true;
+}
+
+size_t DrainInputEvents(input_event_t* events, size_t capacity)
+{
+    size_t tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring_head, memory_order_acquire);
+
+    size_t count = head - tail;
+    if (count > capacity) count = capacity;
+    for (size_t i = 0; i < count; i++)
+        events[i] = ring[(tail + i) & (INPUT_RING_SIZE - 1)];
+
+    atomic_store_explicit(&ring_tail, tail + count, memory_order_release);
+    for (size_t i = 0; i < count; i++) RecordInputEvent(&events[i]);
+    return count;
+}
+
+/**
+ * @brief Hand a single event off to its callback, if one's set.
+ * @param event The event to dispatch.
+ */
+static void DispatchInputEvent(const input_event_t* event)
+{
+    switch (event->type)
+    {
+        case key_event:
+            if (event->pressed && input_callbacks.keyboard_keydown != NULL)
+                input_callbacks.keyboard_keydown(event->code);
+            else if (!event->pressed &&
+                     input_callbacks.keyboard_keyup != NULL)
+                input_callbacks.keyboard_keyup(event->code);
+            break;
+        case modifier_event:
+            if (input_callbacks.keyboard_modifier != NULL)
+                input_callbacks.keyboard_modifier(
+                    event->modifiers.pressed, event->modifiers.toggled,
+                    event->modifiers.locked);
+            break;
+        case keyboard_enter_event:
+            if (input_callbacks.keyboard_enter != NULL)
+                input_callbacks.keyboard_enter();
+            break;
+        case keyboard_leave_event:
+            if (input_callbacks.keyboard_leave != NULL)
+                input_callbacks.keyboard_leave();
+            break;
+        case button_event:
+            if (event->pressed &&
+                input_callbacks.mouse_button_down != NULL)
+                input_callbacks.mouse_button_down(event->code,
+                                                  event->time);
+            else if (!event->pressed &&
+                     input_callbacks.mouse_button_release != NULL)
+                input_callbacks.mouse_button_release(event->code,
+                                                     event->time);
+            break;
+        case motion_event:
+            if (input_callbacks.mouse_move != NULL)
+                input_callbacks.mouse_move(event->time, event->position.x,
+                                           event->position.y);
+            break;
+        case axis_event:
+        {
+            void (*callback)(enum wl_pointer_axis_source,
+                             enum wl_pointer_axis_relative_direction,
+                             wl_fixed_t, int32_t, uint32_t) =
+                event->axis_index == 0 ? input_callbacks.mouse_scroll
+                                       : input_callbacks.mouse_rock;
+            if (callback != NULL)
+                callback(event->axis_source, event->axis.direction,
+                         event->axis.length, event->axis.step,
+                         event->time);
+            break;
+        }
+        case mouse_enter_event:
+            if (input_callbacks.mouse_enter != NULL)
+                input_callbacks.mouse_enter(event->position.x,
+                                            event->position.y);
+            break;
+        case mouse_leave_event:
+            if (input_callbacks.mouse_leave != NULL)
+                input_callbacks.mouse_leave();
+            break;
+    }
+}
+
+size_t DispatchInputEvents(void)
+{
+    input_event_t batch[64];
+    size_t total = 0, count;
+    while ((count = DrainInputEvents(batch, 64)) > 0)
+    {
+        for (size_t i = 0; i < count; i++) DispatchInputEvent(&batch[i]);
+        total += count;
+    }
+    return total;
+}
+
+uint64_t GetDroppedInputEvents(void)
+{
+    return atomic_load_explicit(&dropped_events, memory_order_relaxed);
+}
@@ -0,0 +1,184 @@
+/**
+ * @file Events.h
+ * @author Israfiel (https://github.com/israfiel-a)
+ * @brief Provides the input event ring, a lock-free single-producer /
+ * single-consumer queue that carries timestamped input from the Wayland
+ * listeners over to the game logic.
+ * @date 2024-08-22
+ *
+ * @copyright (c) 2024 - Israfiel
+ */
+
+#ifndef _MSENG_EVENTS_INPUT_SYSTEM_
+#define _MSENG_EVENTS_INPUT_SYSTEM_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <wayland-util.h>
+
+/**
+ * @brief The amount of events the ring can hold before it starts dropping
+ * them. This must be a power of two.
+ */
+#define INPUT_RING_SIZE 1024
+
+/**
+ * @brief The kinds of event that can travel through the input ring.
+ */
+typedef enum __attribute__((__packed__))
+{
+    /**
+     * @brief A key changed state. See @ref input_event_t::code.
+     */
+    key_event,
+    /**
+     * @brief The keyboard's modifiers changed. See @ref
+     * input_event_t::modifiers.
+     */
+    modifier_event,
+    /**
+     * @brief The keyboard focus entered the window.
+     */
+    keyboard_enter_event,
+    /**
+     * @brief The keyboard focus left the window.
+     */
+    keyboard_leave_event,
+    /**
+     * @brief A mouse button changed state. See @ref input_event_t::code.
+     */
+    button_event,
+    /**
+     * @brief The mouse moved. See @ref input_event_t::position.
+     */
+    motion_event,
+    /**
+     * @brief The mouse scrolled or swiped. See @ref input_event_t::axis.
+     */
+    axis_event,
+    /**
+     * @brief The mouse entered the window. See @ref
+     * input_event_t::position.
+     */
+    mouse_enter_event,
+    /**
+     * @brief The mouse left the window.
+     */
+    mouse_leave_event
+} input_event_type_t;
+
+/**
+ * @brief A single input event. This is kept small (20 bytes) so a frame's
+ * worth of input fits in a handful of cache lines.
+ */
+typedef struct
+{
+    /**
+     * @brief The kind of event this is.
+     */
+    input_event_type_t type;
+    /**
+     * @brief For key and button events, whether the key/button is now
+     * pressed (1) or released (0).
+     */
+    uint8_t pressed;
+    /**
+     * @brief For axis events, which axis moved; 0 for vertical (scroll),
+     * 1 for horizontal (rock).
+     */
+    uint8_t axis_index;
+    /**
+     * @brief For axis events, the source of the movement (wheel, finger,
+     * etc.).
+     */
+    uint8_t axis_source;
+    /**
+     * @brief The timestamp of the event down to the millisecond, as given
+     * by the compositor. Events the compositor doesn't timestamp are
+     * stamped when they're received, from the same monotonic clock.
+     */
+    uint32_t time;
+    union
+    {
+        /**
+         * @brief The key or button, as defined by @file
+         * linux/input-event-codes.h.
+         */
+        uint32_t code;
+        /**
+         * @brief Where the mouse is, in surface coordinates.
+         */
+        struct
+        {
+            wl_fixed_t x;
+            wl_fixed_t y;
+        } position;
+        /**
+         * @brief How far an axis moved, and in which direction.
+         */
+        struct
+        {
+            wl_fixed_t length;
+            int32_t step;
+            uint32_t direction;
+        } axis;
+        /**
+         * @brief The modifier keys that are pressed, toggled, and locked.
+         */
+        struct
+        {
+            uint32_t pressed;
+            uint32_t toggled;
+            uint32_t locked;
+        } modifiers;
+    };
+} input_event_t;
+
+/**
+ * @brief Push an event onto the input ring. This must only ever be called
+ * from one thread at a time--the one dispatching the input event queue.
+ * If the ring is full, the event is dropped and counted.
+ * @param event The event to push.
+ * @return true The event was pushed.
+ * @return false The ring was full, and the event was dropped.
+ */
+bool PushInputEvent(const input_event_t* event);
+
+/**
+ * @brief Pop the oldest event off of the input ring. This must only ever
+ * be called from the thread running the game logic. Key events are folded
+ * into the state read by @ref IsKeyDown and friends as they're popped.
+ * @param event Where to put the event.
+ * @return true An event was popped.
+ * @return false The ring was empty.
+ */
+bool PopInputEvent(input_event_t* event);
+
+/**
+ * @brief Pop as many events as will fit into the given buffer at once.
+ * This must only ever be called from the thread running the game logic.
+ * Like @ref PopInputEvent, any key events are folded into the keyboard
+ * state on the way out.
+ * @param events The buffer to fill.
+ * @param capacity The amount of events the buffer can hold.
+ * @return The amount of events popped.
+ */
+size_t DrainInputEvents(input_event_t* events, size_t capacity);
+
+/**
+ * @brief Drain the ring, handing each event to the matching callback set
+ * through the functions in @file Hardware.h. This is the compatibility
+ * shim for code written against the callback interface, and should be
+ * called once per game logic tick on the game logic thread.
+ * @return The amount of events dispatched.
+ */
+size_t DispatchInputEvents(void);
+
+/**
+ * @brief Get the amount of events dropped because the ring was full.
+ * @return The drop count.
+ */
+uint64_t GetDroppedInputEvents(void);
+
+#endif // _MSENG_EVENTS_INPUT_SYSTEM_
@@ -1,17 +1,46 @@
 #include "File.h"
+#include <Diagnostic/Benchmark.h> // Microbenchmarks
+#include <Diagnostic/Trace.h>     // Trace export
 #include <Globals.h>
+#include <Memory/Fill.h> // Pixel fills
 #include <Output/Error.h>
 #include <Output/Warning.h>
+#include <Rendering/Shader.h> // Shader file override
 #include <Windowing/Wayland.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <memory.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
-void HandleCommandLineArgs(int argc, char** argv) {}
+void HandleCommandLineArgs(int argc, char** argv)
+{
+    // Messages are only printed if there's a terminal to print them to.
+    if (isatty(STDOUT_FILENO)) global_flags.stdout_available = true;
+
+    const char* trace = getenv(TRACE_ENVIRONMENT_VARIABLE);
+    if (trace != NULL && *trace != '\0')
+        EnableTracing(strcmp(trace, "1") == 0 ? NULL : trace);
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--benchmark") == 0)
+        {
+            RunBenchmarks();
+            exit(EXIT_SUCCESS);
+        }
+        else if (strcmp(argv[i], "--shader-files") == 0)
+            SetShaderFileOverride(true);
+        else if (strcmp(argv[i], "--trace") == 0) EnableTracing(NULL);
+        else if (strncmp(argv[i], "--trace=", 8) == 0)
+            EnableTracing(argv[i] + 8);
+    }
+}
 
 static void HandleBufferDeletion(void* data, struct wl_buffer* buffer)
 {
@@ -111,12 +140,7 @@ struct wl_buffer* CreateSolidPixelBuffer(uint32_t width, uint32_t height,
     wl_shm_pool_destroy(pool);
     close(fd);
 
-    // Some bizzare code stolen from
-    // https://stackoverflow.com/questions/108866/is-there-memset-that-accepts-integers-larger-than-char
-    uintptr_t i;
-    for (i = 0; i < (size & (~7)); i += 4)
-        memcpy(((char*)frame_data) + i, &color, 4);
-    for (; i < size; i++) ((char*)frame_data)[i] = ((char*)&color)[i & 7];
+    FillPixels(frame_data, color, size / 4);
 
     if (munmap(frame_data, size) == -1) ReportError(unmmap_failure);
 
@@ -126,6 +150,13 @@ struct wl_buffer* CreateSolidPixelBuffer(uint32_t width, uint32_t height,
 
 struct wl_shm* GetSHM(void) { return shm_buffer; }
 
+size_t GetFileLength(const char* file_path)
+{
+    struct stat file_stats;
+    if (stat(file_path, &file_stats) == -1) return 0;
+    return file_stats.st_size;
+}
+
 bool ReadFileContents(const char* file_path, char* buffer,
                       size_t buffer_length)
 {
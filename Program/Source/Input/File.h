@@ -20,7 +20,12 @@
  * This often is used to tweak performance settings.
  * @param argc The count of arguments as given by the command line.
  * @param argv The actual arguments.
- * @note UNIMPLEMENTED -- no valid params
+ * @note The valid params right now are --benchmark, which runs the
+ * microbenchmarks in @file Benchmark.h and exits, and --shader-files,
+ * which reads shaders from disk rather than the copies built into the
+ * library (see @ref SetShaderFileOverride), and --trace or --trace=path,
+ * which writes a trace of every thread's zones on exit (see @file
+ * Trace.h).
  */
 void HandleCommandLineArgs(int argc, char** argv);
 
@@ -34,6 +39,13 @@ void BindSHM(uint32_t name, uint32_t version);
 void UnbindSHM(void);
 struct wl_shm* GetSHM(void);
 
+/**
+ * @brief Get the size of a file.
+ * @param file_path The path of the file.
+ * @return The size of the file in bytes, or 0 if it couldn't be read.
+ */
+size_t GetFileLength(const char* file_path);
+
 _Bool ReadFileContents(const char* file_path, char* buffer,
                        size_t buffer_length);
 
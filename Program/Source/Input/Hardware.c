@@ -1,5 +1,7 @@
 #include "Hardware.h"
+#include "Events.h" // Input event ring
 #include <Globals.h>
+#include <Output/Messages.h>
 #include <Output/Warning.h>
 #include <Windowing/Wayland.h>       // Registry functions
 #include <linux/input-event-codes.h> // Linux input codes
@@ -22,6 +24,12 @@ extern const struct wl_pointer_listener mouse_listener;
  */
 static struct wl_seat* seat = NULL;
 
+/**
+ * @brief A wrapper of @ref seat that places the devices created through
+ * it onto the input event queue.
+ */
+static struct wl_seat* seat_wrapper = NULL;
+
 /**
  * @brief The mouse currently registered to the application. If none
  * are, then this value is set to NULL.
@@ -57,7 +65,7 @@ static void HIDC(void* d, struct wl_seat* seat, uint32_t capabilities)
     bool supports_mouse = capabilities & WL_SEAT_CAPABILITY_POINTER;
     if (supports_mouse && mouse == NULL)
     {
-        mouse = wl_seat_get_pointer(seat);
+        mouse = wl_seat_get_pointer(seat_wrapper);
         wl_pointer_add_listener(mouse, &mouse_listener, NULL);
         global_flags.input_mode = full;
     }
@@ -71,7 +79,7 @@ static void HIDC(void* d, struct wl_seat* seat, uint32_t capabilities)
     bool supports_keyboard = capabilities & WL_SEAT_CAPABILITY_KEYBOARD;
     if (supports_keyboard && keyboard == NULL)
     {
-        keyboard = wl_seat_get_keyboard(seat);
+        keyboard = wl_seat_get_keyboard(seat_wrapper);
         wl_keyboard_add_listener(keyboard, &keyboard_listener, NULL);
     }
     else if (!supports_keyboard && keyboard != NULL)
@@ -109,6 +117,9 @@ void BindInputGroup(const uint32_t name, const uint32_t version)
 
     seat =
         wl_registry_bind(GetRegistry(), name, &wl_seat_interface, version);
+    // The seat itself stays on the default queue, but the devices we get
+    // from it report on the input queue.
+    seat_wrapper = WrapForEventQueue(seat, input_queue);
     wl_seat_add_listener(seat, &input_group_listener, NULL);
     devices.input_group = true;
 }
@@ -123,8 +134,15 @@ void UnbindInputGroup(void)
 
     if (mouse != NULL) wl_pointer_release(mouse);
     if (keyboard != NULL) wl_keyboard_release(keyboard);
+    wl_proxy_wrapper_destroy(seat_wrapper);
     wl_seat_release(seat);
+    seat_wrapper = NULL;
     devices.input_group = false;
+
+    uint64_t dropped = GetDroppedInputEvents();
+    if (dropped > 0)
+        ReportMessage("%lu input event(s) dropped on a full ring",
+                      dropped);
 }
 
 struct wl_seat* GetInputGroup(void) { return seat; }
@@ -1,7 +1,10 @@
 #include "Keyboard.h"
-#include "Hardware.h" // The input callback group
+#include "Events.h"          // Input event ring
+#include "Hardware.h"        // The input callback group
+#include <Diagnostic/Time.h> // Event timestamps
 #include <assert.h>
 #include <linux/input-event-codes.h> // Linux input codes
+#include <string.h>
 #include <sys/mman.h>
 #include <unistd.h>
 
@@ -19,9 +22,77 @@ static uint32_t key_pressed_before = 0;
  */
 static uint32_t last_key_pressed = 0;
 
+/**
+ * @brief The amount of 64-bit words it takes to hold one bit for every key
+ * code Linux defines.
+ */
+#define KEY_STATE_WORDS ((KEY_CNT + 63) / 64)
+
+/**
+ * @brief A set of keys, one bit per key code. Keeping these as whole words
+ * lets every set operation below run a word (or a vector) at a time.
+ */
+typedef uint64_t key_set_t[KEY_STATE_WORDS];
+
+/**
+ * @brief The keys that are down right now, as of the last event drained.
+ */
+static key_set_t keys_live;
+
+/**
+ * @brief Every key that went down since the last snapshot, even if it's
+ * since come back up.
+ */
+static key_set_t keys_latched;
+
+/**
+ * @brief The keys down as of the current snapshot.
+ */
+static key_set_t keys_current;
+
+/**
+ * @brief The keys down as of the snapshot before the current one.
+ */
+static key_set_t keys_previous;
+
+/**
+ * @brief The keys that went down between the two snapshots.
+ */
+static key_set_t keys_pressed;
+
+/**
+ * @brief The keys that went up between the two snapshots.
+ */
+static key_set_t keys_released;
+
+/**
+ * @brief Check a single key's bit within a set.
+ * @param set The set to check.
+ * @param key The key to check.
+ * @return The state of the bit, or false if the key is out of range.
+ */
+static inline bool TestKey(const key_set_t set, uint32_t key)
+{
+    if (key >= KEY_CNT) return false;
+    return (set[key >> 6] >> (key & 63)) & 1;
+}
+
+/**
+ * @brief Push an event that the compositor doesn't timestamp onto the
+ * input ring, stamping it ourselves.
+ * @param event The event to push.
+ */
+static void PushUntimedEvent(input_event_t* event)
+{
+    event->time = GetCurrentTimeNS() / 1000000;
+    PushInputEvent(event);
+}
+
 /**
  * @brief Provides a file descriptor that when mapped in read-only mode
- * will describe the user's keymap configuration.
+ * will describe the user's keymap configuration. Unlike the rest of the
+ * keyboard events this is handed over directly, since the mapping only
+ * lives as long as this function.
  * @param d Nothing of use.
  * @param k Nothing of use.
  * @param format The format of the given keymap.
@@ -55,8 +126,17 @@ static void HKM(void* d, struct wl_keyboard* k,
 static void HKE(void* d, struct wl_keyboard* k, uint32_t serial,
                 struct wl_surface* s, struct wl_array* keys)
 {
-    if (input_callbacks.keyboard_enter != NULL)
-        input_callbacks.keyboard_enter();
+    input_event_t event = {.type = keyboard_enter_event};
+    PushUntimedEvent(&event);
+
+    // Keys held as focus arrives never send a press of their own.
+    uint32_t* key;
+    wl_array_for_each(key, keys)
+    {
+        input_event_t key_down = {
+            .type = key_event, .pressed = 1, .code = *key};
+        PushUntimedEvent(&key_down);
+    }
 }
 
 /**
@@ -69,8 +149,8 @@ static void HKE(void* d, struct wl_keyboard* k, uint32_t serial,
 static void HKL(void* d, struct wl_keyboard* k, uint32_t s,
                 struct wl_surface* w)
 {
-    if (input_callbacks.keyboard_leave != NULL)
-        input_callbacks.keyboard_leave();
+    input_event_t event = {.type = keyboard_leave_event};
+    PushUntimedEvent(&event);
 }
 
 /**
@@ -88,16 +168,18 @@ static void HKK(void* d, struct wl_keyboard* k, uint32_t serial,
                 uint32_t time, uint32_t key,
                 enum wl_keyboard_key_state state)
 {
-    if (state == WL_KEYBOARD_KEY_STATE_PRESSED &&
-        input_callbacks.keyboard_keydown != NULL)
+    if (state == WL_KEYBOARD_KEY_STATE_PRESSED)
     {
         key_pressed_before = last_key_pressed;
         last_key_pressed = key;
-        input_callbacks.keyboard_keydown(key);
     }
-    if (state == WL_KEYBOARD_KEY_STATE_RELEASED &&
-        input_callbacks.keyboard_keyup != NULL)
-        input_callbacks.keyboard_keyup(key);
+
+    input_event_t event = {
+        .type = key_event,
+        .pressed = state == WL_KEYBOARD_KEY_STATE_PRESSED,
+        .time = time,
+        .code = key};
+    PushInputEvent(&event);
 }
 
 /**
@@ -114,8 +196,9 @@ static void HKMO(void* d, struct wl_keyboard* k, uint32_t serial,
                  uint32_t pressed, uint32_t toggled, uint32_t locked,
                  uint32_t group)
 {
-    if (input_callbacks.keyboard_modifier != NULL)
-        input_callbacks.keyboard_modifier(pressed, toggled, locked);
+    input_event_t event = {.type = modifier_event,
+                           .modifiers = {pressed, toggled, locked}};
+    PushUntimedEvent(&event);
 }
 
 /**
@@ -140,6 +223,49 @@ static void HKR(void* d, struct wl_keyboard* k, int32_t rate,
 const struct wl_keyboard_listener keyboard_listener = {HKM, HKE,  HKL,
                                                        HKK, HKMO, HKR};
 
+void RecordKeyState_(uint32_t key, bool pressed)
+{
+    if (key >= KEY_CNT) return;
+
+    uint64_t bit = (uint64_t)1 << (key & 63);
+    if (pressed)
+    {
+        keys_live[key >> 6] |= bit;
+        keys_latched[key >> 6] |= bit;
+    }
+    else keys_live[key >> 6] &= ~bit;
+}
+
+void ClearKeyState_(void) { memset(keys_live, 0, sizeof(keys_live)); }
+
+void UpdateKeyboardState(void)
+{
+    // Straight-line word operations with no branches, which the compiler
+    // is free to vectorize.
+    for (size_t i = 0; i < KEY_STATE_WORDS; i++)
+    {
+        uint64_t current = keys_live[i] | keys_latched[i];
+        uint64_t changed = current ^ keys_current[i];
+
+        keys_previous[i] = keys_current[i];
+        keys_current[i] = current;
+        keys_pressed[i] = changed & current;
+        keys_released[i] = changed & keys_previous[i];
+        keys_latched[i] = 0;
+    }
+}
+
+bool IsKeyDown(uint32_t key) { return TestKey(keys_current, key); }
+
+bool IsKeyPressed(uint32_t key) { return TestKey(keys_pressed, key); }
+
+bool IsKeyReleased(uint32_t key) { return TestKey(keys_released, key); }
+
+bool IsKeyHeld(uint32_t key)
+{
+    return TestKey(keys_current, key) && TestKey(keys_previous, key);
+}
+
 const uint32_t GetLastKeyPressed(void) { return last_key_pressed; }
 
 const uint64_t GetLastKeyCombo(void)
@@ -11,6 +11,7 @@
 #define _MSENG_KEYBOARD_INPUT_SYSTEM_
 
 #include <inttypes.h>
+#include <stdbool.h>
 
 /**
  * @brief Get the 32-bit unsigned integer representation of the key just
@@ -27,4 +28,63 @@ const uint32_t GetLastKeyPressed(void);
  */
 const uint64_t GetLastKeyCombo(void);
 
+/**
+ * @brief Record a key changing state. This is called by the input ring as
+ * key events are drained, and so runs on the game logic thread; nothing
+ * else should need to call it.
+ * @param key The key, as defined by @file linux/input-event-codes.h.
+ * @param pressed Whether the key went down or up.
+ */
+void RecordKeyState_(uint32_t key, bool pressed);
+
+/**
+ * @brief Forget every key that's currently down. This is called by the
+ * input ring when keyboard focus leaves the window, since we won't hear
+ * about any keys released after that.
+ */
+void ClearKeyState_(void);
+
+/**
+ * @brief Take a snapshot of the keyboard for this logic tick, working out
+ * which keys were pressed and released since the last one. This should be
+ * called once per tick, after the input ring has been drained. A key that
+ * was pressed and released within one tick still reads as down for that
+ * tick.
+ */
+void UpdateKeyboardState(void);
+
+/**
+ * @brief Check if a key is down as of the last keyboard snapshot.
+ * @param key The key, as defined by @file linux/input-event-codes.h.
+ * @return true The key is down.
+ * @return false The key is up, or isn't a valid key code.
+ */
+bool IsKeyDown(uint32_t key);
+
+/**
+ * @brief Check if a key went down between the last two keyboard
+ * snapshots.
+ * @param key The key, as defined by @file linux/input-event-codes.h.
+ * @return true The key was just pressed.
+ * @return false The key wasn't just pressed.
+ */
+bool IsKeyPressed(uint32_t key);
+
+/**
+ * @brief Check if a key went up between the last two keyboard snapshots.
+ * @param key The key, as defined by @file linux/input-event-codes.h.
+ * @return true The key was just released.
+ * @return false The key wasn't just released.
+ */
+bool IsKeyReleased(uint32_t key);
+
+/**
+ * @brief Check if a key was down for both of the last two keyboard
+ * snapshots.
+ * @param key The key, as defined by @file linux/input-event-codes.h.
+ * @return true The key is being held.
+ * @return false The key isn't being held.
+ */
+bool IsKeyHeld(uint32_t key);
+
 #endif // _MSENG_KEYBOARD_INPUT_SYSTEM_
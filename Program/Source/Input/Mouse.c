@@ -1,13 +1,9 @@
 #include "Mouse.h"
-#include "Hardware.h"                // Input callback group
+#include "Events.h"                  // Input event ring
+#include <Diagnostic/Time.h>         // Event timestamps
 #include <linux/input-event-codes.h> // Linux input codes
 #include <memory.h>
 
-/**
- * @brief The internal input callback group.
- */
-extern input_callback_group_t input_callbacks;
-
 /**
  * @brief The last mouse event triggered by the application. This event is
  * reset every time a mouse "frame" has passed, and filled out with new
@@ -76,10 +72,14 @@ static void HMP(void* d, struct wl_pointer* m, uint32_t serial,
                 uint32_t time, uint32_t button,
                 enum wl_pointer_button_state state)
 {
-    last_mouse_event.events |= press;
-    last_mouse_event.time = time;
-    last_mouse_event.button = button;
-    last_mouse_event.state = state;
+    // Buttons go straight onto the ring instead of waiting for the frame,
+    // since a single frame can carry more than one of them.
+    input_event_t event = {
+        .type = button_event,
+        .pressed = state == WL_POINTER_BUTTON_STATE_PRESSED,
+        .time = time,
+        .code = button};
+    PushInputEvent(&event);
 }
 
 /**
@@ -87,16 +87,16 @@ static void HMP(void* d, struct wl_pointer* m, uint32_t serial,
  * @param d Nothing of use.
  * @param m Nothing of use.
  * @param time The timestamp of the axis event down to the millisecond.
- * @param axis The axis affected, horizontal or vertical.
+ * @param axis_index The axis affected, horizontal or vertical.
  * @param value The length of the axis change.
  */
 static void HMA(void* d, struct wl_pointer* m, uint32_t time,
-                enum wl_pointer_axis_source axis, wl_fixed_t value)
+                enum wl_pointer_axis axis_index, wl_fixed_t value)
 {
     last_mouse_event.events |= axis;
     last_mouse_event.time = time;
-    last_mouse_event.axes[axis].valid = true;
-    last_mouse_event.axes[axis].length = value;
+    last_mouse_event.axes[axis_index].valid = true;
+    last_mouse_event.axes[axis_index].length = value;
 }
 
 /**
@@ -104,13 +104,13 @@ static void HMA(void* d, struct wl_pointer* m, uint32_t time,
  * operation the user did.
  * @param d Nothing of use.
  * @param m Nothing of use.
- * @param axis_source The type of axis movement.
+ * @param source The type of axis movement.
  */
 static void HMAI(void* d, struct wl_pointer* m,
-                 enum wl_pointer_axis_source axis_source)
+                 enum wl_pointer_axis_source source)
 {
     last_mouse_event.events |= axis_source;
-    last_mouse_event.axis_information = axis_source;
+    last_mouse_event.axis_information = source;
 }
 
 /**
@@ -118,14 +118,14 @@ static void HMAI(void* d, struct wl_pointer* m,
  * @param d Nothing of use.
  * @param m Nothing of use.
  * @param time The timestamp of the axis event down to the millisecond.
- * @param axis The axis whose event stopped.
+ * @param axis_index The axis whose event stopped.
  */
 static void HMAS(void* d, struct wl_pointer* m, uint32_t time,
-                 enum wl_pointer_axis_source axis)
+                 enum wl_pointer_axis axis_index)
 {
     last_mouse_event.time = time;
     last_mouse_event.events |= axis_stop;
-    last_mouse_event.axes[axis].valid = true;
+    last_mouse_event.axes[axis_index].valid = true;
 }
 
 /**
@@ -133,15 +133,15 @@ static void HMAS(void* d, struct wl_pointer* m, uint32_t time,
  * just step information for scrolling and other such things.
  * @param d Nothing of use.
  * @param m Nothing of use.
- * @param axis The axis whose event is currently being triggered.
+ * @param axis_index The axis whose event is currently being triggered.
  * @param discrete The step of the axis.
  */
 static void HMAD(void* d, struct wl_pointer* m,
-                 enum wl_pointer_axis_source axis, int32_t discrete)
+                 enum wl_pointer_axis axis_index, int32_t discrete)
 {
     last_mouse_event.events |= axis_discrete;
-    last_mouse_event.axes[axis].valid = true;
-    last_mouse_event.axes[axis].discrete = discrete;
+    last_mouse_event.axes[axis_index].valid = true;
+    last_mouse_event.axes[axis_index].discrete = discrete;
 }
 
 /**
@@ -155,71 +155,72 @@ static void HMAHR(void* d, struct wl_pointer* m, uint32_t a, int32_t v) {}
  * like "up" and "down" when one is scrolling.
  * @param d Nothing of use.
  * @param m Nothing of use.
- * @param axis The axis being directed.
+ * @param axis_index The axis being directed.
  * @param direction The direction of the axis.
  */
 static void HMARD(void* d, struct wl_pointer* m,
-                  enum wl_pointer_axis_source axis,
+                  enum wl_pointer_axis axis_index,
                   enum wl_pointer_axis_relative_direction direction)
 {
     last_mouse_event.events |= axis_direction;
-    last_mouse_event.axes[axis].valid = true;
-    last_mouse_event.axes[axis].direction = direction;
+    last_mouse_event.axes[axis_index].valid = true;
+    last_mouse_event.axes[axis_index].direction = direction;
 }
 
 /**
- * @brief Update the screen with all the various things Wayland reported
- * the user did during the last mouse sequence.
+ * @brief Push everything Wayland reported the user did during the last
+ * mouse sequence onto the input ring, in the order it makes sense to
+ * handle it.
  * @param d Nothing of use.
  * @param m Nothing of use.
  */
 static void HMF(void* d, struct wl_pointer* m)
 {
-    // Big ol' if statement blob, this checks for each event, sees if a
-    // corresponding callback has been set, and triggers it if it has.
-    if (last_mouse_event.events & enter &&
-        input_callbacks.mouse_enter != NULL)
-        input_callbacks.mouse_enter(last_mouse_event.x,
-                                    last_mouse_event.y);
-    if (last_mouse_event.events & leave &&
-        input_callbacks.mouse_leave != NULL)
-        input_callbacks.mouse_leave();
-    if (last_mouse_event.events & motion &&
-        input_callbacks.mouse_move != NULL)
-        input_callbacks.mouse_move(last_mouse_event.time,
-                                   last_mouse_event.x, last_mouse_event.y);
-    if (last_mouse_event.events & press)
+    // Enter and leave events carry no timestamp, so stamp them from the
+    // same monotonic clock the compositor uses.
+    uint32_t time = last_mouse_event.time;
+    if (time == 0) time = GetCurrentTimeNS() / 1000000;
+
+    if (last_mouse_event.events & enter)
+    {
+        input_event_t event = {.type = mouse_enter_event,
+                               .time = time,
+                               .position = {last_mouse_event.x,
+                                            last_mouse_event.y}};
+        PushInputEvent(&event);
+    }
+    if (last_mouse_event.events & leave)
+    {
+        input_event_t event = {.type = mouse_leave_event, .time = time};
+        PushInputEvent(&event);
+    }
+    if (last_mouse_event.events & motion)
     {
-        if (last_mouse_event.state == WL_POINTER_BUTTON_STATE_PRESSED &&
-            input_callbacks.mouse_button_down != NULL)
-            input_callbacks.mouse_button_down(last_mouse_event.button,
-                                              last_mouse_event.time);
-        else if (last_mouse_event.state ==
-                     WL_POINTER_BUTTON_STATE_RELEASED &&
-                 input_callbacks.mouse_button_release != NULL)
-            input_callbacks.mouse_button_release(last_mouse_event.button,
-                                                 last_mouse_event.time);
+        input_event_t event = {.type = motion_event,
+                               .time = time,
+                               .position = {last_mouse_event.x,
+                                            last_mouse_event.y}};
+        PushInputEvent(&event);
     }
     // Just merge all axis events into one value, as we need to check for
     // all of them or none of them.
-    uint32_t axis_event =
+    uint32_t axis_events =
         axis | axis_stop | axis_source | axis_discrete | axis_direction;
-    if (last_mouse_event.events & axis_event)
+    if (last_mouse_event.events & axis_events)
     {
-        if (last_mouse_event.axes[0].valid &&
-            input_callbacks.mouse_scroll != NULL)
-            input_callbacks.mouse_scroll(
-                last_mouse_event.axis_information,
-                last_mouse_event.axes[0].direction,
-                last_mouse_event.axes[0].length,
-                last_mouse_event.axes[0].discrete, last_mouse_event.time);
-        if (last_mouse_event.axes[1].valid &&
-            input_callbacks.mouse_rock != NULL)
-            input_callbacks.mouse_rock(last_mouse_event.axis_information,
-                                       last_mouse_event.axes[1].direction,
-                                       last_mouse_event.axes[1].length,
-                                       last_mouse_event.axes[1].discrete,
-                                       last_mouse_event.time);
+        for (uint8_t i = 0; i < 2; i++)
+        {
+            if (!last_mouse_event.axes[i].valid) continue;
+            input_event_t event = {
+                .type = axis_event,
+                .axis_index = i,
+                .axis_source = last_mouse_event.axis_information,
+                .time = time,
+                .axis = {last_mouse_event.axes[i].length,
+                         last_mouse_event.axes[i].discrete,
+                         last_mouse_event.axes[i].direction}};
+            PushInputEvent(&event);
+        }
     }
 
     // Reset the event to a NULL state.
@@ -1,16 +1,74 @@
+#include <Input/File.h>
+#include <Rendering/Colors.h>
 #include <Rendering/Loop.h>
+#include <Rendering/Sprite.h>
+#include <Rendering/Target.h>
+#include <Simulation/Tick.h>
 #include <Windowing/Windowing.h>
 
+/**
+ * @brief The size of the demo's block, in logical pixels.
+ */
+#define DEMO_BLOCK_SIZE 32.0f
+
+/**
+ * @brief The demo's game state: a block bouncing across the center panel.
+ */
+typedef struct
+{
+    float x;
+    float velocity;
+} demo_state_t;
+
+/**
+ * @brief Move the block along by one tick, turning it around at the edges
+ * of the center panel.
+ */
+static void TickDemo(void* state, uint64_t tick)
+{
+    demo_state_t* demo = state;
+    if (tick == 0) demo->velocity = 4.0f;
+
+    demo->x += demo->velocity;
+    if (demo->x <= 0.0f || demo->x >= TARGET_CENTER_SIZE - DEMO_BLOCK_SIZE)
+        demo->velocity = -demo->velocity;
+}
+
+/**
+ * @brief Draw the block in the center panel, between where the last two
+ * ticks left it.
+ */
+static void DrawDemo(const panel_t* panel, uint32_t width, uint32_t height,
+                     const simulation_frame_t* frame)
+{
+    if (panel->type != center_filler || frame->current == NULL) return;
+
+    const demo_state_t* previous = frame->previous;
+    const demo_state_t* current = frame->current;
+    const sprite_t block = {
+        .x = previous->x + (current->x - previous->x) * frame->alpha,
+        .y = height / 2.0f - DEMO_BLOCK_SIZE / 2.0f,
+        .width = DEMO_BLOCK_SIZE,
+        .height = DEMO_BLOCK_SIZE,
+        .tint = CRIMSON};
+    DrawSprite(&block);
+}
+
 int main(int argc, char** argv)
 {
+    HandleCommandLineArgs(argc, argv);
     SetupWindow();
+    SetTickFunction(TickDemo, sizeof(demo_state_t));
+    SetPanelDrawFunction(DrawDemo);
     CreateRenderingThread();
 
     CreateWindow(TITLE);
     panel_t* backdrop = CreatePanel(center_filler);
     if (backdrop == NULL) return 9;
 
+    CreateSimulationThread();
     run();
+    DestroySimulationThread();
 
     DestroyWindow();
 }
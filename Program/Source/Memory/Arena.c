@@ -0,0 +1,57 @@
+#include "Arena.h"
+#include <Output/System.h> // Error and warning reporting
+
+arena_t CreateArena(size_t size)
+{
+    arena_t created_arena = {AllocateBlock(size), 0, 0};
+    return created_arena;
+}
+
+void DestroyArena(arena_t* arena)
+{
+    FreeBlock(&arena->block);
+    arena->offset = 0;
+    arena->peak = 0;
+}
+
+ptr_t ArenaAllocate(arena_t* arena, size_t size)
+{
+    // Round the start of the block up to the alignment. The backing block
+    // comes from malloc, so it's already aligned to at least this.
+    size_t start = (arena->offset + ARENA_ALIGNMENT - 1) &
+                   ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (start > arena->block.size || size > arena->block.size - start)
+        ReportError(arena_exhaustion);
+
+    arena->offset = start + size;
+    if (arena->offset > arena->peak) arena->peak = arena->offset;
+
+    ptr_t allocated_ptr = {(uint8_t*)arena->block._p + start, size};
+    return allocated_ptr;
+}
+
+ptr_t ArenaAllocateZeroed(arena_t* arena, size_t size)
+{
+    ptr_t allocated_ptr = ArenaAllocate(arena, size);
+    memset(allocated_ptr._p, 0, size);
+    return allocated_ptr;
+}
+
+void ResetArena(arena_t* arena) { arena->offset = 0; }
+
+arena_scope_t BeginArenaScope(const arena_t* arena)
+{
+    return arena->offset;
+}
+
+void EndArenaScope(arena_t* arena, arena_scope_t scope)
+{
+    if (scope > arena->offset)
+    {
+        ReportWarning(arena_scope_mismatch);
+        return;
+    }
+    arena->offset = scope;
+}
+
+size_t GetArenaUsage(const arena_t* arena) { return arena->offset; }
@@ -0,0 +1,116 @@
+/**
+ * @file Arena.h
+ * @author Israfiel (https://github.com/israfiel-a)
+ * @brief Provides linear (arena) allocation on top of the wrapped pointer
+ * interface. One large block is allocated up front, and every allocation
+ * after that is a pointer bump into it.
+ * @date 2024-08-22
+ *
+ * @copyright (c) 2024 - Israfiel
+ */
+
+#ifndef _MSENG_ARENA_MEMORY_SYSTEM_
+#define _MSENG_ARENA_MEMORY_SYSTEM_
+
+#include "Allocate.h" // Wrapped pointers
+
+/**
+ * @brief The alignment of every allocation made from an arena, in bytes.
+ * This is enough for any scalar type, and for 128-bit vectors.
+ */
+#define ARENA_ALIGNMENT 16
+
+/**
+ * @brief A linear allocator. Blocks are handed out front-to-back, and can
+ * only be given back all at once, either by resetting the arena or by
+ * ending a scope.
+ */
+typedef struct
+{
+    /**
+     * @brief The backing block, allocated when the arena is created.
+     */
+    ptr_t block;
+    /**
+     * @brief How many bytes into the backing block the next allocation
+     * will start.
+     */
+    size_t offset;
+    /**
+     * @brief The furthest the arena has ever been filled, in bytes. This
+     * is useful for sizing arenas.
+     */
+    size_t peak;
+} arena_t;
+
+/**
+ * @brief A marker saved at the start of a scope, and used to give back
+ * every allocation made since then. See @ref BeginArenaScope.
+ */
+typedef size_t arena_scope_t;
+
+/**
+ * @brief Create an arena with the given capacity. The capacity is fixed;
+ * running out of it is a fatal error.
+ * @param size The capacity of the arena in bytes.
+ * @return The created arena.
+ */
+arena_t CreateArena(size_t size);
+
+/**
+ * @brief Destroy an arena, freeing its backing block. Every block handed
+ * out by the arena is invalid after this.
+ * @param arena The arena to destroy.
+ */
+void DestroyArena(arena_t* arena);
+
+/**
+ * @brief Allocate a block from the arena. The block is uninitialized. It
+ * must @b not be passed to @ref FreeBlock or @ref ReallocateBlock; it's
+ * given back when the arena is reset or the enclosing scope ends.
+ * @param arena The arena to allocate from.
+ * @param size The size of the block.
+ * @return The allocated block.
+ */
+ptr_t ArenaAllocate(arena_t* arena, size_t size);
+
+/**
+ * @brief The same as @ref ArenaAllocate, except the block is zeroed.
+ * @param arena The arena to allocate from.
+ * @param size The size of the block.
+ * @return The allocated block.
+ */
+ptr_t ArenaAllocateZeroed(arena_t* arena, size_t size);
+
+/**
+ * @brief Give back every block the arena has handed out. This doesn't
+ * touch the memory itself, so it takes the same time no matter how much
+ * was allocated.
+ * @param arena The arena to reset.
+ */
+void ResetArena(arena_t* arena);
+
+/**
+ * @brief Begin a scope within the arena. Every block allocated after this
+ * is given back by the matching @ref EndArenaScope, while blocks allocated
+ * before it are left alone. Scopes can be nested.
+ * @param arena The arena to begin the scope within.
+ * @return The scope's marker.
+ */
+arena_scope_t BeginArenaScope(const arena_t* arena);
+
+/**
+ * @brief End a scope begun by @ref BeginArenaScope.
+ * @param arena The arena the scope was begun within.
+ * @param scope The scope's marker.
+ */
+void EndArenaScope(arena_t* arena, arena_scope_t scope);
+
+/**
+ * @brief Get the amount of bytes currently allocated from the arena.
+ * @param arena The arena.
+ * @return The amount of bytes in use, alignment padding included.
+ */
+size_t GetArenaUsage(const arena_t* arena);
+
+#endif // _MSENG_ARENA_MEMORY_SYSTEM_
@@ -38,12 +38,14 @@ void ResizeArray(array_t* array, size_t new_size)
     if (array->occupied > new_size)
     {
         ReportWarning(array_implicit_data_free);
-        for (size_t i = array->occupied; i > new_size; i--)
+        for (size_t i = new_size; i < array->occupied; i++)
             FreeBlock(&array->_a[i]);
         array->occupied = new_size;
     }
 
-    array->_a = realloc(array->_a, new_size);
+    ptr_t* resized_array = realloc(array->_a, new_size * sizeof(ptr_t));
+    if (resized_array == NULL) ReportError(allocation_failure);
+    array->_a = resized_array;
     array->size = new_size;
 }
 
@@ -61,8 +63,10 @@ void AddArrayValue(array_t* array, ptr_t value)
         ResizeArray(array, array->occupied + 1);
     }
 
+    // Allocate once and copy straight in; going through CopyBlock would
+    // free this block and allocate another.
     array->_a[array->occupied] = AllocateBlock(value.size);
-    CopyBlock(&array->_a[array->occupied], value);
+    SetBlockContents(&array->_a[array->occupied], value._p, value.size);
     array->occupied++;
 }
 
@@ -95,3 +99,95 @@ ptr_t* GetArrayTail(array_t array)
 {
     return &array._a[array.occupied - 1];
 }
+
+flat_array_t CreateFlatArray(size_t stride, size_t capacity)
+{
+    flat_array_t created_array = {{NULL, 0}, stride, 0, 0};
+    if (capacity > 0) ReserveFlatArray(&created_array, capacity);
+    return created_array;
+}
+
+void DestroyFlatArray(flat_array_t* array)
+{
+    if (array->_a._p != NULL) FreeBlock(&array->_a);
+    array->capacity = 0;
+    array->occupied = 0;
+}
+
+bool CheckFlatArrayValidity(flat_array_t array)
+{
+    return array.stride != 0 && array._a._p != NULL;
+}
+
+void ReserveFlatArray(flat_array_t* array, size_t capacity)
+{
+    if (capacity <= array->capacity) return;
+
+    if (array->_a._p == NULL)
+        array->_a = AllocateBlock(capacity * array->stride);
+    else ReallocateBlock(&array->_a, capacity * array->stride);
+    array->capacity = capacity;
+}
+
+void ShrinkFlatArray(flat_array_t* array)
+{
+    if (array->occupied == array->capacity) return;
+    if (array->occupied == 0)
+    {
+        DestroyFlatArray(array);
+        return;
+    }
+
+    ReallocateBlock(&array->_a, array->occupied * array->stride);
+    array->capacity = array->occupied;
+}
+
+void ClearFlatArray(flat_array_t* array) { array->occupied = 0; }
+
+/**
+ * @brief Grow the array, doubling its capacity until there's room for the
+ * given amount of elements.
+ * @param array The array to grow.
+ * @param required The amount of elements the array has to hold.
+ */
+static void GrowFlatArray(flat_array_t* array, size_t required)
+{
+    if (required <= array->capacity) return;
+
+    size_t capacity = array->capacity < 4 ? 4 : array->capacity;
+    while (capacity < required) capacity *= 2;
+    ReserveFlatArray(array, capacity);
+}
+
+void* AddFlatArrayValue(flat_array_t* array, const void* value)
+{
+    return AppendFlatArrayValues(array, value, 1);
+}
+
+void* AppendFlatArrayValues(flat_array_t* array, const void* values,
+                            size_t count)
+{
+    GrowFlatArray(array, array->occupied + count);
+
+    uint8_t* destination =
+        (uint8_t*)array->_a._p + array->occupied * array->stride;
+    memcpy(destination, values, count * array->stride);
+    array->occupied += count;
+    return destination;
+}
+
+void RemoveFlatArrayValue(flat_array_t* array, size_t index)
+{
+    if (index >= array->occupied) return;
+
+    array->occupied--;
+    if (index != array->occupied)
+        memcpy((uint8_t*)array->_a._p + index * array->stride,
+               (uint8_t*)array->_a._p + array->occupied * array->stride,
+               array->stride);
+}
+
+void* GetFlatArrayValue(flat_array_t array, size_t index)
+{
+    return (uint8_t*)array._a._p + index * array.stride;
+}
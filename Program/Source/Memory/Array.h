@@ -46,6 +46,35 @@ typedef struct
     size_t occupied;
 } array_t;
 
+/**
+ * @brief A flat, stride-based array. Unlike @ref array_t, every element is
+ * the same size and lives inline in one contiguous block, so walking the
+ * array is a linear read rather than a pointer chase. Pointers into the
+ * array are only stable until it next grows; reserve up front if they
+ * need to outlive that.
+ */
+typedef struct
+{
+    /**
+     * @brief The contents of the array. @warning The same caveats as
+     * @ref array_t::_a apply.
+     */
+    ptr_t _a;
+    /**
+     * @brief The size of a single element in bytes.
+     */
+    size_t stride;
+    /**
+     * @brief The amount of elements the array can hold before it has to
+     * grow.
+     */
+    size_t capacity;
+    /**
+     * @brief The amount of elements in the array.
+     */
+    size_t occupied;
+} flat_array_t;
+
 array_t CreateArray(size_t size);
 
 void DestroyArray(array_t* array);
@@ -61,4 +90,86 @@ ptr_t* GetArrayValue(array_t array, size_t index);
 
 ptr_t* GetArrayTail(array_t array);
 
+/**
+ * @brief Create a flat array.
+ * @param stride The size of a single element in bytes.
+ * @param capacity The amount of elements to make room for up front. This
+ * can be 0, in which case nothing is allocated until the first push.
+ * @return The created array.
+ */
+flat_array_t CreateFlatArray(size_t stride, size_t capacity);
+
+/**
+ * @brief Destroy a flat array, freeing its contents.
+ * @param array The array to destroy.
+ */
+void DestroyFlatArray(flat_array_t* array);
+
+/**
+ * @brief Check that a flat array has been created.
+ * @param array The array to check.
+ * @return true The array is usable.
+ * @return false The array has not been created, or has been destroyed.
+ */
+bool CheckFlatArrayValidity(flat_array_t array);
+
+/**
+ * @brief Make sure the array can hold at least the given amount of
+ * elements without growing. This never shrinks the array.
+ * @param array The array to reserve space within.
+ * @param capacity The amount of elements to make room for.
+ */
+void ReserveFlatArray(flat_array_t* array, size_t capacity);
+
+/**
+ * @brief Shrink the array's allocation down to exactly the amount of
+ * elements it holds.
+ * @param array The array to shrink.
+ */
+void ShrinkFlatArray(flat_array_t* array);
+
+/**
+ * @brief Empty the array without giving back its allocation, so it can be
+ * refilled without growing again.
+ * @param array The array to clear.
+ */
+void ClearFlatArray(flat_array_t* array);
+
+/**
+ * @brief Push an element onto the end of the array, growing the array
+ * geometrically if it's full.
+ * @param array The array to push onto.
+ * @param value The element to copy in. This must be @ref
+ * flat_array_t::stride bytes long.
+ * @return A pointer to the element within the array.
+ */
+void* AddFlatArrayValue(flat_array_t* array, const void* value);
+
+/**
+ * @brief Push several elements onto the end of the array at once, growing
+ * the array no more than once.
+ * @param array The array to push onto.
+ * @param values The elements to copy in, packed back to back.
+ * @param count The amount of elements.
+ * @return A pointer to the first of the elements within the array.
+ */
+void* AppendFlatArrayValues(flat_array_t* array, const void* values,
+                            size_t count);
+
+/**
+ * @brief Remove an element by moving the last element into its place.
+ * This is constant time, but doesn't keep the array's order.
+ * @param array The array to remove from.
+ * @param index The index of the element to remove.
+ */
+void RemoveFlatArrayValue(flat_array_t* array, size_t index);
+
+/**
+ * @brief Get a pointer to an element of the array.
+ * @param array The array.
+ * @param index The index of the element.
+ * @return A pointer to the element.
+ */
+void* GetFlatArrayValue(flat_array_t array, size_t index);
+
 #endif // _MSENG_ARRAY_
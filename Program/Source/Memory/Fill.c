@@ -1,9 +1,413 @@
 #include "Fill.h"
+#include <Output/System.h> // Error reporting
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h> // SIMD intrinsics
+#define FILL_X86
+#endif
+
+/**
+ * @brief One variant of the fill/copy kernels. Every kernel takes a flag
+ * saying whether it should stream its stores past the cache.
+ */
+typedef struct
+{
+    void (*fill)(uint32_t* destination, uint32_t value, size_t count,
+                 bool stream);
+    void (*copy)(uint8_t* destination, const uint8_t* source, size_t size,
+                 bool stream);
+} fill_kernels_t;
+
+static void FillScalar(uint32_t* destination, uint32_t value, size_t count,
+                       bool stream)
+{
+    // Get to an 8-byte boundary, then write two pixels at a time.
+    if (count > 0 && ((uintptr_t)destination & 7) != 0)
+        *destination++ = value, count--;
+
+    uint64_t pattern = (uint64_t)value << 32 | value;
+    for (size_t i = 0; i + 2 <= count; i += 2)
+        memcpy(destination + i, &pattern, 8);
+    if (count & 1) destination[count - 1] = value;
+}
+
+static void CopyScalar(uint8_t* destination, const uint8_t* source,
+                       size_t size, bool stream)
+{
+    memcpy(destination, source, size);
+}
+
+#ifdef FILL_X86
+__attribute__((target("sse2"))) static void
+FillSSE2(uint32_t* destination, uint32_t value, size_t count, bool stream)
+{
+    while (count > 0 && ((uintptr_t)destination & 15) != 0)
+        *destination++ = value, count--;
+
+    __m128i vector = _mm_set1_epi32((int)value);
+    size_t i = 0;
+    if (stream)
+    {
+        for (; i + 16 <= count; i += 16)
+        {
+            _mm_stream_si128((__m128i*)(destination + i), vector);
+            _mm_stream_si128((__m128i*)(destination + i + 4), vector);
+            _mm_stream_si128((__m128i*)(destination + i + 8), vector);
+            _mm_stream_si128((__m128i*)(destination + i + 12), vector);
+        }
+        _mm_sfence();
+    }
+    else
+    {
+        for (; i + 16 <= count; i += 16)
+        {
+            _mm_store_si128((__m128i*)(destination + i), vector);
+            _mm_store_si128((__m128i*)(destination + i + 4), vector);
+            _mm_store_si128((__m128i*)(destination + i + 8), vector);
+            _mm_store_si128((__m128i*)(destination + i + 12), vector);
+        }
+    }
+    for (; i + 4 <= count; i += 4)
+        _mm_store_si128((__m128i*)(destination + i), vector);
+    for (; i < count; i++) destination[i] = value;
+}
+
+__attribute__((target("sse2"))) static void
+CopySSE2(uint8_t* destination, const uint8_t* source, size_t size,
+         bool stream)
+{
+    size_t head = (16 - ((uintptr_t)destination & 15)) & 15;
+    if (head > size) head = size;
+    memcpy(destination, source, head);
+    destination += head, source += head, size -= head;
+
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(source + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(source + i + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(source + i + 32));
+        __m128i d = _mm_loadu_si128((const __m128i*)(source + i + 48));
+        if (stream)
+        {
+            _mm_stream_si128((__m128i*)(destination + i), a);
+            _mm_stream_si128((__m128i*)(destination + i + 16), b);
+            _mm_stream_si128((__m128i*)(destination + i + 32), c);
+            _mm_stream_si128((__m128i*)(destination + i + 48), d);
+        }
+        else
+        {
+            _mm_store_si128((__m128i*)(destination + i), a);
+            _mm_store_si128((__m128i*)(destination + i + 16), b);
+            _mm_store_si128((__m128i*)(destination + i + 32), c);
+            _mm_store_si128((__m128i*)(destination + i + 48), d);
+        }
+    }
+    if (stream) _mm_sfence();
+    memcpy(destination + i, source + i, size - i);
+}
+
+__attribute__((target("avx2"))) static void
+FillAVX2(uint32_t* destination, uint32_t value, size_t count, bool stream)
+{
+    while (count > 0 && ((uintptr_t)destination & 31) != 0)
+        *destination++ = value, count--;
+
+    __m256i vector = _mm256_set1_epi32((int)value);
+    size_t i = 0;
+    if (stream)
+    {
+        for (; i + 32 <= count; i += 32)
+        {
+            _mm256_stream_si256((__m256i*)(destination + i), vector);
+            _mm256_stream_si256((__m256i*)(destination + i + 8), vector);
+            _mm256_stream_si256((__m256i*)(destination + i + 16), vector);
+            _mm256_stream_si256((__m256i*)(destination + i + 24), vector);
+        }
+        _mm_sfence();
+    }
+    else
+    {
+        for (; i + 32 <= count; i += 32)
+        {
+            _mm256_store_si256((__m256i*)(destination + i), vector);
+            _mm256_store_si256((__m256i*)(destination + i + 8), vector);
+            _mm256_store_si256((__m256i*)(destination + i + 16), vector);
+            _mm256_store_si256((__m256i*)(destination + i + 24), vector);
+        }
+    }
+    for (; i + 8 <= count; i += 8)
+        _mm256_store_si256((__m256i*)(destination + i), vector);
+    for (; i < count; i++) destination[i] = value;
+}
+
+__attribute__((target("avx2"))) static void
+CopyAVX2(uint8_t* destination, const uint8_t* source, size_t size,
+         bool stream)
+{
+    size_t head = (32 - ((uintptr_t)destination & 31)) & 31;
+    if (head > size) head = size;
+    memcpy(destination, source, head);
+    destination += head, source += head, size -= head;
+
+    size_t i = 0;
+    for (; i + 128 <= size; i += 128)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(source + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(source + i + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(source + i + 64));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(source + i + 96));
+        if (stream)
+        {
+            _mm256_stream_si256((__m256i*)(destination + i), a);
+            _mm256_stream_si256((__m256i*)(destination + i + 32), b);
+            _mm256_stream_si256((__m256i*)(destination + i + 64), c);
+            _mm256_stream_si256((__m256i*)(destination + i + 96), d);
+        }
+        else
+        {
+            _mm256_store_si256((__m256i*)(destination + i), a);
+            _mm256_store_si256((__m256i*)(destination + i + 32), b);
+            _mm256_store_si256((__m256i*)(destination + i + 64), c);
+            _mm256_store_si256((__m256i*)(destination + i + 96), d);
+        }
+    }
+    if (stream) _mm_sfence();
+    memcpy(destination + i, source + i, size - i);
+}
+
+__attribute__((target("avx512f"))) static void
+FillAVX512(uint32_t* destination, uint32_t value, size_t count,
+           bool stream)
+{
+    while (count > 0 && ((uintptr_t)destination & 63) != 0)
+        *destination++ = value, count--;
+
+    __m512i vector = _mm512_set1_epi32((int)value);
+    size_t i = 0;
+    if (stream)
+    {
+        for (; i + 64 <= count; i += 64)
+        {
+            _mm512_stream_si512((void*)(destination + i), vector);
+            _mm512_stream_si512((void*)(destination + i + 16), vector);
+            _mm512_stream_si512((void*)(destination + i + 32), vector);
+            _mm512_stream_si512((void*)(destination + i + 48), vector);
+        }
+        _mm_sfence();
+    }
+    else
+    {
+        for (; i + 64 <= count; i += 64)
+        {
+            _mm512_store_si512((void*)(destination + i), vector);
+            _mm512_store_si512((void*)(destination + i + 16), vector);
+            _mm512_store_si512((void*)(destination + i + 32), vector);
+            _mm512_store_si512((void*)(destination + i + 48), vector);
+        }
+    }
+    for (; i + 16 <= count; i += 16)
+        _mm512_store_si512((void*)(destination + i), vector);
+    for (; i < count; i++) destination[i] = value;
+}
+
+__attribute__((target("avx512f"))) static void
+CopyAVX512(uint8_t* destination, const uint8_t* source, size_t size,
+           bool stream)
+{
+    size_t head = (64 - ((uintptr_t)destination & 63)) & 63;
+    if (head > size) head = size;
+    memcpy(destination, source, head);
+    destination += head, source += head, size -= head;
+
+    size_t i = 0;
+    for (; i + 256 <= size; i += 256)
+    {
+        __m512i a = _mm512_loadu_si512((const void*)(source + i));
+        __m512i b = _mm512_loadu_si512((const void*)(source + i + 64));
+        __m512i c = _mm512_loadu_si512((const void*)(source + i + 128));
+        __m512i d = _mm512_loadu_si512((const void*)(source + i + 192));
+        if (stream)
+        {
+            _mm512_stream_si512((void*)(destination + i), a);
+            _mm512_stream_si512((void*)(destination + i + 64), b);
+            _mm512_stream_si512((void*)(destination + i + 128), c);
+            _mm512_stream_si512((void*)(destination + i + 192), d);
+        }
+        else
+        {
+            _mm512_store_si512((void*)(destination + i), a);
+            _mm512_store_si512((void*)(destination + i + 64), b);
+            _mm512_store_si512((void*)(destination + i + 128), c);
+            _mm512_store_si512((void*)(destination + i + 192), d);
+        }
+    }
+    if (stream) _mm_sfence();
+    memcpy(destination + i, source + i, size - i);
+}
+#endif
+
+/**
+ * @brief Every kernel variant, indexed by @ref fill_variant_t. Variants
+ * this architecture has no kernels for fall back to plain C.
+ */
+static const fill_kernels_t kernel_table[fill_variant_count] = {
+    [fill_scalar] = {FillScalar, CopyScalar},
+#ifdef FILL_X86
+    [fill_sse2] = {FillSSE2, CopySSE2},
+    [fill_avx2] = {FillAVX2, CopyAVX2},
+    [fill_avx512] = {FillAVX512, CopyAVX512},
+#else
+    [fill_sse2] = {FillScalar, CopyScalar},
+    [fill_avx2] = {FillScalar, CopyScalar},
+    [fill_avx512] = {FillScalar, CopyScalar},
+#endif
+};
+
+static const char* variant_names[fill_variant_count] = {
+    [fill_scalar] = "scalar",
+    [fill_sse2] = "sse2",
+    [fill_avx2] = "avx2",
+    [fill_avx512] = "avx512"};
+
+/**
+ * @brief The variant in use.
+ */
+static fill_variant_t current_variant = fill_scalar;
+
+/**
+ * @brief Makes sure the variant is only picked once, no matter how many
+ * threads get to the kernels at the same time.
+ */
+static pthread_once_t variant_selected = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Pick the widest variant this CPU supports.
+ */
+static void SelectFillVariant(void)
+{
+    for (fill_variant_t variant = fill_avx512; variant > fill_scalar;
+         variant--)
+    {
+        if (CheckFillVariantSupport(variant))
+        {
+            current_variant = variant;
+            return;
+        }
+    }
+    current_variant = fill_scalar;
+}
+
+/**
+ * @brief Get the kernels of the variant in use, picking one first if that
+ * hasn't been done yet.
+ * @return The kernels.
+ */
+static const fill_kernels_t* GetKernels(void)
+{
+    pthread_once(&variant_selected, SelectFillVariant);
+    return &kernel_table[current_variant];
+}
 
 void ZeroBlock(ptr_t* ptr) { memset(ptr->_p, 0, ptr->size); }
 void FillBlock(ptr_t* ptr, uint32_t value, size_t size)
 {
-    size_t i = 0;
-    for (; i < (size & (~7)); i += 4) memcpy(((char*)ptr) + i, &value, 4);
-    for (; i < size; i++) ((char*)ptr)[i] = ((char*)&value)[i & 7];
+    if (size > ptr->size) ReportError(memory_bound_mismatch);
+
+    size_t count = size / 4;
+    GetKernels()->fill(ptr->_p, value, count,
+                       size >= FILL_STREAM_THRESHOLD);
+    // Whatever's left over is the start of the pattern.
+    memcpy((uint8_t*)ptr->_p + count * 4, &value, size & 3);
+}
+
+void FillPixels(void* destination, uint32_t value, size_t count)
+{
+    GetKernels()->fill(destination, value, count,
+                       count * 4 >= FILL_STREAM_THRESHOLD);
+}
+
+void FillPixelRect(void* destination, size_t stride, uint32_t width,
+                   uint32_t height, uint32_t value)
+{
+    const fill_kernels_t* kernels = GetKernels();
+    bool stream = (size_t)width * height * 4 >= FILL_STREAM_THRESHOLD;
+
+    // A rectangle spanning whole rows is really just one long run.
+    if (stride == (size_t)width * 4)
+    {
+        kernels->fill(destination, value, (size_t)width * height, stream);
+        return;
+    }
+
+    uint8_t* row = destination;
+    for (uint32_t y = 0; y < height; y++, row += stride)
+        kernels->fill((uint32_t*)row, value, width, stream);
+}
+
+void CopyPixels(void* destination, const void* source, size_t size)
+{
+    GetKernels()->copy(destination, source, size,
+                       size >= FILL_STREAM_THRESHOLD);
+}
+
+void CopyPixelRect(void* destination, size_t destination_stride,
+                   const void* source, size_t source_stride,
+                   uint32_t width, uint32_t height)
+{
+    const fill_kernels_t* kernels = GetKernels();
+    size_t row_size = (size_t)width * 4;
+    bool stream = row_size * height >= FILL_STREAM_THRESHOLD;
+
+    if (destination_stride == row_size && source_stride == row_size)
+    {
+        kernels->copy(destination, source, row_size * height, stream);
+        return;
+    }
+
+    uint8_t* destination_row = destination;
+    const uint8_t* source_row = source;
+    for (uint32_t y = 0; y < height; y++)
+    {
+        kernels->copy(destination_row, source_row, row_size, stream);
+        destination_row += destination_stride;
+        source_row += source_stride;
+    }
+}
+
+bool CheckFillVariantSupport(fill_variant_t variant)
+{
+    switch (variant)
+    {
+        case fill_scalar: return true;
+#ifdef FILL_X86
+        case fill_sse2:   return __builtin_cpu_supports("sse2");
+        case fill_avx2:   return __builtin_cpu_supports("avx2");
+        case fill_avx512: return __builtin_cpu_supports("avx512f");
+#endif
+        default:          return false;
+    }
+}
+
+bool SetFillVariant(fill_variant_t variant)
+{
+    pthread_once(&variant_selected, SelectFillVariant);
+    if (variant >= fill_variant_count || !CheckFillVariantSupport(variant))
+        return false;
+
+    current_variant = variant;
+    return true;
+}
+
+fill_variant_t GetFillVariant(void)
+{
+    pthread_once(&variant_selected, SelectFillVariant);
+    return current_variant;
+}
+
+const char* GetFillVariantName(fill_variant_t variant)
+{
+    if (variant >= fill_variant_count) return "unknown";
+    return variant_names[variant];
 }
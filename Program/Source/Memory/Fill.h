@@ -1,7 +1,10 @@
 /**
  * @file Fill.h
  * @author Israfiel (https://github.com/israfiel-a)
- * @brief Provides utility for filling blocks of memory.
+ * @brief Provides utility for filling blocks of memory, and the fill/copy
+ * kernels behind pixel buffer clears and blits. The kernels come in
+ * several instruction set variants, the best of which is chosen the first
+ * time one is used.
  * @date 2024-08-08
  *
  * @copyright (c) 2024 - Israfiel
@@ -12,7 +15,124 @@
 
 #include "Allocate.h"
 
+/**
+ * @brief The size, in bytes, past which fills and copies bypass the cache
+ * with non-temporal stores. Anything this big would only evict everything
+ * else from the cache on its way through.
+ */
+#define FILL_STREAM_THRESHOLD (1024 * 1024)
+
+/**
+ * @brief The instruction set variants of the fill kernels.
+ */
+typedef enum
+{
+    /**
+     * @brief Plain C. This is always supported.
+     */
+    fill_scalar,
+    /**
+     * @brief 128-bit SSE2 vectors.
+     */
+    fill_sse2,
+    /**
+     * @brief 256-bit AVX2 vectors.
+     */
+    fill_avx2,
+    /**
+     * @brief 512-bit AVX-512 vectors.
+     */
+    fill_avx512,
+    /**
+     * @brief The amount of variants. Not a variant itself.
+     */
+    fill_variant_count
+} fill_variant_t;
+
 void ZeroBlock(ptr_t* ptr);
+
+/**
+ * @brief Fill the first @param size bytes of a block with a repeating
+ * 32-bit pattern. If the size isn't a multiple of four, the last few
+ * bytes are the start of the pattern.
+ * @param ptr The block to fill.
+ * @param value The pattern to fill with.
+ * @param size The amount of bytes to fill. If this is larger than the
+ * block, the fatal @enum memory_bound_mismatch is raised.
+ */
 void FillBlock(ptr_t* ptr, uint32_t value, size_t size);
 
+/**
+ * @brief Fill a run of 32-bit pixels with one value.
+ * @param destination The first pixel. This must be 4-byte aligned.
+ * @param value The value to fill with.
+ * @param count The amount of pixels.
+ */
+void FillPixels(void* destination, uint32_t value, size_t count);
+
+/**
+ * @brief Fill a rectangle of 32-bit pixels with one value.
+ * @param destination The top-left pixel of the rectangle. This must be
+ * 4-byte aligned.
+ * @param stride The distance between rows, in bytes.
+ * @param width The width of the rectangle in pixels.
+ * @param height The height of the rectangle in pixels.
+ * @param value The value to fill with.
+ */
+void FillPixelRect(void* destination, size_t stride, uint32_t width,
+                   uint32_t height, uint32_t value);
+
+/**
+ * @brief Copy a run of bytes. The two runs must not overlap.
+ * @param destination Where to copy to.
+ * @param source Where to copy from.
+ * @param size The amount of bytes.
+ */
+void CopyPixels(void* destination, const void* source, size_t size);
+
+/**
+ * @brief Copy a rectangle of 32-bit pixels between two buffers. The two
+ * rectangles must not overlap.
+ * @param destination The top-left pixel to copy to.
+ * @param destination_stride The distance between the destination's rows,
+ * in bytes.
+ * @param source The top-left pixel to copy from.
+ * @param source_stride The distance between the source's rows, in bytes.
+ * @param width The width of the rectangle in pixels.
+ * @param height The height of the rectangle in pixels.
+ */
+void CopyPixelRect(void* destination, size_t destination_stride,
+                   const void* source, size_t source_stride,
+                   uint32_t width, uint32_t height);
+
+/**
+ * @brief Check if this CPU can run a given kernel variant.
+ * @param variant The variant to check.
+ * @return true The variant can be used.
+ * @return false The variant can't be used.
+ */
+bool CheckFillVariantSupport(fill_variant_t variant);
+
+/**
+ * @brief Force the kernels to a given variant. This is mostly useful for
+ * benchmarking; by default the best supported variant is used.
+ * @param variant The variant to use.
+ * @return true The variant is now in use.
+ * @return false This CPU can't run the variant, and nothing was changed.
+ */
+bool SetFillVariant(fill_variant_t variant);
+
+/**
+ * @brief Get the kernel variant currently in use.
+ * @return The variant.
+ */
+fill_variant_t GetFillVariant(void);
+
+/**
+ * @brief Get the name of a kernel variant, for reporting.
+ * @param variant The variant.
+ * @return The variant's name.
+ */
+const char* GetFillVariantName(fill_variant_t variant);
+
 #endif // _MSENG_FILL_MEMORY_SYSTEM_
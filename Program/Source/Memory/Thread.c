@@ -1,4 +1,5 @@
 #include "Thread.h"
+#include <Diagnostic/Time.h> // Contention zones
 #include <Output/Error.h>
 #include <errno.h>
 
@@ -16,3 +17,12 @@ const pthread_t CreateThread(void* (*func)(void*), void* args)
 
     return thread;
 }
+
+void LockMutex(pthread_mutex_t* mutex, const char* zone)
+{
+    if (pthread_mutex_trylock(mutex) == 0) return;
+
+    BeginZone(zone);
+    pthread_mutex_lock(mutex);
+    EndZone();
+}
@@ -14,4 +14,13 @@
 
 const pthread_t CreateThread(void* (*func)(void*), void* args);
 
+/**
+ * @brief Lock a mutex, timing the wait as a zone if somebody else is
+ * holding it. An uncontended lock records nothing, so this is no more
+ * expensive than locking the mutex directly.
+ * @param mutex The mutex.
+ * @param zone The name of the zone, which must outlive the program.
+ */
+void LockMutex(pthread_mutex_t* mutex, const char* zone);
+
 #endif // _MSENG_THREAD_MEMORY_SYSTEM_
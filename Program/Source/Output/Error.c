@@ -1,4 +1,5 @@
 #include "Error.h"
+#include "Messages.h"
 #include <Globals.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -25,6 +26,7 @@ static const error_t errors[] = {
     [free_failure] = {program_error, "null pointer passed to free"},
     [memory_bound_mismatch] = {os_error,
                                "smaller area to copy into than copy size"},
+    [arena_exhaustion] = {program_error, "arena ran out of space"},
     [mmap_failure] = {os_error, "failed to map memory"},
     [unmmap_failure] = {os_error, "failed to unmap memory"},
     [shm_open_failure] = {program_error, "failed to open shm file"},
@@ -61,6 +63,10 @@ static const error_t errors[] = {
                                  "failed to bind the OpenGL api"},
     [opengl_shader_creation_failure] =
         {program_error, "failed to create an opengl shader object"},
+    [shader_source_missing] = {program_error,
+                               "failed to find a shader's source"},
+    [shader_registry_exhaustion] = {program_error,
+                                    "too many shader programs loaded"},
     [thread_no_resources] = {program_error,
                              "no resources to create a new thread"},
     [thread_open_denied] = {external_error, "new thread creation denied"}};
@@ -69,6 +75,8 @@ _Noreturn void ReportError_(const char* file, const char* function,
                             uint64_t line, error_code_t code)
 {
     error_t err = errors[code];
+    // Anything logged before the error should show up before it.
+    FlushMessages();
     // if (global_flags.stdout_available || err.severity != program_error)
     // {
     fprintf(stderr,
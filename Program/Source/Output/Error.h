@@ -18,6 +18,7 @@ typedef enum
     allocation_failure,
     free_failure,
     memory_bound_mismatch,
+    arena_exhaustion,
     mmap_failure,
     unmmap_failure,
     shm_open_failure,
@@ -39,6 +40,8 @@ typedef enum
     egl_swap_buffer_failure,
     opengl_api_bind_failure,
     opengl_shader_creation_failure,
+    shader_source_missing,
+    shader_registry_exhaustion,
     thread_no_resources,
     thread_open_denied
 } error_code_t;
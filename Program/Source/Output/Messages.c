@@ -2,8 +2,17 @@
 #include "System.h"
 #include <Diagnostic/Time.h>
 #include <Globals.h>
+#include <Memory/Thread.h> // Flusher thread creation
+#include <poll.h>
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/types.h>
 #include <unistd.h>
 
 /**
@@ -48,19 +57,680 @@ void LogNotification(const char* title, const char* body, ...)
     (void)SystemCall(error_system_call);
 }
 
+/**
+ * @brief What a conversion within a format string reads.
+ */
+typedef enum
+{
+    signed_conversion,
+    unsigned_conversion,
+    real_conversion,
+    character_conversion,
+    string_conversion,
+    pointer_conversion,
+    percent_conversion,
+    /**
+     * @brief Anything we don't know how to read, which ends the message.
+     */
+    unknown_conversion
+} conversion_kind_t;
+
+/**
+ * @brief The length modifier of a conversion.
+ */
+typedef enum
+{
+    no_length,
+    char_length,
+    short_length,
+    long_length,
+    long_long_length,
+    size_length,
+    max_length,
+    ptrdiff_length,
+    long_double_length
+} conversion_length_t;
+
+/**
+ * @brief A single conversion within a format string, as read by @ref
+ * ReadConversion.
+ */
+typedef struct
+{
+    conversion_kind_t kind;
+    conversion_length_t length;
+    /**
+     * @brief The flags, width, and precision, exactly as written.
+     */
+    const char* options;
+    size_t options_length;
+    /**
+     * @brief Whether the width and precision are taken from arguments.
+     */
+    bool width_argument;
+    bool precision_argument;
+    char conversion;
+} conversion_t;
+
+/**
+ * @brief A single argument, copied as it was given.
+ */
+typedef union
+{
+    uint64_t integer;
+    double real;
+    const void* pointer;
+} message_argument_t;
+
+/**
+ * @brief A message waiting to be written.
+ */
+typedef struct
+{
+    /**
+     * @brief Where the slot is in its cycle around the ring. This is the
+     * slot's position while it's free, one more than that once a message
+     * is in it, and the position of its next lap once it's written.
+     */
+    atomic_size_t sequence;
+    uint64_t time;
+    const char* format;
+    size_t argument_count;
+    message_argument_t arguments[MESSAGE_ARGUMENT_LIMIT];
+    /**
+     * @brief The strings the message was given, one after another. String
+     * arguments hold their offset into this.
+     */
+    char strings[MESSAGE_STRING_SPACE];
+} message_record_t;
+
+/**
+ * @brief The ring of messages waiting to be written.
+ */
+static message_record_t message_ring[MESSAGE_RING_SIZE];
+
+/**
+ * @brief The position the next message will be recorded at. Producers
+ * claim positions by moving this forward.
+ */
+static atomic_size_t enqueue_position = 0;
+
+/**
+ * @brief The position of the next message to write. This is only touched
+ * with @ref flush_mutex held.
+ */
+static size_t dequeue_position = 0;
+
+/**
+ * @brief The messages dropped since the last time the flusher said so,
+ * and over the whole run.
+ */
+static atomic_size_t dropped_recently = 0, dropped_total = 0;
+
+/**
+ * @brief Keeps more than one thread from writing messages at once, so
+ * they always come out in order.
+ */
+static pthread_mutex_t flush_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Makes sure the ring and flusher are only set up once.
+ */
+static pthread_once_t flusher_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief When the first message was recorded, in nanoseconds. Message
+ * times are written relative to this.
+ */
+static uint64_t message_origin = 0;
+
+/**
+ * @brief The flusher thread, and whether it should keep running.
+ */
+static pthread_t flusher_thread;
+static atomic_bool flusher_running = false;
+
+/**
+ * @brief What the flusher sleeps on, or -1 if it couldn't be made, and
+ * whether it's asleep. Only the first message to land while the flusher is
+ * asleep pays for waking it.
+ */
+static int flusher_wake_fd = -1;
+static atomic_bool flusher_sleeping = false;
+
+/**
+ * @brief Read the conversion at the start of a format string.
+ * @param format The format string, just past the '%'.
+ * @param conversion Where to write what was read.
+ * @return The rest of the format string, past the conversion.
+ */
+static const char* ReadConversion(const char* format,
+                                  conversion_t* conversion)
+{
+    *conversion = (conversion_t){unknown_conversion, no_length, format, 0,
+                                 false, false, '\0'};
+
+    while (*format == '-' || *format == '+' || *format == ' ' ||
+           *format == '#' || *format == '0' || *format == '\'')
+        format++;
+    if (*format == '*')
+    {
+        conversion->width_argument = true;
+        format++;
+    }
+    else
+        while (*format >= '0' && *format <= '9') format++;
+    if (*format == '.')
+    {
+        format++;
+        if (*format == '*')
+        {
+            conversion->precision_argument = true;
+            format++;
+        }
+        else
+            while (*format >= '0' && *format <= '9') format++;
+    }
+    conversion->options_length = format - conversion->options;
+
+    switch (*format)
+    {
+        case 'h': conversion->length = short_length; break;
+        case 'l': conversion->length = long_length; break;
+        case 'z': conversion->length = size_length; break;
+        case 'j': conversion->length = max_length; break;
+        case 't': conversion->length = ptrdiff_length; break;
+        case 'L': conversion->length = long_double_length; break;
+        default:  break;
+    }
+    if (conversion->length != no_length) format++;
+    // hh and ll are the doubled-up versions of h and l.
+    if (conversion->length == short_length && *format == 'h')
+    {
+        conversion->length = char_length;
+        format++;
+    }
+    else if (conversion->length == long_length && *format == 'l')
+    {
+        conversion->length = long_long_length;
+        format++;
+    }
+
+    conversion->conversion = *format;
+    switch (*format)
+    {
+        case 'd':
+        case 'i': conversion->kind = signed_conversion; break;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X': conversion->kind = unsigned_conversion; break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A': conversion->kind = real_conversion; break;
+        case 'c': conversion->kind = character_conversion; break;
+        case 's': conversion->kind = string_conversion; break;
+        case 'p': conversion->kind = pointer_conversion; break;
+        case '%': conversion->kind = percent_conversion; break;
+        default:  return format;
+    }
+    return format + 1;
+}
+
+/**
+ * @brief Copy a signed integer argument, the way its length says it was
+ * passed.
+ */
+static int64_t ReadSignedArgument(conversion_length_t length,
+                                  va_list* args)
+{
+    switch (length)
+    {
+        case char_length:  return (signed char)va_arg(*args, int);
+        case short_length: return (short)va_arg(*args, int);
+        case long_length:  return va_arg(*args, long);
+        case long_long_length: return va_arg(*args, long long);
+        case size_length:      return va_arg(*args, ssize_t);
+        case max_length:       return va_arg(*args, intmax_t);
+        case ptrdiff_length:   return va_arg(*args, ptrdiff_t);
+        default:               return va_arg(*args, int);
+    }
+}
+
+/**
+ * @brief Copy an unsigned integer argument, the way its length says it
+ * was passed.
+ */
+static uint64_t ReadUnsignedArgument(conversion_length_t length,
+                                     va_list* args)
+{
+    switch (length)
+    {
+        case char_length:  return (unsigned char)va_arg(*args, unsigned);
+        case short_length: return (unsigned short)va_arg(*args, unsigned);
+        case long_length:  return va_arg(*args, unsigned long);
+        case long_long_length: return va_arg(*args, unsigned long long);
+        case size_length:      return va_arg(*args, size_t);
+        case max_length:       return va_arg(*args, uintmax_t);
+        case ptrdiff_length:   return va_arg(*args, ptrdiff_t);
+        default:               return va_arg(*args, unsigned);
+    }
+}
+
+/**
+ * @brief Copy a string argument into a message's record, since the string
+ * might not outlive the call. Strings past the record's room are cut
+ * short.
+ * @param record The message's record.
+ * @param used The room already used by earlier strings.
+ * @param string The string.
+ * @return Where the copy is within the record's strings.
+ */
+static uint64_t CopyStringArgument(message_record_t* record, size_t* used,
+                                   const char* string)
+{
+    // Out of room; the last terminator stands in for an empty string.
+    if (*used == MESSAGE_STRING_SPACE) return MESSAGE_STRING_SPACE - 1;
+    if (string == NULL) string = "(null)";
+
+    size_t length = strlen(string);
+    const size_t room = MESSAGE_STRING_SPACE - *used - 1;
+    if (length > room) length = room;
+    memcpy(record->strings + *used, string, length);
+    record->strings[*used + length] = '\0';
+
+    const uint64_t offset = *used;
+    *used += length + 1;
+    return offset;
+}
+
+/**
+ * @brief Copy a message's arguments into its record. Reading stops at the
+ * first conversion we don't understand or once @ref
+ * MESSAGE_ARGUMENT_LIMIT is reached, and @ref FormatMessage stops at the
+ * same place.
+ * @param record The message's record.
+ * @param args The message's arguments.
+ */
+static void CaptureArguments(message_record_t* record, va_list* args)
+{
+    message_argument_t* arguments = record->arguments;
+    size_t count = 0, string_length = 0;
+
+    const char* format = record->format;
+    while ((format = strchr(format, '%')) != NULL)
+    {
+        conversion_t conversion;
+        format = ReadConversion(format + 1, &conversion);
+        if (conversion.kind == unknown_conversion) break;
+        if (conversion.kind == percent_conversion) continue;
+
+        const size_t needed = 1 + conversion.width_argument +
+                              conversion.precision_argument;
+        if (count + needed > MESSAGE_ARGUMENT_LIMIT) break;
+
+        if (conversion.width_argument)
+            arguments[count++].integer = va_arg(*args, int);
+        if (conversion.precision_argument)
+            arguments[count++].integer = va_arg(*args, int);
+
+        message_argument_t* argument = &arguments[count++];
+        switch (conversion.kind)
+        {
+            case signed_conversion:
+                argument->integer =
+                    ReadSignedArgument(conversion.length, args);
+                break;
+            case unsigned_conversion:
+                argument->integer =
+                    ReadUnsignedArgument(conversion.length, args);
+                break;
+            case real_conversion:
+                argument->real = conversion.length == long_double_length
+                                     ? va_arg(*args, long double)
+                                     : va_arg(*args, double);
+                break;
+            case character_conversion:
+                argument->integer = va_arg(*args, int);
+                break;
+            case pointer_conversion:
+                argument->pointer = va_arg(*args, void*);
+                break;
+            default:
+                argument->integer = CopyStringArgument(
+                    record, &string_length, va_arg(*args, const char*));
+                break;
+        }
+    }
+    record->argument_count = count;
+}
+
+/**
+ * @brief Format a recorded message, as printf would have when it was
+ * recorded.
+ * @param record The message's record.
+ * @param line Where to write the message.
+ * @param line_length The room in the line.
+ * @return The length of the message, which is always less than the room.
+ */
+static size_t FormatMessage(const message_record_t* record, char* line,
+                            size_t line_length)
+{
+    const message_argument_t* arguments = record->arguments;
+    size_t length = 0, argument = 0;
+
+    const char* format = record->format;
+    while (*format != '\0' && length < line_length - 1)
+    {
+        if (*format != '%')
+        {
+            line[length++] = *format++;
+            continue;
+        }
+
+        conversion_t conversion;
+        const char* next = ReadConversion(format + 1, &conversion);
+        if (conversion.kind == percent_conversion)
+        {
+            line[length++] = '%';
+            format = next;
+            continue;
+        }
+        const size_t needed = 1 + conversion.width_argument +
+                              conversion.precision_argument;
+        if (conversion.kind == unknown_conversion ||
+            argument + needed > record->argument_count)
+            break;
+
+        // Rebuild the conversion with its width and precision filled in,
+        // and every integer widened to the 64 bits it was copied as.
+        char specifier[64] = "%";
+        size_t specifier_length = 1;
+        for (size_t i = 0; i < conversion.options_length &&
+                           specifier_length < sizeof(specifier) - 24;
+             i++)
+        {
+            const char option = conversion.options[i];
+            if (option != '*')
+            {
+                specifier[specifier_length++] = option;
+                continue;
+            }
+            const int value = (int)arguments[argument++].integer;
+            // A negative precision is the same as none at all.
+            if (value < 0 && specifier[specifier_length - 1] == '.')
+                specifier_length--;
+            else
+                specifier_length += snprintf(
+                    specifier + specifier_length,
+                    sizeof(specifier) - specifier_length, "%d", value);
+        }
+        if (conversion.kind == signed_conversion ||
+            conversion.kind == unsigned_conversion)
+        {
+            specifier[specifier_length++] = 'l';
+            specifier[specifier_length++] = 'l';
+        }
+        specifier[specifier_length++] = conversion.conversion;
+        specifier[specifier_length] = '\0';
+
+        const message_argument_t* value = &arguments[argument++];
+        char* end = line + length;
+        const size_t room = line_length - length;
+        int written = 0;
+        switch (conversion.kind)
+        {
+            case signed_conversion:
+            case unsigned_conversion:
+                written = snprintf(end, room, specifier,
+                                   (long long)value->integer);
+                break;
+            case real_conversion:
+                written = snprintf(end, room, specifier, value->real);
+                break;
+            case character_conversion:
+                written = snprintf(end, room, specifier,
+                                   (int)value->integer);
+                break;
+            case pointer_conversion:
+                written = snprintf(end, room, specifier, value->pointer);
+                break;
+            default:
+                written = snprintf(end, room, specifier,
+                                   record->strings + value->integer);
+                break;
+        }
+        if (written > 0) length += written;
+        if (length > line_length - 1) length = line_length - 1;
+        format = next;
+    }
+
+    line[length] = '\0';
+    return length;
+}
+
+/**
+ * @brief Write a finished line to the terminal, in the message color and
+ * stamped with a time.
+ * @param time The time to stamp it with, as given by @ref
+ * GetCoarseTimeNS.
+ * @param line The line.
+ */
+static void WriteMessage(uint64_t time, const char* line)
+{
+    char time_string[16];
+    FormatTimeString((time - message_origin) / 1000000, time_string,
+                     sizeof(time_string));
+    printf("\033[32m[%s]%s\033[0m\n", time_string, line);
+}
+
+/**
+ * @brief Write every message that's finished being recorded, along with
+ * a note of any that were dropped. This must be called with @ref
+ * flush_mutex held.
+ * @return The amount of messages written.
+ */
+static size_t DrainMessages(void)
+{
+    static char line[MESSAGE_LINE_LENGTH];
+    size_t written = 0;
+    while (true)
+    {
+        message_record_t* record =
+            &message_ring[dequeue_position & (MESSAGE_RING_SIZE - 1)];
+        const size_t sequence =
+            atomic_load_explicit(&record->sequence, memory_order_acquire);
+        if (sequence != dequeue_position + 1) break;
+
+        FormatMessage(record, line, sizeof(line));
+        WriteMessage(record->time, line);
+        // Hand the slot back for its next lap around the ring.
+        atomic_store_explicit(&record->sequence,
+                              dequeue_position + MESSAGE_RING_SIZE,
+                              memory_order_release);
+        dequeue_position++;
+        written++;
+    }
+
+    const size_t dropped = atomic_exchange(&dropped_recently, 0);
+    if (dropped != 0)
+    {
+        snprintf(line, sizeof(line),
+                 " " FILENAME " :: %zu message(s) dropped, too many were "
+                 "waiting to be written",
+                 dropped);
+        WriteMessage(GetCoarseTimeNS(), line);
+    }
+
+    if (written != 0 || dropped != 0) fflush(stdout);
+    return written;
+}
+
+/**
+ * @brief Check whether a message is waiting to be written.
+ * @return true The next message in the ring is finished.
+ * @return false The ring is empty, or the next message is still being
+ * recorded.
+ */
+static bool CheckMessagesWaiting(void)
+{
+    pthread_mutex_lock(&flush_mutex);
+    const message_record_t* record =
+        &message_ring[dequeue_position & (MESSAGE_RING_SIZE - 1)];
+    const bool waiting =
+        atomic_load_explicit(&record->sequence, memory_order_acquire) ==
+        dequeue_position + 1;
+    pthread_mutex_unlock(&flush_mutex);
+    return waiting;
+}
+
+/**
+ * @brief Wake the flusher up if it's asleep.
+ */
+static void WakeMessageFlusher(void)
+{
+    if (flusher_wake_fd == -1) return;
+
+    const uint64_t wakeup = 1;
+    // A full counter means the flusher has plenty of wakeups waiting
+    // already, so a failed write loses nothing.
+    const ssize_t written =
+        write(flusher_wake_fd, &wakeup, sizeof(wakeup));
+    (void)written;
+}
+
+/**
+ * @brief The flusher thread, which writes messages in the background
+ * until the program exits.
+ */
+static void* FlushFunction(void* data)
+{
+    (void)data;
+    struct pollfd wake = {flusher_wake_fd, POLLIN, 0};
+    while (atomic_load(&flusher_running))
+    {
+        FlushMessages();
+
+        // Say we're going to sleep before the last look at the ring, so a
+        // message landing in between either is seen here or wakes us.
+        atomic_store(&flusher_sleeping, true);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (CheckMessagesWaiting())
+        {
+            atomic_store(&flusher_sleeping, false);
+            continue;
+        }
+
+        // Without the descriptor, poll just waits out the timeout.
+        if (poll(&wake, 1, MESSAGE_FLUSH_TIMEOUT) > 0)
+        {
+            uint64_t wakeups;
+            if (read(flusher_wake_fd, &wakeups, sizeof(wakeups)) == -1)
+                wake.fd = -1;
+        }
+        atomic_store(&flusher_sleeping, false);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Stop the flusher and write whatever it left behind. This is
+ * registered to run when the program exits.
+ */
+static void StopMessageFlusher(void)
+{
+    atomic_store(&flusher_running, false);
+    WakeMessageFlusher();
+    if (!pthread_equal(pthread_self(), flusher_thread))
+        pthread_join(flusher_thread, NULL);
+    FlushMessages();
+}
+
+/**
+ * @brief Set up the ring and start the flusher. This is only ever run
+ * once, by the first message.
+ */
+static void StartMessageFlusher(void)
+{
+    for (size_t i = 0; i < MESSAGE_RING_SIZE; i++)
+        atomic_init(&message_ring[i].sequence, i);
+    message_origin = GetCoarseTimeNS();
+    flusher_wake_fd = eventfd(0, EFD_CLOEXEC);
+
+    atomic_store(&flusher_running, true);
+    flusher_thread = CreateThread(FlushFunction, NULL);
+    atexit(StopMessageFlusher);
+}
+
 void ReportMessage_(const char* body, ...)
 {
     if (!global_flags.stdout_available) return;
+    pthread_once(&flusher_once, StartMessageFlusher);
 
-    char time[512] = "\033[32m[";
-    GetTimeString(time + 6, 511);
-    time[18] = ']';
-    printf("%s", time);
+    // Claim a slot. A slot whose sequence is behind our position is still
+    // holding a message from the last lap, which means the ring is full.
+    size_t position =
+        atomic_load_explicit(&enqueue_position, memory_order_relaxed);
+    message_record_t* record;
+    while (true)
+    {
+        record = &message_ring[position & (MESSAGE_RING_SIZE - 1)];
+        const size_t sequence =
+            atomic_load_explicit(&record->sequence, memory_order_acquire);
+        const intptr_t difference =
+            (intptr_t)sequence - (intptr_t)position;
+        if (difference == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(
+                    &enqueue_position, &position, position + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0)
+        {
+            atomic_fetch_add_explicit(&dropped_recently, 1,
+                                      memory_order_relaxed);
+            atomic_fetch_add_explicit(&dropped_total, 1,
+                                      memory_order_relaxed);
+            return;
+        }
+        else
+            position = atomic_load_explicit(&enqueue_position,
+                                            memory_order_relaxed);
+    }
 
+    // The coarse clock is plenty for a stamp shown in milliseconds, and
+    // costs far less than the precise one.
+    record->time = GetCoarseTimeNS();
+    record->format = body;
     va_list args;
     va_start(args, body);
-    vprintf(body, args);
-
-    printf("\033[0m\n");
+    CaptureArguments(record, &args);
     va_end(args);
+    atomic_store_explicit(&record->sequence, position + 1,
+                          memory_order_release);
+
+    // Pairs with the flusher's fence, so either it sees this message on
+    // its last look or we see it asleep.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&flusher_sleeping, memory_order_relaxed) &&
+        atomic_exchange(&flusher_sleeping, false))
+        WakeMessageFlusher();
+}
+
+void FlushMessages(void)
+{
+    pthread_mutex_lock(&flush_mutex);
+    DrainMessages();
+    pthread_mutex_unlock(&flush_mutex);
+}
+
+size_t GetDroppedMessageCount(void)
+{
+    return atomic_load_explicit(&dropped_total, memory_order_relaxed);
 }
@@ -12,6 +12,38 @@
 #define _MSENG_MESSAGE_OUTPUT_SYSTEM_
 
 #include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief The amount of messages that can be waiting to be written at once.
+ * Past this, new messages are dropped and counted. This must be a power
+ * of two.
+ */
+#define MESSAGE_RING_SIZE 1024
+
+/**
+ * @brief The most arguments a message keeps. Anything past this is left
+ * out of the message, along with the rest of its format string.
+ */
+#define MESSAGE_ARGUMENT_LIMIT 12
+
+/**
+ * @brief The room, in bytes, a message has for copies of the strings it
+ * was given. Strings past this are cut short.
+ */
+#define MESSAGE_STRING_SPACE 160
+
+/**
+ * @brief The longest a single written message can be, in bytes.
+ */
+#define MESSAGE_LINE_LENGTH 1024
+
+/**
+ * @brief The longest, in milliseconds, the flusher sleeps without being
+ * woken. Producers wake it as soon as there's something to write, so this
+ * is only a fallback.
+ */
+#define MESSAGE_FLUSH_TIMEOUT 1000
 
 /**
  * @brief Check for the @ref libnotify package on the user's system. This
@@ -38,11 +70,29 @@ void LogNotification(const char* title, const char* body, ...);
 /**
  * @brief Send a debug message to the terminal associated with the process.
  * If no terminal is associated with the process, simply return quietly.
+ * The message is only recorded here; its arguments are copied as they
+ * are, and a background thread formats and writes it soon after. This
+ * never blocks, so it's safe to call on hot paths.
  * @param body The meat of the log, also a format string for the variable
- * args.
+ * args. This must be a string literal, or otherwise outlive the program,
+ * since only its address is recorded. The @c %n conversion is not
+ * supported.
  */
 void ReportMessage_(const char* body, ...);
 
+/**
+ * @brief Write every message recorded so far, on the calling thread. This
+ * happens on its own before the program exits.
+ */
+void FlushMessages(void);
+
+/**
+ * @brief Get the amount of messages dropped because too many were
+ * waiting to be written.
+ * @return The amount of dropped messages.
+ */
+size_t GetDroppedMessageCount(void);
+
 /**
  * @brief A macro to make reporting a message both easier and look better
  * by providing an indication of where the file came from.
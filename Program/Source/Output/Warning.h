@@ -22,6 +22,7 @@ typedef enum
     null_array_push,
     array_implicit_resize,
     array_implicit_data_free,
+    arena_scope_mismatch,
 
     double_display_setup,
 
@@ -32,6 +33,7 @@ typedef enum
     preemptive_egl_context_free,
     preemptive_egl_context_create,
     unknown_egl_context,
+    late_egl_context_mode_set,
 
     preemptive_wm_creation,
     double_wm_creation,
@@ -59,7 +61,30 @@ typedef enum
 
     preemptive_shm_creation,
     double_shm_creation,
-    preemptive_shm_free
+    preemptive_shm_free,
+
+    preemptive_buffer_acquire,
+    exhausted_buffer_pools,
+
+    invalid_atlas_image,
+    oversized_atlas_image,
+    late_atlas_image,
+    double_atlas_build,
+
+    rejected_shader_binary,
+    unwritable_shader_cache,
+
+    invalid_shader_reload,
+    mismatched_atlas_reload,
+    unsupported_asset_reload,
+
+    incomplete_panel_target,
+
+    untimed_trace,
+    unwritable_trace,
+
+    excess_panel_creation,
+    excess_egl_context_creation
 } warning_code_t;
 
 typedef struct
@@ -0,0 +1,632 @@
+#include "Atlas.h"
+#include "State.h"
+#include <Diagnostic/Time.h> // Build timing
+#include <GLAD/opengl.h>     // OpenGL function prototypes
+#include <Input/File.h>      // Image file reading
+#include <Memory/Array.h>    // Image and page storage
+#include <Memory/Fill.h>     // Pixel copies
+#include <Output/System.h>   // Warning and message reporting
+#include <STBI/STBI.h>       // Image decoding
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief An image added to the atlas.
+ */
+typedef struct
+{
+    /**
+     * @brief The decoded pixels. These are freed once the image has been
+     * copied into its page.
+     */
+    ptr_t pixels;
+    /**
+     * @brief The position of the image's top-left corner within its page,
+     * in pixels.
+     */
+    uint32_t x;
+    uint32_t y;
+    /**
+     * @brief The file the image was loaded from, within @ref ATLAS_PATH,
+     * or a null block if it was added from memory.
+     */
+    ptr_t file;
+    /**
+     * @brief Where the image ended up, once the atlas is built.
+     */
+    atlas_region_t region;
+} atlas_image_t;
+
+/**
+ * @brief A single page of the atlas.
+ */
+typedef struct
+{
+    /**
+     * @brief The page's pixels. These are freed once the page has been
+     * uploaded, unless @ref SetAtlasPixelRetention says otherwise.
+     */
+    ptr_t pixels;
+    /**
+     * @brief The width of the page in pixels. While packing, this is the
+     * furthest right any image reaches.
+     */
+    uint32_t width;
+    /**
+     * @brief The height of the page in pixels. While packing, this is the
+     * furthest down any image reaches.
+     */
+    uint32_t height;
+    /**
+     * @brief The page's OpenGL texture, or 0 if it hasn't been uploaded.
+     */
+    uint32_t texture;
+    /**
+     * @brief A reloaded texture waiting to replace @ref texture, or 0.
+     */
+    atomic_uint_least32_t pending;
+} atlas_page_t;
+
+/**
+ * @brief A single segment of the skyline; a horizontal run of the page
+ * that's filled from the top down to @ref y.
+ */
+typedef struct
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+} atlas_skyline_node_t;
+
+/**
+ * @brief An image's size, alongside its index, for sorting the images
+ * before they're packed.
+ */
+typedef struct
+{
+    uint32_t width;
+    uint32_t height;
+    size_t index;
+} atlas_sort_entry_t;
+
+/**
+ * @brief Every image added to the atlas, in the order they were added.
+ */
+static flat_array_t images;
+
+/**
+ * @brief The atlas' pages.
+ */
+static flat_array_t pages;
+
+/**
+ * @brief Whether the image and page arrays have been created.
+ */
+static bool atlas_created = false;
+
+/**
+ * @brief Whether the atlas has been built.
+ */
+static bool atlas_built = false;
+
+/**
+ * @brief Whether page pixels are kept around after upload, so the pages
+ * can be rebuilt when an image is reloaded.
+ */
+static bool retain_pixels = false;
+
+/**
+ * @brief Guards the page pixels, which are written by reloads on the
+ * asset watcher's thread and read by uploads on the rendering thread.
+ */
+static pthread_mutex_t pixel_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief The time spent decoding images, in nanoseconds.
+ */
+static uint64_t decode_time = 0;
+
+/**
+ * @brief The skyline of the page currently being packed. Every node is at
+ * least a pixel wide, so there can never be more nodes than the page is
+ * pixels wide.
+ */
+static atlas_skyline_node_t skyline[ATLAS_PAGE_SIZE];
+
+/**
+ * @brief The amount of nodes in the skyline.
+ */
+static size_t skyline_length = 0;
+
+size_t AddAtlasPixels(const uint8_t* pixels, uint32_t width,
+                      uint32_t height)
+{
+    if (atlas_built)
+    {
+        ReportWarning(late_atlas_image);
+        return ATLAS_INVALID_IMAGE;
+    }
+
+    if (width == 0 || height == 0)
+    {
+        ReportWarning(invalid_atlas_image);
+        return ATLAS_INVALID_IMAGE;
+    }
+
+    if (!atlas_created)
+    {
+        images = CreateFlatArray(sizeof(atlas_image_t), 64);
+        pages = CreateFlatArray(sizeof(atlas_page_t), 4);
+        atlas_created = true;
+    }
+
+    atlas_image_t image = {AllocateBlock((size_t)width * height * 4),
+                           0,
+                           0,
+                           {NULL, 0},
+                           {ATLAS_INVALID_PAGE, width, height, {0}}};
+    SetBlockContents(&image.pixels, pixels, image.pixels.size);
+    AddFlatArrayValue(&images, &image);
+    return images.occupied - 1;
+}
+
+size_t AddAtlasImage(const uint8_t* data, size_t length)
+{
+    uint64_t start = GetCurrentTimeNS();
+    int width, height, channels;
+    uint8_t* pixels = stbi_load_from_memory(data, length, &width, &height,
+                                            &channels, 4);
+    decode_time += GetCurrentTimeNS() - start;
+    if (pixels == NULL)
+    {
+        ReportWarning(invalid_atlas_image);
+        return ATLAS_INVALID_IMAGE;
+    }
+
+    size_t image = AddAtlasPixels(pixels, width, height);
+    stbi_image_free(pixels);
+    return image;
+}
+
+size_t AddAtlasFile(const char* file_path)
+{
+    char full_file_path[256] = ATLAS_PATH;
+    (void)strncat(full_file_path, file_path,
+                  sizeof(full_file_path) - sizeof(ATLAS_PATH));
+
+    size_t length = GetFileLength(full_file_path);
+    if (length == 0)
+    {
+        ReportWarning(invalid_atlas_image);
+        return ATLAS_INVALID_IMAGE;
+    }
+
+    ptr_t contents = AllocateBlock(length);
+    size_t image = ATLAS_INVALID_IMAGE;
+    if (ReadFileContents(full_file_path, contents._p, length))
+        image = AddAtlasImage(contents._p, length);
+    else ReportWarning(invalid_atlas_image);
+    FreeBlock(&contents);
+
+    // Remember where the image came from, so it can be found again if the
+    // file changes.
+    if (image != ATLAS_INVALID_IMAGE)
+    {
+        atlas_image_t* added = &((atlas_image_t*)images._a._p)[image];
+        added->file = AllocateBlock(strlen(file_path) + 1);
+        SetBlockContents(&added->file, file_path, added->file.size);
+    }
+    return image;
+}
+
+/**
+ * @brief Order images tallest first, then widest first. Packing them in
+ * this order keeps the skyline flat, which wastes far less space.
+ */
+static int CompareAtlasImages(const void* a, const void* b)
+{
+    const atlas_sort_entry_t* left = a;
+    const atlas_sort_entry_t* right = b;
+    if (left->height != right->height)
+        return left->height < right->height ? 1 : -1;
+    if (left->width != right->width)
+        return left->width < right->width ? 1 : -1;
+    return left->index < right->index ? -1 : 1;
+}
+
+/**
+ * @brief Check whether a rectangle fits on the skyline with its left edge
+ * at the start of a node.
+ * @param node The node to start at.
+ * @param width The width of the rectangle.
+ * @param height The height of the rectangle.
+ * @param y Where to write the lowest Y the rectangle can sit at.
+ * @return true The rectangle fits.
+ * @return false The rectangle runs off the page.
+ */
+static bool FitSkyline(size_t node, uint32_t width, uint32_t height,
+                       uint32_t* y)
+{
+    if (skyline[node].x + width > ATLAS_PAGE_SIZE) return false;
+
+    // The rectangle sits on the highest node it spans. The last node
+    // always reaches the edge of the page, so this never runs off the
+    // end of the skyline.
+    uint32_t top = 0, remaining = width;
+    for (size_t i = node;; i++)
+    {
+        if (skyline[i].y > top) top = skyline[i].y;
+        if (top + height > ATLAS_PAGE_SIZE) return false;
+        if (skyline[i].width >= remaining) break;
+        remaining -= skyline[i].width;
+    }
+
+    *y = top;
+    return true;
+}
+
+/**
+ * @brief Place a rectangle on the skyline, at the position that leaves it
+ * lowest. Ties go to the narrowest node, which leaves wider gaps open for
+ * wider images.
+ * @param width The width of the rectangle.
+ * @param height The height of the rectangle.
+ * @param x Where to write the X the rectangle was placed at.
+ * @param y Where to write the Y the rectangle was placed at.
+ * @return true The rectangle was placed.
+ * @return false The rectangle doesn't fit anywhere on this page.
+ */
+static bool PlaceSkyline(uint32_t width, uint32_t height, uint32_t* x,
+                         uint32_t* y)
+{
+    size_t best = SIZE_MAX;
+    uint32_t best_bottom = UINT32_MAX, best_width = UINT32_MAX;
+    for (size_t i = 0; i < skyline_length; i++)
+    {
+        uint32_t top;
+        if (!FitSkyline(i, width, height, &top)) continue;
+        if (top + height < best_bottom ||
+            (top + height == best_bottom && skyline[i].width < best_width))
+        {
+            best = i;
+            best_bottom = top + height;
+            best_width = skyline[i].width;
+        }
+    }
+    if (best == SIZE_MAX) return false;
+
+    *x = skyline[best].x;
+    *y = best_bottom - height;
+
+    // Put the new segment in, then cut away whatever it now covers.
+    memmove(&skyline[best + 1], &skyline[best],
+            (skyline_length - best) * sizeof(atlas_skyline_node_t));
+    skyline[best] = (atlas_skyline_node_t){*x, best_bottom, width};
+    skyline_length++;
+
+    const uint32_t right = *x + width;
+    size_t covered = best + 1;
+    while (covered < skyline_length &&
+           skyline[covered].x + skyline[covered].width <= right)
+        covered++;
+    if (covered < skyline_length && skyline[covered].x < right)
+    {
+        skyline[covered].width -= right - skyline[covered].x;
+        skyline[covered].x = right;
+    }
+    memmove(&skyline[best + 1], &skyline[covered],
+            (skyline_length - covered) * sizeof(atlas_skyline_node_t));
+    skyline_length -= covered - (best + 1);
+
+    // Neighbours at the same height are one segment.
+    for (size_t i = 0; i + 1 < skyline_length;)
+    {
+        if (skyline[i].y != skyline[i + 1].y)
+        {
+            i++;
+            continue;
+        }
+        skyline[i].width += skyline[i + 1].width;
+        memmove(&skyline[i + 1], &skyline[i + 2],
+                (skyline_length - i - 2) * sizeof(atlas_skyline_node_t));
+        skyline_length--;
+    }
+    return true;
+}
+
+/**
+ * @brief Start packing a new page.
+ * @return The new page.
+ */
+static atlas_page_t* OpenAtlasPage(void)
+{
+    skyline[0] = (atlas_skyline_node_t){0, 0, ATLAS_PAGE_SIZE};
+    skyline_length = 1;
+
+    atlas_page_t page = {{NULL, 0}, 0, 0, 0, 0};
+    return AddFlatArrayValue(&pages, &page);
+}
+
+/**
+ * @brief Round a page side up to the next power of two.
+ * @param side The side, in pixels.
+ * @return The rounded side.
+ */
+static uint32_t RoundPageSide(uint32_t side)
+{
+    uint32_t rounded = 1;
+    while (rounded < side) rounded <<= 1;
+    return rounded;
+}
+
+void BuildAtlas(void)
+{
+    if (atlas_built)
+    {
+        ReportWarning(double_atlas_build);
+        return;
+    }
+    atlas_built = true;
+    if (!atlas_created) return;
+
+    uint64_t start = GetCurrentTimeNS();
+    atlas_image_t* added = images._a._p;
+    ptr_t order =
+        AllocateBlock(images.occupied * sizeof(atlas_sort_entry_t));
+    atlas_sort_entry_t* sorted = order._p;
+    for (size_t i = 0; i < images.occupied; i++)
+        sorted[i] = (atlas_sort_entry_t){added[i].region.width,
+                                         added[i].region.height, i};
+    qsort(sorted, images.occupied, sizeof(atlas_sort_entry_t),
+          CompareAtlasImages);
+
+    // Place every image, opening a new page whenever one doesn't fit on
+    // the current one. Pages are packed at full size; their real size is
+    // only known once they're full.
+    atlas_page_t* page = OpenAtlasPage();
+    uint64_t packed_area = 0;
+    for (size_t i = 0; i < images.occupied; i++)
+    {
+        atlas_image_t* image = &added[sorted[i].index];
+        const uint32_t width = image->region.width + ATLAS_PADDING;
+        const uint32_t height = image->region.height + ATLAS_PADDING;
+        if (width > ATLAS_PAGE_SIZE || height > ATLAS_PAGE_SIZE)
+        {
+            ReportWarning(oversized_atlas_image);
+            continue;
+        }
+
+        if (!PlaceSkyline(width, height, &image->x, &image->y))
+        {
+            page = OpenAtlasPage();
+            (void)PlaceSkyline(width, height, &image->x, &image->y);
+        }
+
+        image->region.page = pages.occupied - 1;
+        if (image->x + width > page->width) page->width = image->x + width;
+        if (image->y + height > page->height)
+            page->height = image->y + height;
+        packed_area += (uint64_t)width * height;
+    }
+    FreeBlock(&order);
+
+    uint64_t page_area = 0;
+    atlas_page_t* packed = pages._a._p;
+    for (size_t i = 0; i < pages.occupied; i++)
+    {
+        packed[i].width = RoundPageSide(packed[i].width);
+        packed[i].height = RoundPageSide(packed[i].height);
+        packed[i].pixels = AllocateZeroedBlock((size_t)packed[i].width *
+                                               packed[i].height * 4);
+        page_area += (uint64_t)packed[i].width * packed[i].height;
+    }
+
+    for (size_t i = 0; i < images.occupied; i++)
+    {
+        atlas_image_t* image = &added[i];
+        atlas_region_t* region = &image->region;
+        if (region->page == ATLAS_INVALID_PAGE)
+        {
+            FreeBlock(&image->pixels);
+            continue;
+        }
+
+        const atlas_page_t* target = &packed[region->page];
+        CopyPixelRect((uint32_t*)target->pixels._p +
+                          (size_t)image->y * target->width + image->x,
+                      target->width * 4, image->pixels._p,
+                      region->width * 4, region->width, region->height);
+        FreeBlock(&image->pixels);
+
+        region->uv[0] = (float)image->x / target->width;
+        region->uv[1] = (float)image->y / target->height;
+        region->uv[2] = (float)(image->x + region->width) / target->width;
+        region->uv[3] =
+            (float)(image->y + region->height) / target->height;
+    }
+
+    ReportMessage("atlas: %zu image(s) decoded in %lu us, packed into %zu "
+                  "page(s) in %lu us, %.1f%% occupied",
+                  images.occupied, decode_time / 1000, pages.occupied,
+                  (GetCurrentTimeNS() - start) / 1000,
+                  page_area == 0 ? 0.0 : 100.0 * packed_area / page_area);
+}
+
+const atlas_region_t* GetAtlasRegion(size_t image)
+{
+    if (!atlas_built || !atlas_created || image >= images.occupied)
+        return NULL;
+    return &((atlas_image_t*)images._a._p)[image].region;
+}
+
+size_t GetAtlasPageCount(void) { return atlas_built ? pages.occupied : 0; }
+
+/**
+ * @brief Upload a page's pixels into a new texture.
+ * @param page The page.
+ * @return The new texture.
+ */
+static uint32_t UploadAtlasPage(const atlas_page_t* page)
+{
+    uint32_t texture;
+    glGenTextures(1, &texture);
+    BindGLTexture(0, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, page->width, page->height, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, page->pixels._p);
+    return texture;
+}
+
+uint32_t GetAtlasPageTexture(uint16_t page)
+{
+    if (!atlas_built || !atlas_created || page >= pages.occupied) return 0;
+
+    atlas_page_t* target = &((atlas_page_t*)pages._a._p)[page];
+    if (target->texture != 0) return target->texture;
+
+    pthread_mutex_lock(&pixel_mutex);
+    target->texture = UploadAtlasPage(target);
+    if (!retain_pixels && !CheckBlockNull(target->pixels))
+        FreeBlock(&target->pixels);
+    pthread_mutex_unlock(&pixel_mutex);
+    return target->texture;
+}
+
+void SetAtlasPixelRetention(bool retain) { retain_pixels = retain; }
+
+size_t ReloadAtlasFile(const char* file_path)
+{
+    if (!atlas_built || !atlas_created) return 0;
+
+    atlas_image_t* added = images._a._p;
+    size_t image = 0;
+    while (image < images.occupied &&
+           (CheckBlockNull(added[image].file) ||
+            strcmp(added[image].file._p, file_path) != 0))
+        image++;
+    if (image == images.occupied) return 0;
+
+    char full_file_path[256] = ATLAS_PATH;
+    (void)strncat(full_file_path, file_path,
+                  sizeof(full_file_path) - sizeof(ATLAS_PATH));
+    int width, height, channels;
+    uint8_t* pixels =
+        stbi_load(full_file_path, &width, &height, &channels, 4);
+    if (pixels == NULL)
+    {
+        ReportWarning(invalid_atlas_image);
+        return 0;
+    }
+
+    // The image has to keep its place in the atlas, so it can't change
+    // size; that takes a restart.
+    atlas_region_t* region = &added[image].region;
+    if ((uint32_t)width != region->width ||
+        (uint32_t)height != region->height)
+    {
+        ReportWarning(mismatched_atlas_reload);
+        stbi_image_free(pixels);
+        return 0;
+    }
+    if (region->page == ATLAS_INVALID_PAGE)
+    {
+        stbi_image_free(pixels);
+        return 0;
+    }
+
+    pthread_mutex_lock(&pixel_mutex);
+    atlas_page_t* target = &((atlas_page_t*)pages._a._p)[region->page];
+    if (CheckBlockNull(target->pixels))
+    {
+        pthread_mutex_unlock(&pixel_mutex);
+        ReportWarning(unsupported_asset_reload);
+        stbi_image_free(pixels);
+        return 0;
+    }
+
+    CopyPixelRect((uint32_t*)target->pixels._p +
+                      (size_t)added[image].y * target->width +
+                      added[image].x,
+                  target->width * 4, pixels, region->width * 4,
+                  region->width, region->height);
+    stbi_image_free(pixels);
+
+    // A page that was never uploaded just picks the new pixels up when it
+    // is. Otherwise, the whole page goes up again as a new texture, and
+    // the rendering thread swaps it in once it's ready.
+    if (target->texture != 0)
+    {
+        uint32_t texture = UploadAtlasPage(target);
+        glFinish();
+        uint32_t replaced = atomic_exchange(&target->pending, texture);
+        if (replaced != 0) glDeleteTextures(1, &replaced);
+    }
+    pthread_mutex_unlock(&pixel_mutex);
+    return 1;
+}
+
+size_t SwapReloadedAtlasPages(void)
+{
+    if (!atlas_created) return 0;
+
+    size_t swapped = 0;
+    atlas_page_t* packed = pages._a._p;
+    for (size_t i = 0; i < pages.occupied; i++)
+    {
+        uint32_t texture = atomic_exchange(&packed[i].pending, 0);
+        if (texture == 0) continue;
+
+        DeleteGLTextures(1, &packed[i].texture);
+        packed[i].texture = texture;
+        swapped++;
+    }
+    return swapped;
+}
+
+void SetSpriteImage(sprite_t* sprite, size_t image)
+{
+    const atlas_region_t* region = GetAtlasRegion(image);
+    if (region == NULL || region->page == ATLAS_INVALID_PAGE)
+    {
+        sprite->texture = 0;
+        return;
+    }
+
+    sprite->texture = GetAtlasPageTexture(region->page);
+    memcpy(sprite->uv, region->uv, sizeof(sprite->uv));
+}
+
+void DestroyAtlas(void)
+{
+    if (!atlas_created) return;
+
+    atlas_image_t* added = images._a._p;
+    for (size_t i = 0; i < images.occupied; i++)
+        if (!CheckBlockNull(added[i].pixels)) FreeBlock(&added[i].pixels);
+
+    for (size_t i = 0; i < images.occupied; i++)
+        if (!CheckBlockNull(added[i].file)) FreeBlock(&added[i].file);
+
+    atlas_page_t* packed = pages._a._p;
+    for (size_t i = 0; i < pages.occupied; i++)
+    {
+        if (!CheckBlockNull(packed[i].pixels))
+            FreeBlock(&packed[i].pixels);
+        if (packed[i].texture != 0)
+            DeleteGLTextures(1, &packed[i].texture);
+
+        uint32_t pending = atomic_exchange(&packed[i].pending, 0);
+        if (pending != 0) glDeleteTextures(1, &pending);
+    }
+
+    DestroyFlatArray(&images);
+    DestroyFlatArray(&pages);
+    atlas_created = false;
+    atlas_built = false;
+    decode_time = 0;
+}
@@ -0,0 +1,180 @@
+/**
+ * @file Atlas.h
+ * @author Israfiel (https://github.com/israfiel-a)
+ * @brief Provides the texture atlas. Images are decoded as they're added,
+ * then packed together into a handful of power-of-two pages when the atlas
+ * is built, so that sprites drawn from any of them only need as many
+ * texture binds as there are pages.
+ * @date 2024-08-24
+ *
+ * @copyright (c) 2024 - Israfiel
+ */
+
+#ifndef _MSENG_ATLAS_RENDERING_SYSTEM_
+#define _MSENG_ATLAS_RENDERING_SYSTEM_
+
+#include "Sprite.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief The path images are loaded from by @ref AddAtlasFile.
+ */
+#define ATLAS_PATH "./Assets/"
+
+/**
+ * @brief The largest a page can be on either side, in pixels. Pages are
+ * packed at this size and then shrunk to the smallest power of two that
+ * still holds everything. GLES2 only promises 64, but anything that can
+ * run the engine can do at least this.
+ */
+#define ATLAS_PAGE_SIZE 2048
+
+/**
+ * @brief The gap left to the right of and below every image, in pixels,
+ * so that filtering never pulls in a neighbour.
+ */
+#define ATLAS_PADDING 1
+
+/**
+ * @brief The image index returned when an image couldn't be added.
+ */
+#define ATLAS_INVALID_IMAGE SIZE_MAX
+
+/**
+ * @brief The page of an image that couldn't be placed.
+ */
+#define ATLAS_INVALID_PAGE UINT16_MAX
+
+/**
+ * @brief Where an image ended up within the atlas.
+ */
+typedef struct
+{
+    /**
+     * @brief The page the image was packed into, or @ref
+     * ATLAS_INVALID_PAGE if it didn't fit anywhere.
+     */
+    uint16_t page;
+    /**
+     * @brief The width of the image in pixels.
+     */
+    uint32_t width;
+    /**
+     * @brief The height of the image in pixels.
+     */
+    uint32_t height;
+    /**
+     * @brief The image's texture coordinates within its page, in the same
+     * form as @ref sprite_t's.
+     */
+    float uv[4];
+} atlas_region_t;
+
+/**
+ * @brief Add already-decoded pixels to the atlas. They're copied, so they
+ * don't need to outlive the call.
+ * @param pixels The pixels, as tightly packed RGBA bytes.
+ * @param width The width of the image in pixels.
+ * @param height The height of the image in pixels.
+ * @return The image's index, or @ref ATLAS_INVALID_IMAGE if the atlas has
+ * already been built.
+ */
+size_t AddAtlasPixels(const uint8_t* pixels, uint32_t width,
+                      uint32_t height);
+
+/**
+ * @brief Decode an image file held in memory and add it to the atlas.
+ * Anything STBI can read is accepted.
+ * @param data The file's contents.
+ * @param length The size of the file in bytes.
+ * @return The image's index, or @ref ATLAS_INVALID_IMAGE if it couldn't
+ * be decoded or the atlas has already been built.
+ */
+size_t AddAtlasImage(const uint8_t* data, size_t length);
+
+/**
+ * @brief Read an image file from @ref ATLAS_PATH and add it to the atlas.
+ * @param file_path The path of the file within @ref ATLAS_PATH.
+ * @return The image's index, or @ref ATLAS_INVALID_IMAGE if it couldn't
+ * be read or decoded, or the atlas has already been built.
+ */
+size_t AddAtlasFile(const char* file_path);
+
+/**
+ * @brief Pack every image added so far into pages, and fill in their
+ * regions. This doesn't touch OpenGL; pages are uploaded the first time
+ * their texture is asked for. Once the atlas is built, no more images can
+ * be added.
+ */
+void BuildAtlas(void);
+
+/**
+ * @brief Get where an image ended up within the atlas.
+ * @param image The image's index.
+ * @return The image's region, or NULL if the index is invalid or the
+ * atlas hasn't been built yet.
+ */
+const atlas_region_t* GetAtlasRegion(size_t image);
+
+/**
+ * @brief Get the amount of pages the atlas was packed into.
+ * @return The page count.
+ */
+size_t GetAtlasPageCount(void);
+
+/**
+ * @brief Get the OpenGL texture of a page, uploading the page first if
+ * this is the first time it's been asked for. This must be called on the
+ * rendering thread, with a context current.
+ * @param page The page.
+ * @return The page's texture, or 0 if the page doesn't exist.
+ */
+uint32_t GetAtlasPageTexture(uint16_t page);
+
+/**
+ * @brief Keep each page's pixels in memory after it's uploaded, so that
+ * @ref ReloadAtlasFile can rebuild it. This has to be set before any page
+ * is uploaded to matter.
+ * @param retain Whether to keep the pixels.
+ */
+void SetAtlasPixelRetention(bool retain);
+
+/**
+ * @brief Reload an image from its file, and rebuild its page as a new
+ * texture. The new texture isn't used until @ref SwapReloadedAtlasPages.
+ * This is meant for a loader thread with its own shared context current.
+ * The image has to keep its size, and pixels have to have been retained.
+ * @param file_path The file, as it was given to @ref AddAtlasFile.
+ * @return The amount of images reloaded.
+ */
+size_t ReloadAtlasFile(const char* file_path);
+
+/**
+ * @brief Swap rebuilt pages in for the textures they replace, deleting
+ * the old ones. Page textures change when this happens, so sprites should
+ * be pointed at their image with @ref SetSpriteImage each time they're
+ * submitted rather than once. This must be called on the rendering
+ * thread, at a frame boundary.
+ * @return The amount of pages swapped.
+ */
+size_t SwapReloadedAtlasPages(void);
+
+/**
+ * @brief Point a sprite at an image within the atlas, setting its texture
+ * and texture coordinates. This has the same threading requirements as
+ * @ref GetAtlasPageTexture.
+ * @param sprite The sprite.
+ * @param image The image's index.
+ */
+void SetSpriteImage(sprite_t* sprite, size_t image);
+
+/**
+ * @brief Free the atlas and delete its textures. If any page was
+ * uploaded, this must be called on the rendering thread, with a context
+ * current.
+ */
+void DestroyAtlas(void);
+
+#endif // _MSENG_ATLAS_RENDERING_SYSTEM_
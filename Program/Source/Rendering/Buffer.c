@@ -0,0 +1,248 @@
+#define _GNU_SOURCE // memfd_create
+#include "Buffer.h"
+#include <Globals.h>
+#include <Input/File.h>     // Shared memory
+#include <Output/System.h>  // Error and warning reporting
+#include <pthread.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * @brief A pool of same-sized buffers, all carved out of one shared
+ * memory mapping.
+ */
+typedef struct
+{
+    /**
+     * @brief Whether this slot holds a live pool.
+     */
+    bool in_use;
+    /**
+     * @brief The width of the pool's buffers in pixels.
+     */
+    uint32_t width;
+    /**
+     * @brief The height of the pool's buffers in pixels.
+     */
+    uint32_t height;
+    /**
+     * @brief The pool's mapping. Every buffer lives within it.
+     */
+    void* data;
+    /**
+     * @brief The size of the mapping in bytes.
+     */
+    size_t size;
+    /**
+     * @brief The Wayland side of the pool.
+     */
+    struct wl_shm_pool* _p;
+    /**
+     * @brief The pool's buffers.
+     */
+    pixel_buffer_t buffers[BUFFER_POOL_DEPTH];
+} buffer_pool_t;
+
+/**
+ * @brief Every pool. These are kept in a fixed array so that the buffer
+ * pointers given to the release listener never move.
+ */
+static buffer_pool_t pools[BUFFER_POOL_LIMIT];
+
+/**
+ * @brief Guards the creation and destruction of pools. Acquiring and
+ * releasing buffers themselves only touches the busy flags.
+ */
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Handle the compositor letting go of a buffer, which puts it back
+ * in its pool. This runs on the Wayland event thread.
+ * @param data The buffer.
+ * @param b Nothing of use.
+ */
+static void HBR(void* data, struct wl_buffer* b)
+{
+    atomic_store_explicit(&((pixel_buffer_t*)data)->busy, false,
+                          memory_order_release);
+}
+
+/**
+ * @brief The listener for pooled buffers.
+ */
+static const struct wl_buffer_listener release_listener = {HBR};
+
+/**
+ * @brief Get a file descriptor for a pool's memory. This prefers an
+ * anonymous memory file, and falls back to POSIX shared memory.
+ * @param size The size of the memory in bytes.
+ * @return The file descriptor.
+ */
+static int OpenPoolMemory(size_t size)
+{
+    int fd = memfd_create("morningstar-buffer-pool", MFD_CLOEXEC);
+    if (fd < 0) return OpenSHM(size);
+
+    int ret;
+    do {
+        ret = ftruncate(fd, size);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) ReportError(shm_open_failure);
+    return fd;
+}
+
+/**
+ * @brief Tear a pool down, destroying its buffers and unmapping its
+ * memory.
+ * @param pool The pool to destroy.
+ */
+static void DestroyBufferPool(buffer_pool_t* pool)
+{
+    for (size_t i = 0; i < BUFFER_POOL_DEPTH; i++)
+        wl_buffer_destroy(pool->buffers[i]._b);
+    wl_shm_pool_destroy(pool->_p);
+    if (munmap(pool->data, pool->size) == -1) ReportError(unmmap_failure);
+
+    *pool = (buffer_pool_t){0};
+}
+
+/**
+ * @brief Create a pool in the given slot.
+ * @param pool The slot.
+ * @param width The width of the pool's buffers in pixels.
+ * @param height The height of the pool's buffers in pixels.
+ */
+static void CreateBufferPool(buffer_pool_t* pool, uint32_t width,
+                             uint32_t height)
+{
+    const uint32_t stride = width * 4;
+    const size_t buffer_size = (size_t)stride * height;
+
+    pool->width = width;
+    pool->height = height;
+    pool->size = buffer_size * BUFFER_POOL_DEPTH;
+
+    int fd = OpenPoolMemory(pool->size);
+    pool->data =
+        mmap(NULL, pool->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (pool->data == MAP_FAILED) ReportError(mmap_failure);
+    pool->_p = wl_shm_create_pool(GetSHM(), fd, pool->size);
+    // The compositor has its own copy of the descriptor by now.
+    close(fd);
+
+    for (size_t i = 0; i < BUFFER_POOL_DEPTH; i++)
+    {
+        pixel_buffer_t* buffer = &pool->buffers[i];
+        buffer->_b = wl_shm_pool_create_buffer(pool->_p, i * buffer_size,
+                                               width, height, stride,
+                                               WL_SHM_FORMAT_XRGB8888);
+        buffer->pixels =
+            (uint32_t*)((uint8_t*)pool->data + i * buffer_size);
+        buffer->width = width;
+        buffer->height = height;
+        buffer->stride = stride;
+        atomic_init(&buffer->busy, false);
+        wl_buffer_add_listener(buffer->_b, &release_listener, buffer);
+    }
+    pool->in_use = true;
+}
+
+/**
+ * @brief Check if none of a pool's buffers are in use.
+ * @param pool The pool to check.
+ * @return true Every buffer is free.
+ * @return false At least one buffer is being drawn into or displayed.
+ */
+static bool CheckBufferPoolIdle(buffer_pool_t* pool)
+{
+    for (size_t i = 0; i < BUFFER_POOL_DEPTH; i++)
+        if (atomic_load_explicit(&pool->buffers[i].busy,
+                                 memory_order_acquire))
+            return false;
+    return true;
+}
+
+/**
+ * @brief Find the pool for the given size, creating it if need be.
+ * @param width The width of the pool's buffers in pixels.
+ * @param height The height of the pool's buffers in pixels.
+ * @return The pool, or NULL if there's no room for a new one.
+ */
+static buffer_pool_t* GetBufferPool(uint32_t width, uint32_t height)
+{
+    buffer_pool_t* free_slot = NULL;
+    for (size_t i = 0; i < BUFFER_POOL_LIMIT; i++)
+    {
+        if (!pools[i].in_use)
+        {
+            if (free_slot == NULL) free_slot = &pools[i];
+            continue;
+        }
+        if (pools[i].width == width && pools[i].height == height)
+            return &pools[i];
+    }
+
+    // Out of slots; reclaim a pool nobody's using, most likely one left
+    // behind by a panel that's since been resized.
+    if (free_slot == NULL)
+    {
+        for (size_t i = 0; i < BUFFER_POOL_LIMIT; i++)
+        {
+            if (!CheckBufferPoolIdle(&pools[i])) continue;
+            DestroyBufferPool(&pools[i]);
+            free_slot = &pools[i];
+            break;
+        }
+        if (free_slot == NULL) return NULL;
+    }
+
+    CreateBufferPool(free_slot, width, height);
+    return free_slot;
+}
+
+pixel_buffer_t* AcquireBuffer(uint32_t width, uint32_t height)
+{
+    if (!devices.shm || width == 0 || height == 0)
+    {
+        ReportWarning(preemptive_buffer_acquire);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pool_mutex);
+    buffer_pool_t* pool = GetBufferPool(width, height);
+    if (pool == NULL)
+    {
+        pthread_mutex_unlock(&pool_mutex);
+        ReportWarning(exhausted_buffer_pools);
+        return NULL;
+    }
+
+    // The buffer has to be marked busy before the lock goes, or another
+    // thread could see the pool as idle and reclaim it underneath us.
+    pixel_buffer_t* acquired = NULL;
+    for (size_t i = 0; i < BUFFER_POOL_DEPTH && acquired == NULL; i++)
+    {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&pool->buffers[i].busy,
+                                           &expected, true))
+            acquired = &pool->buffers[i];
+    }
+    pthread_mutex_unlock(&pool_mutex);
+    return acquired;
+}
+
+void SubmitBuffer(pixel_buffer_t* buffer, struct wl_surface* surface)
+{
+    wl_surface_attach(surface, buffer->_b, 0, 0);
+    wl_surface_damage_buffer(surface, 0, 0, buffer->width, buffer->height);
+    wl_surface_commit(surface);
+}
+
+void DestroyBufferPools(void)
+{
+    pthread_mutex_lock(&pool_mutex);
+    for (size_t i = 0; i < BUFFER_POOL_LIMIT; i++)
+        if (pools[i].in_use) DestroyBufferPool(&pools[i]);
+    pthread_mutex_unlock(&pool_mutex);
+}
@@ -0,0 +1,90 @@
+/**
+ * @file Buffer.h
+ * @author Israfiel (https://github.com/israfiel-a)
+ * @brief Provides pools of reusable shared memory buffers for panels drawn
+ * on the CPU. Each pool is created once per panel size and kept mapped,
+ * and its buffers are recycled as the compositor releases them, so that
+ * repainting a panel doesn't cost any system calls.
+ * @date 2024-08-23
+ *
+ * @copyright (c) 2024 - Israfiel
+ */
+
+#ifndef _MSENG_BUFFER_RENDERING_SYSTEM_
+#define _MSENG_BUFFER_RENDERING_SYSTEM_
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <wayland-client-protocol.h>
+
+/**
+ * @brief The amount of buffers in each pool. Three lets us draw into one
+ * while the compositor holds onto the other two.
+ */
+#define BUFFER_POOL_DEPTH 3
+
+/**
+ * @brief The most pools (panel sizes) that can be alive at once. When a
+ * new size is asked for past this, an idle pool is torn down to make room.
+ */
+#define BUFFER_POOL_LIMIT 8
+
+/**
+ * @brief A single XRGB8888 buffer within a pool.
+ */
+typedef struct
+{
+    /**
+     * @brief The Wayland side of the buffer.
+     */
+    struct wl_buffer* _b;
+    /**
+     * @brief The buffer's pixels, mapped for as long as the pool lives.
+     */
+    uint32_t* pixels;
+    /**
+     * @brief The width of the buffer in pixels.
+     */
+    uint32_t width;
+    /**
+     * @brief The height of the buffer in pixels.
+     */
+    uint32_t height;
+    /**
+     * @brief The distance between rows in bytes.
+     */
+    uint32_t stride;
+    /**
+     * @brief Whether the buffer is being drawn into or is held by the
+     * compositor. This is cleared from the Wayland event thread when the
+     * compositor releases the buffer.
+     */
+    atomic_bool busy;
+} pixel_buffer_t;
+
+/**
+ * @brief Get a free buffer of the given size to draw into, creating a pool
+ * for that size if there isn't one yet. The buffer belongs to the caller
+ * until it's passed to @ref SubmitBuffer.
+ * @param width The width of the buffer in pixels.
+ * @param height The height of the buffer in pixels.
+ * @return The buffer, or NULL if every buffer of that size is still held
+ * by the compositor. In that case, there's no point in drawing anyway.
+ */
+pixel_buffer_t* AcquireBuffer(uint32_t width, uint32_t height);
+
+/**
+ * @brief Attach a buffer to a surface and commit it. The buffer goes back
+ * into its pool once the compositor is done with it.
+ * @param buffer The buffer, as given by @ref AcquireBuffer.
+ * @param surface The surface to show the buffer on.
+ */
+void SubmitBuffer(pixel_buffer_t* buffer, struct wl_surface* surface);
+
+/**
+ * @brief Destroy every buffer pool. This must be done before the shared
+ * memory interface is unbound.
+ */
+void DestroyBufferPools(void);
+
+#endif // _MSENG_BUFFER_RENDERING_SYSTEM_
@@ -1,5 +1,6 @@
 #include "Colors.h"
-#include <Input/File.h>
+#include "Buffer.h"      // Buffer pools
+#include <Memory/Fill.h> // Pixel fills
 
 void SendBlankColor(const panel_t* panel, uint32_t color)
 {
@@ -22,9 +23,12 @@ void SendBlankColor(const panel_t* panel, uint32_t color)
     //         break;
     // }
 
-    struct wl_buffer* pixels = CreateSolidPixelBuffer(
-        panel->width, panel->height, WL_SHM_FORMAT_XRGB8888, color);
-    wl_surface_attach(panel->_s, pixels, 0, 0);
-    wl_surface_commit(panel->_s);
-    wl_buffer_destroy(pixels);
+    // If every buffer is still on screen, there's nothing to draw into;
+    // the panel will be repainted next time around.
+    pixel_buffer_t* buffer = AcquireBuffer(panel->width, panel->height);
+    if (buffer == NULL) return;
+
+    FillPixels(buffer->pixels, color,
+               (size_t)buffer->width * buffer->height);
+    SubmitBuffer(buffer, panel->_s);
 }
@@ -0,0 +1,245 @@
+#include "Damage.h"
+#include "Frame.h"
+#include <Diagnostic/Time.h> // Refresh timing
+#include <Memory/Thread.h>   // Contended locks
+#include <Output/Messages.h> // Statistics reporting
+#include <pthread.h>
+
+/**
+ * @brief The damage a panel has built up since it was last drawn.
+ */
+typedef struct
+{
+    damage_rect_t rects[DAMAGE_RECT_LIMIT];
+    size_t count;
+    /**
+     * @brief Whether the whole panel is damaged, in which case the
+     * rectangles don't matter.
+     */
+    bool whole;
+    /**
+     * @brief The logical and surface size the panel was last drawn at.
+     * These start at 0, so every panel is damaged whole the first time
+     * it's drawn.
+     */
+    uint32_t width;
+    uint32_t height;
+    uint32_t surface_width;
+    uint32_t surface_height;
+} panel_damage_t;
+
+/**
+ * @brief Every panel's damage, by panel type.
+ */
+static panel_damage_t panel_damage[PANEL_TYPE_COUNT];
+
+/**
+ * @brief Guards the damage, which is marked from any thread and taken by
+ * the rendering thread.
+ */
+static pthread_mutex_t damage_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief The panel frames that were drawn and skipped, and the surface
+ * area of every panel frame alongside how much of it was submitted as
+ * damage.
+ */
+static uint64_t frames_drawn = 0, frames_skipped = 0;
+static uint64_t surface_pixels = 0, damaged_pixels = 0;
+
+/**
+ * @brief Check whether one rectangle completely covers another.
+ */
+static bool CoversDamage(const damage_rect_t* outer,
+                         const damage_rect_t* inner)
+{
+    return inner->x >= outer->x && inner->y >= outer->y &&
+           (int64_t)inner->x + inner->width <=
+               (int64_t)outer->x + outer->width &&
+           (int64_t)inner->y + inner->height <=
+               (int64_t)outer->y + outer->height;
+}
+
+void DamagePanel(panel_type_t type, int32_t x, int32_t y, uint32_t width,
+                 uint32_t height)
+{
+    if (type >= PANEL_TYPE_COUNT || width == 0 || height == 0) return;
+
+    const damage_rect_t rect = {x, y, width, height};
+    LockMutex(&damage_mutex, "damage lock");
+    panel_damage_t* damage = &panel_damage[type];
+    bool covered = damage->whole;
+    for (size_t i = 0; i < damage->count && !covered; i++)
+        covered = CoversDamage(&damage->rects[i], &rect);
+
+    if (!covered)
+    {
+        // Out of room; everything so far becomes one rectangle, which
+        // leaves room for this one.
+        if (damage->count == DAMAGE_RECT_LIMIT)
+        {
+            damage->rects[0] =
+                GetDamageBounds(damage->rects, damage->count);
+            damage->count = 1;
+        }
+        damage->rects[damage->count++] = rect;
+    }
+    pthread_mutex_unlock(&damage_mutex);
+
+    RequestFrame();
+}
+
+void DamageWholePanel(panel_type_t type)
+{
+    if (type >= PANEL_TYPE_COUNT) return;
+
+    LockMutex(&damage_mutex, "damage lock");
+    panel_damage[type].whole = true;
+    pthread_mutex_unlock(&damage_mutex);
+
+    RequestFrame();
+}
+
+void DamageAllPanels(void)
+{
+    LockMutex(&damage_mutex, "damage lock");
+    for (size_t i = 0; i < PANEL_TYPE_COUNT; i++)
+        panel_damage[i].whole = true;
+    pthread_mutex_unlock(&damage_mutex);
+
+    RequestFrame();
+}
+
+void SetPanelRefresh(panel_t* panel, refresh_policy_t policy,
+                     uint32_t rate)
+{
+    if (panel == NULL) return;
+
+    LockMutex(&damage_mutex, "damage lock");
+    panel->refresh = policy;
+    panel->refresh_rate = rate;
+    pthread_mutex_unlock(&damage_mutex);
+
+    RequestFrame();
+}
+
+void InvalidatePanel(const panel_t* panel)
+{
+    if (panel != NULL) DamageWholePanel(panel->type);
+}
+
+size_t TakePanelDamage(panel_t* panel, uint32_t width, uint32_t height,
+                       damage_rect_t* rects)
+{
+    if (panel->type >= PANEL_TYPE_COUNT) return 0;
+
+    const uint64_t now = GetCurrentTimeNS();
+    LockMutex(&damage_mutex, "damage lock");
+    panel_damage_t* damage = &panel_damage[panel->type];
+    const bool resized = damage->width != width ||
+                         damage->height != height ||
+                         damage->surface_width != panel->width ||
+                         damage->surface_height != panel->height;
+    if (resized)
+    {
+        damage->whole = true;
+        damage->width = width;
+        damage->height = height;
+        damage->surface_width = panel->width;
+        damage->surface_height = panel->height;
+    }
+
+    // A resize can't wait, whatever the panel's policy.
+    const refresh_policy_t policy = panel->refresh;
+    const uint64_t interval =
+        policy == fixed_rate && panel->refresh_rate != 0
+            ? 1000000000 / panel->refresh_rate
+            : 0;
+    if (interval != 0 && !resized && now - panel->_lr < interval)
+    {
+        pthread_mutex_unlock(&damage_mutex);
+        RequestFrameAt(panel->_lr + interval);
+        return 0;
+    }
+    if (policy == every_frame || interval != 0) damage->whole = true;
+
+    size_t count = 0;
+    if (damage->whole)
+        rects[count++] = (damage_rect_t){0, 0, width, height};
+    else
+    {
+        for (size_t i = 0; i < damage->count; i++)
+        {
+            const damage_rect_t* rect = &damage->rects[i];
+            int64_t left = rect->x < 0 ? 0 : rect->x;
+            int64_t top = rect->y < 0 ? 0 : rect->y;
+            int64_t right = (int64_t)rect->x + rect->width;
+            int64_t bottom = (int64_t)rect->y + rect->height;
+            if (right > width) right = width;
+            if (bottom > height) bottom = height;
+            if (right <= left || bottom <= top) continue;
+
+            rects[count++] = (damage_rect_t){left, top, right - left,
+                                             bottom - top};
+        }
+    }
+
+    damage->count = 0;
+    damage->whole = false;
+    if (count != 0) panel->_lr = now;
+    pthread_mutex_unlock(&damage_mutex);
+
+    // Panels on a schedule ask for the frame they're next due in.
+    if (count != 0 && policy == every_frame) RequestFrame();
+    else if (count != 0 && interval != 0) RequestFrameAt(now + interval);
+    return count;
+}
+
+damage_rect_t GetDamageBounds(const damage_rect_t* rects, size_t count)
+{
+    if (count == 0) return (damage_rect_t){0, 0, 0, 0};
+
+    int64_t left = rects[0].x, top = rects[0].y;
+    int64_t right = left + rects[0].width, bottom = top + rects[0].height;
+    for (size_t i = 1; i < count; i++)
+    {
+        if (rects[i].x < left) left = rects[i].x;
+        if (rects[i].y < top) top = rects[i].y;
+        if ((int64_t)rects[i].x + rects[i].width > right)
+            right = (int64_t)rects[i].x + rects[i].width;
+        if ((int64_t)rects[i].y + rects[i].height > bottom)
+            bottom = (int64_t)rects[i].y + rects[i].height;
+    }
+    return (damage_rect_t){left, top, right - left, bottom - top};
+}
+
+void CountPanelDamage(const panel_t* panel, const damage_rect_t* rects,
+                      size_t count)
+{
+    if (count == 0)
+    {
+        frames_skipped++;
+        return;
+    }
+
+    frames_drawn++;
+    surface_pixels += (uint64_t)panel->width * panel->height;
+    for (size_t i = 0; i < count; i++)
+        damaged_pixels += (uint64_t)rects[i].width * rects[i].height;
+}
+
+void ReportDamageStatistics(void)
+{
+    // Skipped frames count as a full surface that wasn't damaged at all.
+    const uint64_t frames = frames_drawn + frames_skipped;
+    const uint64_t average_surface =
+        frames_drawn == 0 ? 0 : surface_pixels / frames_drawn;
+    const uint64_t total_pixels =
+        surface_pixels + average_surface * frames_skipped;
+    ReportMessage("damage: %lu of %lu panel frame(s) skipped, %.1f%% of "
+                  "surface pixels submitted as damage",
+                  frames_skipped, frames,
+                  total_pixels == 0
+                      ? 0.0
+                      : 100.0 * damaged_pixels / total_pixels);
+}
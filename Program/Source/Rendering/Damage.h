@@ -0,0 +1,128 @@
+/**
+ * @file Damage.h
+ * @author Israfiel (https://github.com/israfiel-a)
+ * @brief Provides per-panel damage tracking and refresh policies. Anything
+ * that changes what a panel shows marks the area it touched, and the
+ * rendering thread only redraws, swaps, and commits panels with damage on
+ * them or that are due by their refresh policy. What was damaged is passed
+ * on to the compositor, so it only recomposites that much of the panel.
+ * @date 2024-08-30
+ *
+ * @copyright (c) 2024 - Israfiel
+ */
+
+#ifndef _MSENG_DAMAGE_RENDERING_SYSTEM_
+#define _MSENG_DAMAGE_RENDERING_SYSTEM_
+
+#include <Windowing/Windowing-Types.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief The most separate rectangles a panel keeps per frame. Past this,
+ * everything is merged into one rectangle that covers it all.
+ */
+#define DAMAGE_RECT_LIMIT 8
+
+/**
+ * @brief A damaged area of a panel, in pixels from its top-left corner.
+ */
+typedef struct
+{
+    int32_t x;
+    int32_t y;
+    uint32_t width;
+    uint32_t height;
+} damage_rect_t;
+
+/**
+ * @brief Mark part of a panel as damaged, and ask for a frame. This is
+ * safe to call from any thread.
+ * @param type The panel's type.
+ * @param x The X position of the area's top-left corner, in the panel's
+ * logical pixels.
+ * @param y The Y position of the area's top-left corner, in the panel's
+ * logical pixels.
+ * @param width The width of the area.
+ * @param height The height of the area.
+ */
+void DamagePanel(panel_type_t type, int32_t x, int32_t y, uint32_t width,
+                 uint32_t height);
+
+/**
+ * @brief Mark the whole of a panel as damaged. This is safe to call from
+ * any thread.
+ * @param type The panel's type.
+ */
+void DamageWholePanel(panel_type_t type);
+
+/**
+ * @brief Mark the whole of every panel as damaged. This is safe to call
+ * from any thread.
+ */
+void DamageAllPanels(void);
+
+/**
+ * @brief Set how often a panel is redrawn. This is safe to call from any
+ * thread.
+ * @param panel The panel.
+ * @param policy The panel's new refresh policy.
+ * @param rate How many times a second to redraw the panel, if the policy
+ * is @enum fixed_rate. A rate of 0 makes the panel wait to be damaged, as
+ * if it were @enum on_demand.
+ */
+void SetPanelRefresh(panel_t* panel, refresh_policy_t policy,
+                     uint32_t rate);
+
+/**
+ * @brief Mark the whole of a panel as needing to be redrawn. This is what
+ * an @enum on_demand panel waits for. This is safe to call from any
+ * thread.
+ * @param panel The panel.
+ */
+void InvalidatePanel(const panel_t* panel);
+
+/**
+ * @brief Take the damage a panel has built up since it was last drawn,
+ * clipped to the size it's about to be drawn at. A panel whose size has
+ * changed since its last draw is damaged whole, whether or not anything
+ * marked it. Past that, the panel's refresh policy decides: @enum
+ * every_frame panels are always damaged whole, @enum fixed_rate panels
+ * are damaged whole when they're due and not at all before, and @enum
+ * on_demand panels only have what was marked. This must only be called
+ * by the rendering thread.
+ * @param panel The panel.
+ * @param width The width the panel is drawn at, in logical pixels.
+ * @param height The height the panel is drawn at, in logical pixels.
+ * @param rects Where to write the damage, which has room for @ref
+ * DAMAGE_RECT_LIMIT rectangles.
+ * @return The amount of rectangles written. If this is 0, the panel has
+ * nothing new to show and shouldn't be drawn.
+ */
+size_t TakePanelDamage(panel_t* panel, uint32_t width, uint32_t height,
+                       damage_rect_t* rects);
+
+/**
+ * @brief Get the smallest rectangle that covers some damage.
+ * @param rects The damage.
+ * @param count The amount of rectangles.
+ * @return The bounds.
+ */
+damage_rect_t GetDamageBounds(const damage_rect_t* rects, size_t count);
+
+/**
+ * @brief Record how much of a panel was submitted as damaged this frame.
+ * @param panel The panel.
+ * @param rects The damage, in surface pixels.
+ * @param count The amount of rectangles, or 0 if the panel was skipped.
+ */
+void CountPanelDamage(const panel_t* panel, const damage_rect_t* rects,
+                      size_t count);
+
+/**
+ * @brief Report how many panel frames were skipped, and how much of the
+ * panels' surfaces were submitted as damage.
+ */
+void ReportDamageStatistics(void);
+
+#endif // _MSENG_DAMAGE_RENDERING_SYSTEM_
@@ -0,0 +1,265 @@
+#include "Frame.h"
+#include <Diagnostic/Time.h> // Frame timing
+#include <Globals.h>
+#include <Windowing/Wayland.h> // Event queues
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @brief The mutex that guards every piece of scheduler state below.
+ */
+static pthread_mutex_t frame_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief The condition the rendering thread sleeps on while waiting for a
+ * frame. Unlike the old render condition, this is always paired with
+ * state, so a signal can never be lost or doubled up.
+ */
+static pthread_cond_t frame_cond = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief Whether or not somebody wants a new frame drawn.
+ */
+static bool frame_requested = true;
+
+/**
+ * @brief When a frame has been asked for by @ref RequestFrameAt, in
+ * nanoseconds, or 0 if it hasn't.
+ */
+static uint64_t frame_deadline = 0;
+
+/**
+ * @brief Whether or not a frame is requested every time the compositor
+ * hands us a frame callback.
+ */
+static bool continuous_rendering = true;
+
+/**
+ * @brief The frame callback we're currently waiting on, or NULL if there
+ * is none.
+ */
+static struct wl_callback* pending_callback = NULL;
+
+/**
+ * @brief The generation of @ref pending_callback. Callbacks we've given up
+ * on still fire eventually, and this is how we tell them apart from the
+ * one we're actually waiting on.
+ */
+static uintptr_t callback_generation = 0;
+
+/**
+ * @brief When the pending callback was requested, in nanoseconds.
+ */
+static uint64_t callback_requested_at = 0;
+
+/**
+ * @brief The compositor timestamp of the last frame callback, in
+ * milliseconds.
+ */
+static uint32_t last_callback_time = 0;
+
+/**
+ * @brief A running average of the space between frame callbacks, in
+ * milliseconds.
+ */
+static double callback_interval = 0;
+
+/**
+ * @brief The start of the current achieved frame rate window, in
+ * nanoseconds.
+ */
+static uint64_t rate_window_start = 0;
+
+/**
+ * @brief The frames drawn within the current achieved frame rate window.
+ */
+static uint32_t rate_window_frames = 0;
+
+/**
+ * @brief The achieved frame rate, as measured over the last full window.
+ */
+static double achieved_frame_rate = 0;
+
+/**
+ * @brief Handle the compositor telling us it's ready for a new frame.
+ * @param data The generation of the callback.
+ * @param callback The callback object, which is single-use.
+ * @param time The compositor's timestamp for the frame, in milliseconds.
+ */
+static void HFD(void* data, struct wl_callback* callback, uint32_t time)
+{
+    wl_callback_destroy(callback);
+
+    pthread_mutex_lock(&frame_mutex);
+    // A callback we've already given up on; the timeout already let the
+    // rendering thread move on without it.
+    if ((uintptr_t)data != callback_generation)
+    {
+        pthread_mutex_unlock(&frame_mutex);
+        return;
+    }
+
+    if (last_callback_time != 0 && time > last_callback_time)
+    {
+        double interval = time - last_callback_time;
+        callback_interval = callback_interval == 0
+                                ? interval
+                                : callback_interval * 0.9 + interval * 0.1;
+    }
+    last_callback_time = time;
+
+    pending_callback = NULL;
+    if (continuous_rendering) frame_requested = true;
+    pthread_cond_signal(&frame_cond);
+    pthread_mutex_unlock(&frame_mutex);
+}
+
+/**
+ * @brief The listener for frame callbacks.
+ */
+static const struct wl_callback_listener frame_listener = {HFD};
+
+void RequestFrame(void)
+{
+    pthread_mutex_lock(&frame_mutex);
+    frame_requested = true;
+    pthread_cond_signal(&frame_cond);
+    pthread_mutex_unlock(&frame_mutex);
+}
+
+void RequestFrameAt(uint64_t time)
+{
+    if (time == 0) time = 1;
+
+    pthread_mutex_lock(&frame_mutex);
+    if (frame_deadline == 0 || time < frame_deadline)
+    {
+        frame_deadline = time;
+        pthread_cond_signal(&frame_cond);
+    }
+    pthread_mutex_unlock(&frame_mutex);
+}
+
+void SetContinuousRendering(bool continuous)
+{
+    pthread_mutex_lock(&frame_mutex);
+    continuous_rendering = continuous;
+    if (continuous) frame_requested = true;
+    pthread_cond_signal(&frame_cond);
+    pthread_mutex_unlock(&frame_mutex);
+}
+
+bool WaitForFrame(void)
+{
+    BeginZone("wait for frame");
+    pthread_mutex_lock(&frame_mutex);
+    while (running && !(frame_requested && pending_callback == NULL))
+    {
+        const uint64_t now = GetCurrentTimeNS();
+        if (frame_deadline != 0 && now >= frame_deadline)
+        {
+            frame_requested = true;
+            frame_deadline = 0;
+            continue;
+        }
+
+        if (pending_callback == NULL && frame_deadline == 0)
+        {
+            pthread_cond_wait(&frame_cond, &frame_mutex);
+            continue;
+        }
+        if (pending_callback == NULL)
+        {
+            // Nothing to wait on but the clock.
+            const uint64_t wait = frame_deadline - now;
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += wait / 1000000000;
+            deadline.tv_nsec += wait % 1000000000;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000;
+            deadline.tv_nsec %= 1000000000;
+            pthread_cond_timedwait(&frame_cond, &frame_mutex, &deadline);
+            continue;
+        }
+
+        // Wait on the outstanding callback, but not forever.
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += FRAME_CALLBACK_TIMEOUT / 10;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000;
+        deadline.tv_nsec %= 1000000000;
+        pthread_cond_timedwait(&frame_cond, &frame_mutex, &deadline);
+
+        if (pending_callback != NULL &&
+            GetCurrentTimeNS() - callback_requested_at >
+                FRAME_CALLBACK_TIMEOUT)
+        {
+            pending_callback = NULL;
+            callback_generation++;
+        }
+    }
+
+    frame_requested = false;
+    bool keep_drawing = running;
+    pthread_mutex_unlock(&frame_mutex);
+    EndZone();
+    return keep_drawing;
+}
+
+void ScheduleFrameCallback(struct wl_surface* surface)
+{
+    pthread_mutex_lock(&frame_mutex);
+    if (pending_callback == NULL)
+    {
+        // The callback can't fire before the surface is committed, so it's
+        // safe to move it onto the frame queue after the fact.
+        pending_callback = wl_surface_frame(surface);
+        wl_proxy_set_queue((struct wl_proxy*)pending_callback,
+                           GetEventQueue(frame_queue));
+        wl_callback_add_listener(pending_callback, &frame_listener,
+                                 (void*)++callback_generation);
+        callback_requested_at = GetCurrentTimeNS();
+    }
+    pthread_mutex_unlock(&frame_mutex);
+}
+
+void CompleteFrame(void)
+{
+    uint64_t now = GetCurrentTimeNS();
+    pthread_mutex_lock(&frame_mutex);
+    if (rate_window_start == 0) rate_window_start = now;
+    rate_window_frames++;
+
+    if (now - rate_window_start >= 1000000000)
+    {
+        achieved_frame_rate =
+            rate_window_frames * 1000000000.0 / (now - rate_window_start);
+        rate_window_start = now;
+        rate_window_frames = 0;
+    }
+    pthread_mutex_unlock(&frame_mutex);
+}
+
+void StopFrameScheduler(void)
+{
+    pthread_mutex_lock(&frame_mutex);
+    pthread_cond_broadcast(&frame_cond);
+    pthread_mutex_unlock(&frame_mutex);
+}
+
+double GetTargetFrameRate(void)
+{
+    pthread_mutex_lock(&frame_mutex);
+    double rate = callback_interval == 0 ? 0 : 1000.0 / callback_interval;
+    pthread_mutex_unlock(&frame_mutex);
+    return rate;
+}
+
+double GetAchievedFrameRate(void)
+{
+    pthread_mutex_lock(&frame_mutex);
+    double rate = achieved_frame_rate;
+    pthread_mutex_unlock(&frame_mutex);
+    return rate;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file Frame.h
+ * @author Israfiel (https://github.com/israfiel-a)
+ * @brief Provides the frame scheduler, which paces the rendering thread
+ * off of the compositor's frame callbacks instead of letting it spin.
+ * @date 2024-08-21
+ *
+ * @copyright (c) 2024 - Israfiel
+ */
+
+#ifndef _MSENG_FRAME_RENDERING_SYSTEM_
+#define _MSENG_FRAME_RENDERING_SYSTEM_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wayland-client-protocol.h>
+
+/**
+ * @brief The longest we'll wait on a frame callback before giving up on
+ * it, in nanoseconds. Compositors withhold callbacks from hidden surfaces,
+ * so this keeps us drawing (slowly) while hidden instead of stalling.
+ */
+#define FRAME_CALLBACK_TIMEOUT 1000000000
+
+/**
+ * @brief Ask for a new frame to be drawn. Any amount of requests made
+ * before the rendering thread gets around to drawing are merged into one
+ * frame. This is safe to call from any thread.
+ */
+void RequestFrame(void);
+
+/**
+ * @brief Ask for a new frame to be drawn once a point in time has been
+ * reached. Only the earliest of any outstanding times is kept. This is
+ * safe to call from any thread.
+ * @param time When the frame is wanted, in nanoseconds, as given by @ref
+ * GetCurrentTimeNS.
+ */
+void RequestFrameAt(uint64_t time);
+
+/**
+ * @brief Set whether or not a new frame is requested automatically every
+ * time the compositor is ready for one. This is on by default; turning it
+ * off means frames are only drawn after a call to @ref RequestFrame.
+ * @param continuous The new continuous rendering state.
+ */
+void SetContinuousRendering(bool continuous);
+
+/**
+ * @brief Block the calling thread until a frame has been requested and
+ * the compositor is ready to take it. This is meant to be called by the
+ * rendering thread, and nothing else.
+ * @return true A frame should be drawn.
+ * @return false The application is shutting down, and the caller should
+ * stop drawing.
+ */
+bool WaitForFrame(void);
+
+/**
+ * @brief Ask the compositor to tell us when it's ready for a new frame of
+ * the given surface. This must be called before the surface's next commit
+ * (i.e. before swapping buffers). If a callback is already outstanding for
+ * this frame, nothing is done.
+ * @param surface The surface about to be committed.
+ */
+void ScheduleFrameCallback(struct wl_surface* surface);
+
+/**
+ * @brief Mark the end of a frame. This is what drives the achieved frame
+ * rate.
+ */
+void CompleteFrame(void);
+
+/**
+ * @brief Wake up anything sitting inside @ref WaitForFrame so it can see
+ * that the application is shutting down.
+ */
+void StopFrameScheduler(void);
+
+/**
+ * @brief Get the frame rate the compositor is asking for, as measured by
+ * the spacing of its frame callbacks.
+ * @return The target frame rate in frames per second, or 0 if there's not
+ * been enough callbacks to tell yet.
+ */
+double GetTargetFrameRate(void);
+
+/**
+ * @brief Get the frame rate we've actually been drawing at, averaged over
+ * the last second or so.
+ * @return The achieved frame rate in frames per second.
+ */
+double GetAchievedFrameRate(void);
+
+#endif // _MSENG_FRAME_RENDERING_SYSTEM_
@@ -1,53 +1,287 @@
 #include "Loop.h"
+#include "Atlas.h"
+#include "Damage.h"
+#include "Frame.h"
+#include "Reload.h"
+#include "Shader.h"
+#include "Sprite.h"
+#include "State.h"
 #include "System.h"
-#include <GLAD/opengl.h> // OpenGL function prototypes
+#include "Target.h"
+#include "Tilemap.h"
+#include <Diagnostic/Statistics.h> // Frame time percentiles
+#include <Diagnostic/Time.h>       // Frame timing
+#include <GLAD/opengl.h>           // OpenGL function prototypes
 #include <Globals.h>
 #include <Memory/Thread.h>
 #include <Output/Error.h> // Error reporting
+#include <Output/Messages.h>
 #include <Windowing/Windowing.h>
 #include <pthread.h>
-#include <stdio.h>
+#include <stdatomic.h>
+
+/**
+ * @brief The handle of the rendering thread, kept so it can be joined on
+ * shutdown.
+ */
+static pthread_t render_thread;
+
+/**
+ * @brief The amount of frames the rendering thread has drawn.
+ */
+static uint64_t frame_count = 0;
+
+/**
+ * @brief The total time, in nanoseconds, spent drawing those frames.
+ */
+static uint64_t frame_time_total = 0;
+
+/**
+ * @brief When the rendering thread was created, in nanoseconds.
+ */
+static uint64_t thread_created_at = 0;
+
+/**
+ * @brief The arena for transient, per-frame allocations. This is reset at
+ * the end of every frame.
+ */
+static arena_t frame_arena;
+
+/**
+ * @brief Whether a panel has been drawn yet this frame.
+ */
+static bool frame_started = false;
+
+/**
+ * @brief What draws the panels' contents, or NULL if nothing does.
+ */
+static _Atomic(panel_draw_function_t) panel_draw_function = NULL;
+
+/**
+ * @brief The simulation state every panel in the current frame draws
+ * from, and the rendering thread's copies of the states it points into.
+ */
+static simulation_frame_t simulation_frame = {NULL, NULL, 1.0};
+static ptr_t drawn_states[2];
+
+/**
+ * @brief Read the last two ticks' states for the coming frame, making
+ * room for them the first time.
+ */
+static void ReadSimulationFrame(void)
+{
+    const size_t size = GetSimulationStateSize();
+    if (size != 0 && drawn_states[0]._p == NULL)
+    {
+        drawn_states[0] = AllocateBlock(size);
+        drawn_states[1] = AllocateBlock(size);
+    }
+
+    simulation_frame.alpha =
+        ReadSimulationState(drawn_states[0]._p, drawn_states[1]._p);
+    simulation_frame.previous = drawn_states[0]._p;
+    simulation_frame.current = drawn_states[1]._p;
+}
+
+void SetPanelDrawFunction(panel_draw_function_t func)
+{
+    atomic_store_explicit(&panel_draw_function, func,
+                          memory_order_release);
+    DamageAllPanels();
+}
 
 static void draw(panel_t* panel, size_t panel_index)
 {
-    EGLContext context = CreateEGLContext(GetEGLContext(panel_index));
-    if (context == NULL) ReportError(egl_context_create_failure);
-    EGLBoolean made_current =
-        eglMakeCurrent(GetEGLDisplay(), panel->_rt, panel->_rt, context);
-    if (!made_current)
+    // Panels with nothing new to show, or that aren't due yet by their
+    // refresh policy, keep the frame they already have; there's no
+    // context switch, swap, or commit for them at all.
+    uint32_t width, height;
+    damage_rect_t damage[DAMAGE_RECT_LIMIT];
+    GetPanelResolution(panel, &width, &height);
+    size_t damage_count = TakePanelDamage(panel, width, height, damage);
+    if (damage_count == 0)
     {
-        printf("\n%d\n", eglGetError());
-        ReportError(egl_window_made_current_failure);
+        CountPanelDamage(panel, NULL, 0);
+        return;
+    }
+
+    BeginZone("panel");
+    // Contexts are created once per panel by BindEGLContext; here we only
+    // make the panel's existing context current.
+    MakeEGLContextCurrent(panel, panel_index);
+    // Anything the asset watcher has finished goes in before the first
+    // panel, so every panel in a frame draws with the same assets.
+    if (!frame_started) ApplyAssetReloads();
+    frame_started = true;
+    // Panels are drawn at their logical resolution, then scaled up onto
+    // the surface once they're done.
+    const bool targeted =
+        BeginPanelTarget(panel, panel_index, &width, &height);
+
+    // The target keeps what was drawn into it last time, so only the
+    // damaged part of it has to be drawn again. The surface doesn't, so
+    // without a target the whole panel is drawn.
+    if (targeted)
+    {
+        const damage_rect_t bounds = GetDamageBounds(damage, damage_count);
+        SetGLScissor(bounds.x, height - bounds.y - bounds.height,
+                     bounds.width, bounds.height);
+        SetGLScissorTest(true);
     }
 
     // Fill the windows with a background color.
     if (panel->type == center_filler) glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
     else glClearColor(1.0f, 0.0f, 0.0f, 1.0f);
-    // Clear the color buffer and force all events to be done.
-    glClear(GL_COLOR_BUFFER_BIT), glFlush();
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // The center panel is the gameplay viewport, so it's the one that
+    // shows the map.
+    BeginZone("tilemap");
+    if (panel->type == center_filler) DrawTilemap(width, height);
+    EndZone();
+
+    // Everything the panel draws goes through one sprite batch.
+    const panel_draw_function_t draw_function =
+        atomic_load_explicit(&panel_draw_function, memory_order_acquire);
+    if (draw_function != NULL)
+    {
+        BeginZone("sprites");
+        BeginSpriteBatch(width, height);
+        draw_function(panel, width, height, &simulation_frame);
+        EndSpriteBatch();
+        EndZone();
+    }
+    SetGLScissorTest(false);
 
-    if (!eglSwapBuffers(GetEGLDisplay(), panel->_rt))
-        ReportError(egl_swap_buffer_failure);
+    if (targeted)
+    {
+        BeginZone("present");
+        PresentPanelTarget(panel, panel_index);
+        EndZone();
+        MapTargetDamage(panel, panel_index, damage, damage_count);
+    }
+    else
+    {
+        damage[0] = (damage_rect_t){0, 0, panel->width, panel->height};
+        damage_count = 1;
+    }
+    CountPanelDamage(panel, damage, damage_count);
+    // Force all events to be done.
+    glFlush();
+
+    // The first panel to commit this frame carries the frame callback that
+    // paces the next one.
+    ScheduleFrameCallback(panel->_s);
+    BeginZone("swap");
+    SwapPanelBuffers(panel, damage, damage_count);
+    EndZone();
+    EndZone();
 }
 
 static pthread_mutex_t render_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t render_cond = PTHREAD_COND_INITIALIZER;
 static void* DrawFunction(void* data)
 {
+    SetZoneThreadName("render");
     pthread_mutex_lock(&render_mutex);
-    while (running)
-    {
-        WaitForDimensionSignal_(&render_mutex);
-        pthread_cond_wait(&render_cond, &render_mutex);
-        pthread_cond_destroy(&render_cond);
-        render_cond = (pthread_cond_t)PTHREAD_COND_INITIALIZER;
+    WaitForDimensionSignal_(&render_mutex);
+    pthread_mutex_unlock(&render_mutex);
 
-        printf("\nrenderingloop\n");
+    // The frame scheduler wakes us once per compositor frame, and only if
+    // there's actually something to draw.
+    while (WaitForFrame())
+    {
+        uint64_t frame_start = GetCurrentTimeNS();
+        BeginZone("frame");
+        frame_started = false;
+        ReadSimulationFrame();
         IteratePanels(draw);
+        EndGLStateFrame();
+        EndZone();
+        const uint64_t frame_end = GetCurrentTimeNS();
+        frame_time_total += frame_end - frame_start;
+        RecordFrameTime(frame_end, frame_end - frame_start);
+        // The first frame is where the shaders and targets are made, so
+        // it's reported as part of startup rather than the run.
+        if (frame_count == 0)
+            ReportMessage("first frame drawn in %lu us, %lu ms after the "
+                          "rendering thread was created",
+                          (frame_end - frame_start) / 1000,
+                          NSEC_TO_MSEC(frame_end - thread_created_at));
+        frame_count++;
+        CompleteFrame();
+        ResetArena(&frame_arena);
+    }
+
+    // The batcher's, tilemap's, atlas', and targets' objects have to go
+    // while a context is still current.
+    DestroySpriteBatcher();
+    DestroyTilemapRenderer();
+    DestroyAtlas();
+    DestroyPanelTargets();
+    // Let go of the last context we used, so that the panels' contexts can
+    // be destroyed from the main thread.
+    ReleaseEGLContext();
+
+    if (drawn_states[0]._p != NULL)
+    {
+        FreeBlock(&drawn_states[0]);
+        FreeBlock(&drawn_states[1]);
     }
-    pthread_mutex_unlock(&render_mutex);
     return NULL;
 }
 
-void CreateRenderingThread(void) { CreateThread(DrawFunction, NULL); }
-void TriggerRender(void) { pthread_cond_signal(&render_cond); }
+void CreateRenderingThread(void)
+{
+    thread_created_at = GetCurrentTimeNS();
+    frame_arena = CreateArena(FRAME_ARENA_SIZE);
+#ifdef MSENG_ZONES
+    // Calibrating takes a moment, which is better spent here than in the
+    // middle of the first frame.
+    CalibratePreciseClock();
+#endif
+    render_thread = CreateThread(DrawFunction, NULL);
+#ifdef DEBUG
+    // Only debug builds copy the assets next to the executable, so that's
+    // the only place there's anything to watch.
+    StartAssetWatcher();
+#endif
+}
+
+void DestroyRenderingThread(void)
+{
+    StopAssetWatcher();
+    // The scheduler checks the running flag after every wakeup, so one
+    // last wakeup is enough to get the thread out.
+    StopFrameScheduler();
+    pthread_join(render_thread, NULL);
+
+    ReportRenderingStatistics();
+    DestroyArena(&frame_arena);
+}
+
+arena_t* GetFrameArena(void) { return &frame_arena; }
+
+uint64_t GetAverageFrameTime(void)
+{
+    if (frame_count == 0) return 0;
+    return frame_time_total / frame_count;
+}
+
+void ReportRenderingStatistics(void)
+{
+    ReportMessage("%lu frame(s) drawn, %lu us average frame time, %.1f "
+                  "fps achieved of %.1f fps target",
+                  frame_count, GetAverageFrameTime() / 1000,
+                  GetAchievedFrameRate(), GetTargetFrameRate());
+    const double frames = frame_count == 0 ? 1.0 : frame_count;
+    ReportMessage("%.2f eglMakeCurrent and %.2f eglSwapBuffers call(s) "
+                  "per frame",
+                  GetEGLBindCount() / frames, GetEGLSwapCount() / frames);
+    ReportMessage("frame arena peaked at %zu of %zu bytes",
+                  frame_arena.peak, frame_arena.block.size);
+    ReportShaderStatistics();
+    ReportGLStateStatistics();
+    ReportDamageStatistics();
+    ReportEGLContexts();
+    ReportZoneStatistics();
+}
@@ -11,10 +11,73 @@
 #ifndef _MSENG_LOOP_RENDERING_SYSTEM_
 #define _MSENG_LOOP_RENDERING_SYSTEM_
 
+#include <Memory/Arena.h>    // Frame arena
+#include <Simulation/Tick.h> // Simulation frames
 // The subwindow interface.
 #include <Windowing/Windowing-Types.h>
 
+/**
+ * @brief The capacity of the frame arena, in bytes.
+ */
+#define FRAME_ARENA_SIZE (1024 * 1024)
+
+/**
+ * @brief A function that draws a panel's contents, by submitting sprites
+ * to the batch through @ref DrawSprite. This is run on the rendering
+ * thread, with the panel's context current, between the panel's map and
+ * the flush of its batch. Only the parts of the panel that were damaged
+ * are redrawn, so anything that changes what this draws has to damage
+ * the panel too (see @file Damage.h).
+ * @param panel The panel being drawn.
+ * @param width The width the panel is drawn at, in pixels.
+ * @param height The height the panel is drawn at, in pixels.
+ * @param frame The simulation state to draw, read once at the start of the
+ * frame so every panel shows the same moment. Anything that moves should
+ * be drawn between the previous and current states by the frame's alpha,
+ * which keeps motion smooth however many frames land in a tick.
+ */
+typedef void (*panel_draw_function_t)(const panel_t* panel, uint32_t width,
+                                      uint32_t height,
+                                      const simulation_frame_t* frame);
+
+/**
+ * @brief Set the function that draws every panel's contents. This is safe
+ * to call from any thread, and takes effect from the next panel drawn.
+ * @param func The function, or NULL to draw nothing over the panels'
+ * backgrounds and maps.
+ */
+void SetPanelDrawFunction(panel_draw_function_t func);
+
 void CreateRenderingThread(void);
-void TriggerRender(void);
+
+/**
+ * @brief Stop and join the rendering thread. This must be called before
+ * the panels' rendering contexts are destroyed, and only once the global
+ * running flag has been cleared.
+ */
+void DestroyRenderingThread(void);
+
+/**
+ * @brief Get the frame arena. Anything allocated from it lives until the
+ * end of the frame it was allocated in, when the whole arena is reset at
+ * once. This must only be used from the rendering thread.
+ * @return A pointer to the frame arena.
+ */
+arena_t* GetFrameArena(void);
+
+/**
+ * @brief Get the average time it took to draw a full frame (every panel)
+ * since the rendering thread was created.
+ * @return The average frame time in nanoseconds, or 0 if nothing has been
+ * drawn yet.
+ */
+uint64_t GetAverageFrameTime(void);
+
+/**
+ * @brief Report the frame count, average frame time, and the state of
+ * every EGL context through the message interface. This is the number to
+ * compare when benchmarking changes to the rendering loop.
+ */
+void ReportRenderingStatistics(void);
 
 #endif // _MSENG_LOOP_RENDERING_SYSTEM_
@@ -0,0 +1,244 @@
+#include "Reload.h"
+#include "Atlas.h"
+#include "Damage.h"
+#include "Shader.h"
+#include "System.h"
+#include <Diagnostic/Time.h> // Rebuild timing
+#include <GLAD/opengl.h>     // EGL function prototypes
+#include <Memory/Thread.h>
+#include <Output/Messages.h>
+#include <Output/Warning.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+/**
+ * @brief A file named by a burst of events, waiting to be rebuilt.
+ */
+typedef struct
+{
+    /**
+     * @brief The watch the event came from, which says which directory
+     * the file is in.
+     */
+    int watch;
+    char name[NAME_MAX + 1];
+} reload_entry_t;
+
+/**
+ * @brief The handle of the watcher thread.
+ */
+static pthread_t watcher_thread;
+
+/**
+ * @brief Whether the watcher thread is running.
+ */
+static bool watcher_running = false;
+
+/**
+ * @brief The inotify instance, and its watches on the atlas and shader
+ * directories.
+ */
+static int inotify_fd = -1, atlas_watch = -1, shader_watch = -1;
+
+/**
+ * @brief Written to by @ref StopAssetWatcher to wake the watcher up and
+ * tell it to leave.
+ */
+static int stop_fd = -1;
+
+/**
+ * @brief Set by the watcher whenever it publishes something, so that the
+ * rendering thread only looks for work when there is some.
+ */
+static atomic_bool reloads_ready = false;
+
+/**
+ * @brief The amount of assets swapped in so far.
+ */
+static size_t reload_count = 0;
+
+/**
+ * @brief Add every event waiting on the inotify instance to the batch,
+ * skipping files that are already in it.
+ * @param batch The batch.
+ * @param length The amount of entries in the batch.
+ */
+static void CollectReloadEvents(reload_entry_t* batch, size_t* length)
+{
+    char buffer[4096]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t read_size = read(inotify_fd, buffer, sizeof(buffer));
+    if (read_size <= 0) return;
+
+    for (char* position = buffer; position < buffer + read_size;)
+    {
+        const struct inotify_event* event = (void*)position;
+        position += sizeof(struct inotify_event) + event->len;
+        if (event->len == 0) continue;
+
+        bool seen = false;
+        for (size_t i = 0; i < *length && !seen; i++)
+            seen = batch[i].watch == event->wd &&
+                   strcmp(batch[i].name, event->name) == 0;
+        if (seen || *length == RELOAD_BATCH_SIZE) continue;
+
+        batch[*length].watch = event->wd;
+        (void)strncpy(batch[*length].name, event->name, NAME_MAX);
+        batch[*length].name[NAME_MAX] = '\0';
+        (*length)++;
+    }
+}
+
+/**
+ * @brief Rebuild everything that uses the files in a batch, and tell the
+ * rendering thread about it.
+ * @param batch The batch.
+ * @param length The amount of entries in the batch.
+ */
+static void RebuildReloadBatch(const reload_entry_t* batch, size_t length)
+{
+    size_t rebuilt = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        uint64_t start = GetCurrentTimeNS();
+        size_t count = 0;
+        if (batch[i].watch == shader_watch)
+            count = RebuildShadersUsing(batch[i].name);
+        else if (batch[i].watch == atlas_watch)
+            count = ReloadAtlasFile(batch[i].name);
+        if (count == 0) continue;
+
+        ReportMessage("reload: %s rebuilt %zu asset(s) in %lu us",
+                      batch[i].name, count,
+                      (GetCurrentTimeNS() - start) / 1000);
+        rebuilt += count;
+    }
+
+    if (rebuilt == 0) return;
+    atomic_store(&reloads_ready, true);
+    // Shaders and atlas pages can be used by any panel, so every panel
+    // has to be drawn again for the change to show up.
+    DamageAllPanels();
+}
+
+/**
+ * @brief Create a context for the watcher, sharing objects with the
+ * panels, and make it current without a surface.
+ * @return The context, or NULL if the driver won't give us one.
+ */
+static void* CreateWatcherContext(void)
+{
+    EGLDisplay display = GetEGLDisplay();
+    if (display == NULL || GetSharedEGLContext() == NULL) return NULL;
+
+    eglBindAPI(EGL_OPENGL_ES_API);
+    EGLContext context = CreateEGLContext(GetSharedEGLContext());
+    if (context == EGL_NO_CONTEXT) return NULL;
+
+    // Binding without a surface needs EGL_KHR_surfaceless_context, which
+    // isn't a given.
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        eglDestroyContext(display, context);
+        return NULL;
+    }
+    return context;
+}
+
+static void* WatchFunction(void* data)
+{
+    SetZoneThreadName("asset watcher");
+    void* context = CreateWatcherContext();
+    if (context == NULL) ReportWarning(unsupported_asset_reload);
+
+    struct pollfd descriptors[2] = {{inotify_fd, POLLIN, 0},
+                                    {stop_fd, POLLIN, 0}};
+    reload_entry_t batch[RELOAD_BATCH_SIZE];
+    size_t length = 0;
+    while (true)
+    {
+        // Sleep until something happens, then keep collecting until the
+        // directory has been quiet for a little while.
+        int timeout = length == 0 ? -1 : RELOAD_SETTLE_TIME;
+        int ready = poll(descriptors, 2, timeout);
+        if (ready < 0) continue;
+        if (descriptors[1].revents & POLLIN) break;
+
+        if (ready > 0)
+        {
+            CollectReloadEvents(batch, &length);
+            continue;
+        }
+
+        BeginZone("reload");
+        if (context != NULL) RebuildReloadBatch(batch, length);
+        EndZone();
+        length = 0;
+    }
+
+    if (context != NULL)
+    {
+        eglMakeCurrent(GetEGLDisplay(), EGL_NO_SURFACE, EGL_NO_SURFACE,
+                       EGL_NO_CONTEXT);
+        eglDestroyContext(GetEGLDisplay(), context);
+    }
+    eglReleaseThread();
+    return NULL;
+}
+
+void StartAssetWatcher(void)
+{
+    if (watcher_running) return;
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (inotify_fd < 0 || stop_fd < 0)
+    {
+        ReportWarning(unsupported_asset_reload);
+        if (inotify_fd >= 0) close(inotify_fd);
+        if (stop_fd >= 0) close(stop_fd);
+        inotify_fd = stop_fd = -1;
+        return;
+    }
+
+    // Editors either write a file in place or write a new one and move it
+    // over the old; either way, the file is finished when these fire.
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO;
+    atlas_watch = inotify_add_watch(inotify_fd, ATLAS_PATH, mask);
+    shader_watch = inotify_add_watch(inotify_fd, SHADER_PATH, mask);
+
+    SetAtlasPixelRetention(true);
+    watcher_thread = CreateThread(WatchFunction, NULL);
+    watcher_running = true;
+}
+
+void StopAssetWatcher(void)
+{
+    if (!watcher_running) return;
+
+    const uint64_t stop = 1;
+    (void)write(stop_fd, &stop, sizeof(stop));
+    pthread_join(watcher_thread, NULL);
+    watcher_running = false;
+
+    close(inotify_fd);
+    close(stop_fd);
+    inotify_fd = stop_fd = atlas_watch = shader_watch = -1;
+}
+
+void ApplyAssetReloads(void)
+{
+    if (!atomic_exchange(&reloads_ready, false)) return;
+
+    reload_count += SwapReloadedShaders();
+    reload_count += SwapReloadedAtlasPages();
+}
+
+size_t GetAssetReloadCount(void) { return reload_count; }
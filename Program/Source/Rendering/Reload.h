@@ -0,0 +1,59 @@
+/**
+ * @file Reload.h
+ * @author Israfiel (https://github.com/israfiel-a)
+ * @brief Provides the asset watcher, which reloads shaders and atlas
+ * images while the application is running. A background thread watches
+ * @ref ATLAS_PATH and @ref SHADER_PATH for changed files, rebuilds
+ * whatever uses them on its own shared context, and hands the results to
+ * the rendering thread, which swaps them in between frames. Nothing is
+ * compiled or uploaded on the rendering thread itself.
+ * @date 2024-08-27
+ *
+ * @copyright (c) 2024 - Israfiel
+ */
+
+#ifndef _MSENG_RELOAD_RENDERING_SYSTEM_
+#define _MSENG_RELOAD_RENDERING_SYSTEM_
+
+#include <stddef.h>
+
+/**
+ * @brief How long the watcher waits for a burst of file events to settle
+ * before rebuilding anything, in milliseconds. Editors tend to write a
+ * file several times over when saving it.
+ */
+#define RELOAD_SETTLE_TIME 50
+
+/**
+ * @brief The most distinct files one burst of events can name. Anything
+ * past this is dropped until the next burst.
+ */
+#define RELOAD_BATCH_SIZE 32
+
+/**
+ * @brief Start the asset watcher thread. This must be called after EGL is
+ * set up, and before any atlas page is uploaded, so that the atlas keeps
+ * the pixels it needs to rebuild pages.
+ */
+void StartAssetWatcher(void);
+
+/**
+ * @brief Stop and join the asset watcher thread, if it's running.
+ */
+void StopAssetWatcher(void);
+
+/**
+ * @brief Swap in whatever the watcher has rebuilt since the last call.
+ * This never waits on the watcher; anything that isn't finished yet is
+ * picked up next frame. This must be called on the rendering thread at a
+ * frame boundary, with a context current.
+ */
+void ApplyAssetReloads(void);
+
+/**
+ * @brief Get the amount of assets that have been swapped in so far.
+ * @return The swap count.
+ */
+size_t GetAssetReloadCount(void);
+
+#endif // _MSENG_RELOAD_RENDERING_SYSTEM_
@@ -1,21 +1,188 @@
 #include "Shader.h"
+#include "State.h"
+#include <Diagnostic/Time.h> // Load timing
 #include <Input/File.h>
+#include <Memory/Allocate.h> // Cache file contents
 #include <Output/Error.h>
+#include <Output/Messages.h> // Statistics reporting
+#include <Output/Warning.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
-shader_component_t CreateShaderComponent(const char* file_path,
-                                         shader_type_t type)
+/**
+ * @brief The first four bytes of every cache file, "MSSC".
+ */
+#define SHADER_CACHE_MAGIC 0x4353534D
+
+/**
+ * @brief The FNV-1a offset basis and prime, for hashing cache keys.
+ */
+#define FNV_OFFSET_BASIS 0xCBF29CE484222325
+#define FNV_PRIME 0x100000001B3
+
+/**
+ * @brief The header at the start of every cache file. The program binary
+ * follows straight after it.
+ */
+typedef struct
+{
+    uint32_t magic;
+    /**
+     * @brief The driver's format for the binary, as given back by
+     * glGetProgramBinaryOES.
+     */
+    uint32_t format;
+    /**
+     * @brief The key the binary was stored under, checked on load in case
+     * the file was renamed or two keys collided in the file name.
+     */
+    uint64_t key;
+} shader_cache_header_t;
+
+/**
+ * @brief The GL_OES_get_program_binary entry points, or NULL if the
+ * driver doesn't support the extension.
+ */
+static PFNGLGETPROGRAMBINARYPROC GetProgramBinary = NULL;
+static PFNGLPROGRAMBINARYPROC ProgramBinary = NULL;
+
+/**
+ * @brief Whether we've looked for the extension yet.
+ */
+static bool binary_support_checked = false;
+
+/**
+ * @brief A program loaded through @ref LoadShader, along with where its
+ * stages came from, so it can be found and rebuilt when they change.
+ */
+typedef struct
+{
+    shader_t shader;
+    const char* vertex_path;
+    const char* fragment_path;
+    /**
+     * @brief A rebuilt program waiting to replace this one, or 0.
+     */
+    atomic_uint_least32_t pending;
+} shader_entry_t;
+
+/**
+ * @brief Every program loaded through @ref LoadShader. This is a fixed
+ * array so that the pointers handed out never move.
+ */
+static shader_entry_t shader_registry[SHADER_REGISTRY_SIZE];
+
+/**
+ * @brief Guards the registry, which is searched from the asset watcher as
+ * well as the rendering thread.
+ */
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief The amount of programs loaded, and how many of those came out of
+ * the cache.
+ */
+static size_t shaders_loaded = 0, shaders_cached = 0;
+
+/**
+ * @brief The total time spent loading programs, in nanoseconds.
+ */
+static uint64_t shader_load_time = 0;
+
+/**
+ * @brief A shader's source, and the block it was read into if it came
+ * from disk rather than the embedded table.
+ */
+typedef struct
 {
-    char full_file_path[256] = SHADER_PATH;
-    (void)strncat(full_file_path, file_path, 255);
+    const char* text;
+    ptr_t contents;
+} shader_source_t;
 
-    char shader_text_contents[SHADER_MAX_LENGTH];
-    ReadFileContents(full_file_path, shader_text_contents,
-                     SHADER_MAX_LENGTH);
-    const char* shader_text = shader_text_contents;
+/**
+ * @brief Whether shaders are read from disk before the embedded table.
+ */
+static bool file_override = false;
 
+const embedded_shader_t* FindEmbeddedShader(const char* name)
+{
+    size_t low = 0, high = embedded_shader_count;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        int comparison = strcmp(name, embedded_shaders[middle].name);
+        if (comparison == 0) return &embedded_shaders[middle];
+        if (comparison < 0) high = middle;
+        else low = middle + 1;
+    }
+    return NULL;
+}
+
+void SetShaderFileOverride(bool enabled) { file_override = enabled; }
+
+/**
+ * @brief Get a shader's source, from the embedded table or from @ref
+ * SHADER_PATH as described in @ref SetShaderFileOverride. If neither has
+ * it, the fatal @enum shader_source_missing is raised.
+ * @param name The shader's file name.
+ * @param prefer_file Whether to try the file before the embedded copy.
+ * @return The source. This must be given back to @ref FreeShaderSource.
+ */
+static shader_source_t GetShaderSource(const char* name, bool prefer_file)
+{
+    shader_source_t source = {NULL, {NULL, 0}};
+    const embedded_shader_t* embedded = FindEmbeddedShader(name);
+    if (embedded != NULL && !prefer_file)
+    {
+        source.text = embedded->source;
+        return source;
+    }
+
+    char full_file_path[PATH_MAX];
+    (void)snprintf(full_file_path, PATH_MAX, SHADER_PATH "%s", name);
+    size_t length = GetFileLength(full_file_path);
+    if (length > 0)
+    {
+        // The file's contents aren't terminated, so leave room for one.
+        source.contents = AllocateZeroedBlock(length + 1);
+        if (ReadFileContents(full_file_path, source.contents._p, length))
+        {
+            source.text = source.contents._p;
+            return source;
+        }
+        FreeBlock(&source.contents);
+    }
+
+    if (embedded == NULL) ReportError(shader_source_missing);
+    source.text = embedded->source;
+    return source;
+}
+
+/**
+ * @brief Let go of a shader's source.
+ * @param source The source.
+ */
+static void FreeShaderSource(shader_source_t* source)
+{
+    if (!CheckBlockNull(source->contents)) FreeBlock(&source->contents);
+    source->text = NULL;
+}
+
+/**
+ * @brief Compile a single shader stage.
+ * @param shader_text The stage's source.
+ * @param type The stage.
+ * @return The compiled shader object, or 0 if it failed to compile.
+ */
+static uint32_t CompileShaderSource(const char* shader_text,
+                                    shader_type_t type)
+{
     uint32_t shader = glCreateShader(type);
     if (shader == 0) ReportError(opengl_shader_creation_failure);
 
@@ -33,18 +200,25 @@ shader_component_t CreateShaderComponent(const char* file_path,
         fprintf(stderr, "Error: compiling %s: %*s\n",
                 type == GL_VERTEX_SHADER ? "vertex" : "fragment", len,
                 log);
-        exit(1);
+        glDeleteShader(shader);
+        return 0;
     }
 
-    return (shader_component_t){shader, full_file_path, type};
+    return shader;
 }
 
-shader_t CreateShader(shader_component_t* vertex,
-                      shader_component_t* fragment)
+/**
+ * @brief Link two compiled stages into a program. The stages are left for
+ * the caller to delete.
+ * @param vertex_id The vertex stage.
+ * @param fragment_id The fragment stage.
+ * @return The linked program, or 0 if it failed to link.
+ */
+static uint32_t LinkShaderProgram(uint32_t vertex_id, uint32_t fragment_id)
 {
     uint32_t program = glCreateProgram();
-    glAttachShader(program, vertex->id);
-    glAttachShader(program, fragment->id);
+    glAttachShader(program, vertex_id);
+    glAttachShader(program, fragment_id);
     glLinkProgram(program);
 
     int compilation_status = 0;
@@ -56,13 +230,65 @@ shader_t CreateShader(shader_component_t* vertex,
         GLsizei len;
         glGetProgramInfoLog(program, 1000, &len, log);
         fprintf(stderr, "Error: linking:\n%*s\n", len, log);
-        exit(1);
+        glDeleteProgram(program);
+        return 0;
     }
 
+    return program;
+}
+
+shader_component_t CreateShaderComponent(const char* file_path,
+                                         shader_type_t type)
+{
+    shader_source_t source = GetShaderSource(file_path, file_override);
+    uint32_t shader = CompileShaderSource(source.text, type);
+    FreeShaderSource(&source);
+    if (shader == 0) exit(1);
+
+    return (shader_component_t){shader, file_path, type};
+}
+
+/**
+ * @brief The names of the attributes and uniforms in @ref
+ * shader_attribute_t and @ref shader_uniform_t, in the same order.
+ */
+static const char* const attribute_names[shader_attribute_count] = {
+    "position", "uv", "tint"};
+static const char* const uniform_names[shader_uniform_count] = {
+    "viewport", "offset"};
+
+/**
+ * @brief Look up a shader's attributes and uniforms, so nothing has to
+ * ask the driver for them while drawing. This has to be redone whenever
+ * the shader's program changes.
+ * @param shader The shader.
+ */
+static void LocateShaderInputs(shader_t* shader)
+{
+    for (size_t i = 0; i < shader_attribute_count; i++)
+        shader->attributes[i] =
+            glGetAttribLocation(shader->id, attribute_names[i]);
+    for (size_t i = 0; i < shader_uniform_count; i++)
+        shader->uniforms[i] =
+            glGetUniformLocation(shader->id, uniform_names[i]);
+
+    // Uniforms start out zeroed in a freshly linked program.
+    shader->viewport_width = 0;
+    shader->viewport_height = 0;
+}
+
+shader_t CreateShader(shader_component_t* vertex,
+                      shader_component_t* fragment)
+{
+    uint32_t program = LinkShaderProgram(vertex->id, fragment->id);
+    if (program == 0) exit(1);
+
     DestroyShaderComponent(vertex);
     DestroyShaderComponent(fragment);
 
-    return (shader_t){true, program};
+    shader_t shader = {true, program};
+    LocateShaderInputs(&shader);
+    return shader;
 }
 
 void DestroyShaderComponent(shader_component_t* component)
@@ -75,7 +301,362 @@ void DestroyShaderComponent(shader_component_t* component)
 
 void DestroyShader(shader_t* shader)
 {
-    glDeleteProgram(shader->id);
+    DeleteGLProgram(shader->id);
     shader->id = 0;
     shader->in_use = false;
 }
+
+/**
+ * @brief Look up the program binary entry points, if the driver has them
+ * and can actually produce a binary format.
+ */
+static void CheckProgramBinarySupport(void)
+{
+    binary_support_checked = true;
+
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    if (extensions == NULL ||
+        strstr(extensions, "GL_OES_get_program_binary") == NULL)
+        return;
+
+    int32_t format_count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    if (format_count == 0) return;
+
+    GetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)eglGetProcAddress(
+        "glGetProgramBinaryOES");
+    ProgramBinary =
+        (PFNGLPROGRAMBINARYPROC)eglGetProcAddress("glProgramBinaryOES");
+    if (GetProgramBinary == NULL || ProgramBinary == NULL)
+    {
+        GetProgramBinary = NULL;
+        ProgramBinary = NULL;
+    }
+}
+
+/**
+ * @brief Fold a string into an FNV-1a hash, followed by a terminator so
+ * that moving text between neighbouring strings changes the hash.
+ * @param hash The hash so far.
+ * @param string The string, or NULL for an empty one.
+ * @return The new hash.
+ */
+static uint64_t HashShaderString(uint64_t hash, const char* string)
+{
+    if (string != NULL)
+    {
+        for (; *string != '\0'; string++)
+        {
+            hash ^= (uint8_t)*string;
+            hash *= FNV_PRIME;
+        }
+    }
+    hash ^= 0xFF;
+    return hash * FNV_PRIME;
+}
+
+/**
+ * @brief Build the name of the cache file for a key.
+ * @param key The key.
+ * @param buffer Where to write the name.
+ * @param buffer_length The size of the buffer.
+ */
+static void GetShaderCachePath(uint64_t key, char* buffer,
+                               size_t buffer_length)
+{
+    (void)snprintf(buffer, buffer_length,
+                   SHADER_CACHE_PATH "%016" PRIx64 ".bin", key);
+}
+
+/**
+ * @brief Try to load a program out of the cache.
+ * @param key The program's key.
+ * @param program Where to write the loaded program.
+ * @return true The program was loaded.
+ * @return false There was no usable binary, and the program has to be
+ * compiled.
+ */
+static bool LoadCachedShader(uint64_t key, uint32_t* program)
+{
+    char cache_path[128];
+    GetShaderCachePath(key, cache_path, sizeof(cache_path));
+
+    size_t length = GetFileLength(cache_path);
+    if (length <= sizeof(shader_cache_header_t)) return false;
+
+    ptr_t contents = AllocateBlock(length);
+    if (!ReadFileContents(cache_path, contents._p, length))
+    {
+        FreeBlock(&contents);
+        return false;
+    }
+
+    const shader_cache_header_t* header = contents._p;
+    bool loaded = false;
+    if (header->magic == SHADER_CACHE_MAGIC && header->key == key)
+    {
+        *program = glCreateProgram();
+        ProgramBinary(*program, header->format, header + 1,
+                      length - sizeof(shader_cache_header_t));
+
+        int32_t link_status = 0;
+        glGetProgramiv(*program, GL_LINK_STATUS, &link_status);
+        loaded = link_status;
+        if (!loaded) glDeleteProgram(*program);
+    }
+    FreeBlock(&contents);
+
+    // Drivers reject binaries they didn't make, or made before an update.
+    // Either way the file is never going to load, so it's thrown out and
+    // replaced once the program has been compiled.
+    if (!loaded)
+    {
+        ReportWarning(rejected_shader_binary);
+        (void)remove(cache_path);
+    }
+    return loaded;
+}
+
+/**
+ * @brief Create @ref SHADER_CACHE_PATH, and every directory above it.
+ * Now that shaders are embedded, the assets directory may not exist at
+ * all.
+ * @return true The directory exists.
+ * @return false The directory couldn't be created.
+ */
+static bool CreateShaderCacheDirectory(void)
+{
+    char path[] = SHADER_CACHE_PATH;
+    for (char* separator = strchr(path + 2, '/'); separator != NULL;
+         separator = strchr(separator + 1, '/'))
+    {
+        *separator = '\0';
+        if (mkdir(path, 0755) == -1 && errno != EEXIST) return false;
+        *separator = '/';
+    }
+    return true;
+}
+
+/**
+ * @brief Write a linked program's binary into the cache. The binary is
+ * written to a temporary file and renamed into place, so a crash midway
+ * through never leaves a truncated binary behind.
+ * @param key The program's key.
+ * @param program The program.
+ */
+static void StoreCachedShader(uint64_t key, uint32_t program)
+{
+    int32_t binary_length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+    if (binary_length <= 0) return;
+
+    ptr_t contents =
+        AllocateBlock(sizeof(shader_cache_header_t) + binary_length);
+    shader_cache_header_t* header = contents._p;
+    GLenum format = 0;
+    GLsizei written = 0;
+    GetProgramBinary(program, binary_length, &written, &format,
+                     header + 1);
+    *header = (shader_cache_header_t){SHADER_CACHE_MAGIC, format, key};
+
+    char cache_path[128], temporary_path[136];
+    GetShaderCachePath(key, cache_path, sizeof(cache_path));
+    (void)snprintf(temporary_path, sizeof(temporary_path), "%s.tmp",
+                   cache_path);
+
+    FILE* cache_file = NULL;
+    if (written > 0 && CreateShaderCacheDirectory())
+        cache_file = fopen(temporary_path, "wb");
+
+    bool stored = false;
+    if (cache_file != NULL)
+    {
+        stored = fwrite(contents._p, 1,
+                        sizeof(shader_cache_header_t) + written,
+                        cache_file) ==
+                 sizeof(shader_cache_header_t) + written;
+        stored = fclose(cache_file) == 0 && stored;
+        stored = stored && rename(temporary_path, cache_path) == 0;
+        if (!stored) (void)remove(temporary_path);
+    }
+    if (!stored) ReportWarning(unwritable_shader_cache);
+    FreeBlock(&contents);
+}
+
+/**
+ * @brief Build a program from a pair of sources, without touching the
+ * cache.
+ * @param vertex_source The vertex stage's source.
+ * @param fragment_source The fragment stage's source.
+ * @return The linked program, or 0 if either stage failed to compile or
+ * the two failed to link.
+ */
+static uint32_t BuildShaderProgram(const char* vertex_source,
+                                   const char* fragment_source)
+{
+    uint32_t vertex_id = CompileShaderSource(vertex_source, vertex);
+    uint32_t fragment_id = CompileShaderSource(fragment_source, fragment);
+    uint32_t program = 0;
+    if (vertex_id != 0 && fragment_id != 0)
+        program = LinkShaderProgram(vertex_id, fragment_id);
+
+    glDeleteShader(vertex_id);
+    glDeleteShader(fragment_id);
+    return program;
+}
+
+shader_t* LoadShader(const char* vertex_path, const char* fragment_path)
+{
+    pthread_mutex_lock(&registry_mutex);
+    shader_entry_t* entry = NULL;
+    for (size_t i = 0; i < SHADER_REGISTRY_SIZE; i++)
+    {
+        shader_entry_t* candidate = &shader_registry[i];
+        if (!candidate->shader.in_use)
+        {
+            if (entry == NULL) entry = candidate;
+            continue;
+        }
+
+        // Anything asking for a program that's already loaded gets the
+        // one that exists.
+        if (strcmp(candidate->vertex_path, vertex_path) == 0 &&
+            strcmp(candidate->fragment_path, fragment_path) == 0)
+        {
+            pthread_mutex_unlock(&registry_mutex);
+            return &candidate->shader;
+        }
+    }
+    if (entry == NULL) ReportError(shader_registry_exhaustion);
+
+    uint64_t start = GetCurrentTimeNS();
+    if (!binary_support_checked) CheckProgramBinarySupport();
+
+    shader_source_t vertex_source =
+        GetShaderSource(vertex_path, file_override);
+    shader_source_t fragment_source =
+        GetShaderSource(fragment_path, file_override);
+
+    // A binary is only good for the exact sources and driver that made
+    // it, so all of them go into the key.
+    uint64_t key = FNV_OFFSET_BASIS;
+    key = HashShaderString(key, vertex_source.text);
+    key = HashShaderString(key, fragment_source.text);
+    key = HashShaderString(key, (const char*)glGetString(GL_VENDOR));
+    key = HashShaderString(key, (const char*)glGetString(GL_RENDERER));
+    key = HashShaderString(key, (const char*)glGetString(GL_VERSION));
+
+    uint32_t program = 0;
+    const bool cached =
+        ProgramBinary != NULL && LoadCachedShader(key, &program);
+    if (cached) shaders_cached++;
+    else
+    {
+        program =
+            BuildShaderProgram(vertex_source.text, fragment_source.text);
+        if (program == 0) exit(1);
+        if (GetProgramBinary != NULL) StoreCachedShader(key, program);
+    }
+    FreeShaderSource(&vertex_source);
+    FreeShaderSource(&fragment_source);
+
+    entry->shader = (shader_t){true, program};
+    LocateShaderInputs(&entry->shader);
+    entry->vertex_path = vertex_path;
+    entry->fragment_path = fragment_path;
+    atomic_store(&entry->pending, 0);
+    pthread_mutex_unlock(&registry_mutex);
+
+    // Programs are loaded the first time something draws with them, so
+    // this is where their share of startup shows up.
+    const uint64_t load_time = GetCurrentTimeNS() - start;
+    shaders_loaded++;
+    shader_load_time += load_time;
+    ReportMessage("shader: %s and %s loaded in %lu us, %s", vertex_path,
+                  fragment_path, load_time / 1000,
+                  cached ? "from the binary cache" : "compiled");
+    return &entry->shader;
+}
+
+void UnloadShader(shader_t* shader)
+{
+    pthread_mutex_lock(&registry_mutex);
+    for (size_t i = 0; i < SHADER_REGISTRY_SIZE; i++)
+    {
+        if (&shader_registry[i].shader != shader) continue;
+
+        uint32_t pending = atomic_exchange(&shader_registry[i].pending, 0);
+        if (pending != 0) glDeleteProgram(pending);
+        break;
+    }
+    DestroyShader(shader);
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+size_t RebuildShadersUsing(const char* name)
+{
+    size_t rebuilt = 0;
+    pthread_mutex_lock(&registry_mutex);
+    for (size_t i = 0; i < SHADER_REGISTRY_SIZE; i++)
+    {
+        shader_entry_t* entry = &shader_registry[i];
+        if (!entry->shader.in_use ||
+            (strcmp(entry->vertex_path, name) != 0 &&
+             strcmp(entry->fragment_path, name) != 0))
+            continue;
+
+        // The whole point is to pick up an edit, so the files come first.
+        shader_source_t vertex_source =
+            GetShaderSource(entry->vertex_path, true);
+        shader_source_t fragment_source =
+            GetShaderSource(entry->fragment_path, true);
+        uint32_t program =
+            BuildShaderProgram(vertex_source.text, fragment_source.text);
+        FreeShaderSource(&vertex_source);
+        FreeShaderSource(&fragment_source);
+
+        // A broken edit keeps the old program running rather than taking
+        // the whole application down.
+        if (program == 0)
+        {
+            ReportWarning(invalid_shader_reload);
+            continue;
+        }
+
+        // Make sure the program is completely built before it's handed
+        // over, so the swap never waits on the driver.
+        glFinish();
+        uint32_t replaced = atomic_exchange(&entry->pending, program);
+        if (replaced != 0) glDeleteProgram(replaced);
+        rebuilt++;
+    }
+    pthread_mutex_unlock(&registry_mutex);
+    return rebuilt;
+}
+
+size_t SwapReloadedShaders(void)
+{
+    size_t swapped = 0;
+    for (size_t i = 0; i < SHADER_REGISTRY_SIZE; i++)
+    {
+        shader_entry_t* entry = &shader_registry[i];
+        uint32_t program = atomic_exchange(&entry->pending, 0);
+        if (program == 0) continue;
+
+        DeleteGLProgram(entry->shader.id);
+        entry->shader.id = program;
+        LocateShaderInputs(&entry->shader);
+        swapped++;
+    }
+    return swapped;
+}
+
+void ReportShaderStatistics(void)
+{
+    ReportMessage("%zu shader program(s) loaded in %lu us, %zu from the "
+                  "binary cache%s",
+                  shaders_loaded, shader_load_time / 1000, shaders_cached,
+                  GetProgramBinary == NULL && binary_support_checked
+                      ? " (unsupported by this driver)"
+                      : "");
+}
@@ -12,9 +12,21 @@
 
 #include <GLAD/opengl.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #define SHADER_PATH "./Assets/Shaders/"
-#define SHADER_MAX_LENGTH 1024
+
+/**
+ * @brief Where linked program binaries are cached between launches. The
+ * directory is created the first time a binary is stored.
+ */
+#define SHADER_CACHE_PATH "./Assets/Shaders/Cache/"
+
+/**
+ * @brief The most programs that can be loaded through @ref LoadShader at
+ * once.
+ */
+#define SHADER_REGISTRY_SIZE 32
 
 typedef enum
 {
@@ -30,12 +42,75 @@ typedef struct
     shader_type_t type;
 } shader_component_t;
 
+/**
+ * @brief The attributes a shader can take, looked up once when it's
+ * linked. Any the shader doesn't have are -1.
+ */
+typedef enum
+{
+    position_attribute,
+    uv_attribute,
+    tint_attribute,
+    shader_attribute_count
+} shader_attribute_t;
+
+/**
+ * @brief The uniforms a shader can take, with the same rules as the
+ * attributes. Samplers aren't here; every sampler starts out on unit 0,
+ * which is the only one we use.
+ */
+typedef enum
+{
+    viewport_uniform,
+    offset_uniform,
+    shader_uniform_count
+} shader_uniform_t;
+
 typedef struct
 {
     bool in_use;
     uint32_t id;
+    int32_t attributes[shader_attribute_count];
+    int32_t uniforms[shader_uniform_count];
+    /**
+     * @brief The last value given to the viewport uniform, kept by @ref
+     * SetShaderViewport.
+     */
+    uint32_t viewport_width;
+    uint32_t viewport_height;
 } shader_t;
 
+/**
+ * @brief A shader embedded into the library at build time. The table of
+ * these is generated by CMake from every file in Assets/Shaders.
+ */
+typedef struct
+{
+    /**
+     * @brief The shader's file name, relative to @ref SHADER_PATH.
+     */
+    const char* name;
+    /**
+     * @brief The shader's source, terminated.
+     */
+    const char* source;
+    /**
+     * @brief The length of the source in bytes, without the terminator.
+     */
+    size_t length;
+} embedded_shader_t;
+
+/**
+ * @brief The embedded shaders, sorted by name and ended by an entry whose
+ * name is NULL.
+ */
+extern const embedded_shader_t embedded_shaders[];
+
+/**
+ * @brief The amount of embedded shaders, not counting the end entry.
+ */
+extern const size_t embedded_shader_count;
+
 shader_component_t CreateShaderComponent(const char* file_path,
                                          shader_type_t type);
 
@@ -45,4 +120,71 @@ shader_t CreateShader(shader_component_t* vertex,
 void DestroyShaderComponent(shader_component_t* component);
 void DestroyShader(shader_t* shader);
 
+/**
+ * @brief Find an embedded shader by its file name.
+ * @param name The shader's file name, relative to @ref SHADER_PATH.
+ * @return The shader, or NULL if nothing by that name was embedded.
+ */
+const embedded_shader_t* FindEmbeddedShader(const char* name);
+
+/**
+ * @brief Read shaders from @ref SHADER_PATH instead of using the embedded
+ * copies, so they can be edited without a rebuild. Shaders that weren't
+ * embedded are always read from disk, and embedded ones are still used if
+ * their file can't be read.
+ * @param enabled Whether to read shaders from disk.
+ */
+void SetShaderFileOverride(bool enabled);
+
+/**
+ * @brief Load a program from a vertex and fragment shader, found by file
+ * name as described in @ref SetShaderFileOverride. If the driver supports
+ * GL_OES_get_program_binary, the linked program is cached under @ref
+ * SHADER_CACHE_PATH, keyed by the sources and the driver's vendor,
+ * renderer, and version, and later loads skip compilation entirely. A
+ * binary the driver rejects is thrown out and the program is compiled as
+ * normal. This must be called with a context current.
+ * @param vertex_path The vertex shader's file. This has to outlive the
+ * program; string literals are best.
+ * @param fragment_path The fragment shader's file, with the same caveat.
+ * @return The program. Asking for the same pair twice gives back the same
+ * program, and the pointer stays valid until @ref UnloadShader, even if
+ * the program is rebuilt underneath it. Don't hold on to its ID across
+ * frames.
+ */
+shader_t* LoadShader(const char* vertex_path, const char* fragment_path);
+
+/**
+ * @brief Delete a program loaded through @ref LoadShader, freeing its
+ * slot. This must be called with a context current.
+ * @param shader The program.
+ */
+void UnloadShader(shader_t* shader);
+
+/**
+ * @brief Rebuild every loaded program that uses a shader file, reading
+ * the files from @ref SHADER_PATH. The new programs aren't used until
+ * @ref SwapReloadedShaders. This is meant for a loader thread with its own
+ * shared context current; a program that fails to build is reported and
+ * the old one is kept.
+ * @param name The changed file's name.
+ * @return The amount of programs rebuilt.
+ */
+size_t RebuildShadersUsing(const char* name);
+
+/**
+ * @brief Swap rebuilt programs in for the ones they replace, deleting the
+ * old ones. This is cheap, and meant to be called on the rendering thread
+ * at a frame boundary.
+ * @return The amount of programs swapped.
+ */
+size_t SwapReloadedShaders(void);
+
+/**
+ * @brief Report how many programs @ref LoadShader has loaded, how long it
+ * spent doing so, and how many came out of the binary cache. Each program
+ * is also reported on its own as it's loaded.
+ */
+void ReportShaderStatistics(void);
+
 #endif // _MSENG_SHADER_RENDERING_SYSTEM_
@@ -0,0 +1,384 @@
+#include "Sprite.h"
+#include "State.h"
+#include <Memory/Array.h> // Sprite and vertex storage
+#include <string.h>
+
+/**
+ * @brief A single corner of a sprite, as it's laid out in the vertex
+ * buffer.
+ */
+typedef struct
+{
+    float x;
+    float y;
+    float u;
+    float v;
+    /**
+     * @brief The tint as normalized RGBA bytes.
+     */
+    uint8_t tint[4];
+} sprite_vertex_t;
+
+/**
+ * @brief A sprite's sort key, alongside the index of the sprite it
+ * belongs to.
+ */
+typedef struct
+{
+    uint64_t key;
+    uint32_t index;
+} sprite_key_t;
+
+/**
+ * @brief A single draw call; a run of sorted sprites sharing a shader and
+ * texture.
+ */
+typedef struct
+{
+    shader_t* shader;
+    uint32_t texture;
+    size_t first;
+    size_t count;
+} sprite_draw_t;
+
+/**
+ * @brief The sprites submitted this batch, in submission order.
+ */
+static flat_array_t sprites;
+
+/**
+ * @brief The sprites' sort keys, and the scratch space the radix sort
+ * ping-pongs through.
+ */
+static flat_array_t keys, scratch_keys;
+
+/**
+ * @brief The built vertices, four per sprite, in sorted order.
+ */
+static flat_array_t vertices;
+
+/**
+ * @brief The draw calls the built batch needs.
+ */
+static flat_array_t draws;
+
+/**
+ * @brief Whether the CPU-side arrays have been created.
+ */
+static bool batcher_created = false;
+
+/**
+ * @brief The size of the panel being drawn to, in pixels.
+ */
+static uint32_t viewport_width = 0, viewport_height = 0;
+
+/**
+ * @brief Whether the OpenGL objects have been created.
+ */
+static bool batcher_uploaded = false;
+
+/**
+ * @brief The vertex buffers the batcher cycles through.
+ */
+static uint32_t vertex_buffers[SPRITE_BUFFER_RING];
+
+/**
+ * @brief The next vertex buffer to stream into.
+ */
+static size_t vertex_buffer_index = 0;
+
+/**
+ * @brief The static index buffer, which holds the two triangles of every
+ * sprite a single draw call can cover.
+ */
+static uint32_t index_buffer = 0;
+
+/**
+ * @brief Whether the driver supports 32-bit indices.
+ */
+static bool int_indices = false;
+
+/**
+ * @brief The most sprites one draw call can cover. This starts at the
+ * 16-bit limit, since that's always safe, and is raised once we know the
+ * driver supports more.
+ */
+static size_t draw_limit = SPRITE_DRAW_LIMIT_SHORT;
+
+/**
+ * @brief A 1x1 white texture, used for untextured sprites.
+ */
+static uint32_t white_texture = 0;
+
+/**
+ * @brief The default sprite shader.
+ */
+static shader_t* default_shader = NULL;
+
+void BeginSpriteBatch(uint32_t width, uint32_t height)
+{
+    if (!batcher_created)
+    {
+        sprites = CreateFlatArray(sizeof(sprite_t), 1024);
+        keys = CreateFlatArray(sizeof(sprite_key_t), 1024);
+        scratch_keys = CreateFlatArray(sizeof(sprite_key_t), 1024);
+        vertices = CreateFlatArray(sizeof(sprite_vertex_t), 4096);
+        draws = CreateFlatArray(sizeof(sprite_draw_t), 64);
+        batcher_created = true;
+    }
+
+    viewport_width = width;
+    viewport_height = height;
+    ClearFlatArray(&sprites);
+    ClearFlatArray(&draws);
+}
+
+void DrawSprite(const sprite_t* sprite)
+{
+    AddFlatArrayValue(&sprites, sprite);
+}
+
+/**
+ * @brief Sort sprite keys with a stable least-significant-digit radix
+ * sort, a byte at a time. Bytes that are the same across every key (most
+ * of them, usually) are skipped.
+ * @param sorted The keys to sort.
+ * @param scratch Scratch space the same size as the keys.
+ * @param count The amount of keys.
+ */
+static void SortSpriteKeys(sprite_key_t* sorted, sprite_key_t* scratch,
+                           size_t count)
+{
+    sprite_key_t* source = sorted;
+    sprite_key_t* destination = scratch;
+    for (uint32_t shift = 0; shift < 64; shift += 8)
+    {
+        size_t buckets[256] = {0};
+        for (size_t i = 0; i < count; i++)
+            buckets[(source[i].key >> shift) & 255]++;
+        if (buckets[(source[0].key >> shift) & 255] == count) continue;
+
+        size_t offset = 0;
+        for (size_t i = 0; i < 256; i++)
+        {
+            size_t bucket_size = buckets[i];
+            buckets[i] = offset;
+            offset += bucket_size;
+        }
+        for (size_t i = 0; i < count; i++)
+            destination[buckets[(source[i].key >> shift) & 255]++] =
+                source[i];
+
+        sprite_key_t* swap = source;
+        source = destination;
+        destination = swap;
+    }
+
+    if (source != sorted)
+        memcpy(sorted, source, count * sizeof(sprite_key_t));
+}
+
+/**
+ * @brief Write out the four corners of a sprite.
+ * @param corners Where to write the corners.
+ * @param sprite The sprite.
+ */
+static void BuildSpriteVertices(sprite_vertex_t* corners,
+                                const sprite_t* sprite)
+{
+    // Colors are 0xAARRGGBB; the shader wants the bytes in RGBA order.
+    const uint8_t tint[4] = {sprite->tint >> 16, sprite->tint >> 8,
+                             sprite->tint, sprite->tint >> 24};
+    const float left = sprite->x, top = sprite->y;
+    const float right = left + sprite->width;
+    const float bottom = top + sprite->height;
+    const float* uv = sprite->uv;
+
+    corners[0] = (sprite_vertex_t){left, top, uv[0], uv[1]};
+    corners[1] = (sprite_vertex_t){right, top, uv[2], uv[1]};
+    corners[2] = (sprite_vertex_t){right, bottom, uv[2], uv[3]};
+    corners[3] = (sprite_vertex_t){left, bottom, uv[0], uv[3]};
+    for (size_t i = 0; i < 4; i++) memcpy(corners[i].tint, tint, 4);
+}
+
+void BuildSpriteBatch(void)
+{
+    ClearFlatArray(&draws);
+    const size_t count = sprites.occupied;
+    if (count == 0) return;
+
+    // Layer, then shader, then texture; anything equal stays in the order
+    // it was submitted.
+    ReserveFlatArray(&keys, count);
+    ReserveFlatArray(&scratch_keys, count);
+    sprite_key_t* sorted = keys._a._p;
+    const sprite_t* submitted = sprites._a._p;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t shader_id =
+            submitted[i].shader == NULL ? 0 : submitted[i].shader->id;
+        sorted[i].key = (uint64_t)submitted[i].layer << 48 |
+                        (shader_id & 0xFFFF) << 32 | submitted[i].texture;
+        sorted[i].index = i;
+    }
+    SortSpriteKeys(sorted, scratch_keys._a._p, count);
+
+    ReserveFlatArray(&vertices, count * 4);
+    vertices.occupied = count * 4;
+    sprite_vertex_t* corners = vertices._a._p;
+    sprite_draw_t* draw = NULL;
+    for (size_t i = 0; i < count; i++)
+    {
+        const sprite_t* sprite = &submitted[sorted[i].index];
+        BuildSpriteVertices(&corners[i * 4], sprite);
+
+        if (draw == NULL || draw->shader != sprite->shader ||
+            draw->texture != sprite->texture || draw->count == draw_limit)
+        {
+            sprite_draw_t next_draw = {sprite->shader, sprite->texture, i,
+                                       0};
+            draw = AddFlatArrayValue(&draws, &next_draw);
+        }
+        draw->count++;
+    }
+}
+
+/**
+ * @brief Create the batcher's OpenGL objects. This happens the first time
+ * there's something to draw, since that's the first time we're sure a
+ * context is current.
+ */
+static void UploadSpriteBatcher(void)
+{
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    int_indices = extensions != NULL &&
+                  strstr(extensions, "GL_OES_element_index_uint") != NULL;
+    draw_limit =
+        int_indices ? SPRITE_DRAW_LIMIT_INT : SPRITE_DRAW_LIMIT_SHORT;
+
+    glGenBuffers(SPRITE_BUFFER_RING, vertex_buffers);
+
+    // Every sprite is two triangles over its four corners, so the indices
+    // are the same pattern over and over.
+    const size_t index_size = int_indices ? 4 : 2;
+    ptr_t indices = AllocateBlock(draw_limit * 6 * index_size);
+    for (size_t i = 0; i < draw_limit; i++)
+    {
+        const uint32_t corner = i * 4;
+        const uint32_t quad[6] = {corner,     corner + 1, corner + 2,
+                                  corner + 2, corner + 3, corner};
+        for (size_t j = 0; j < 6; j++)
+        {
+            if (int_indices) ((uint32_t*)indices._p)[i * 6 + j] = quad[j];
+            else ((uint16_t*)indices._p)[i * 6 + j] = quad[j];
+        }
+    }
+    glGenBuffers(1, &index_buffer);
+    BindGLBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size, indices._p,
+                 GL_STATIC_DRAW);
+    FreeBlock(&indices);
+
+    const uint32_t white = 0xFFFFFFFF;
+    glGenTextures(1, &white_texture);
+    BindGLTexture(0, white_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, &white);
+
+    default_shader =
+        LoadShader(SPRITE_VERTEX_SHADER, SPRITE_FRAGMENT_SHADER);
+
+    batcher_uploaded = true;
+}
+
+void FlushSpriteBatch(void)
+{
+    if (draws.occupied == 0) return;
+    if (!batcher_uploaded) UploadSpriteBatcher();
+
+    // Orphan the next buffer in the ring and stream the whole batch into
+    // it at once.
+    BindGLBuffer(GL_ARRAY_BUFFER, vertex_buffers[vertex_buffer_index]);
+    vertex_buffer_index = (vertex_buffer_index + 1) % SPRITE_BUFFER_RING;
+    glBufferData(GL_ARRAY_BUFFER, vertices.occupied * vertices.stride,
+                 vertices._a._p, GL_STREAM_DRAW);
+    BindGLBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+
+    SetGLBlending(true);
+    SetGLBlendFunction(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    const shader_t* bound_shader = NULL;
+    int32_t position = -1, uv = -1, tint = -1;
+    const sprite_draw_t* sprite_draws = draws._a._p;
+    for (size_t i = 0; i < draws.occupied; i++)
+    {
+        const sprite_draw_t* draw = &sprite_draws[i];
+        shader_t* shader =
+            draw->shader == NULL ? default_shader : draw->shader;
+        if (shader != bound_shader)
+        {
+            SetShaderViewport(shader, viewport_width, viewport_height);
+            position = shader->attributes[position_attribute];
+            uv = shader->attributes[uv_attribute];
+            tint = shader->attributes[tint_attribute];
+            glEnableVertexAttribArray(position);
+            glEnableVertexAttribArray(uv);
+            glEnableVertexAttribArray(tint);
+            bound_shader = shader;
+        }
+
+        BindGLTexture(0,
+                      draw->texture == 0 ? white_texture : draw->texture);
+
+        // There's no base vertex in GLES2, so the attribute pointers are
+        // moved to the start of the run instead.
+        const uintptr_t base = draw->first * 4 * sizeof(sprite_vertex_t);
+        glVertexAttribPointer(position, 2, GL_FLOAT, GL_FALSE,
+                              sizeof(sprite_vertex_t), (void*)base);
+        glVertexAttribPointer(
+            uv, 2, GL_FLOAT, GL_FALSE, sizeof(sprite_vertex_t),
+            (void*)(base + offsetof(sprite_vertex_t, u)));
+        glVertexAttribPointer(
+            tint, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(sprite_vertex_t),
+            (void*)(base + offsetof(sprite_vertex_t, tint)));
+        glDrawElements(GL_TRIANGLES, draw->count * 6,
+                       int_indices ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT,
+                       NULL);
+    }
+
+    glDisableVertexAttribArray(position);
+    glDisableVertexAttribArray(uv);
+    glDisableVertexAttribArray(tint);
+}
+
+void EndSpriteBatch(void)
+{
+    BuildSpriteBatch();
+    FlushSpriteBatch();
+}
+
+size_t GetSpriteDrawCalls(void) { return draws.occupied; }
+
+void DestroySpriteBatcher(void)
+{
+    if (batcher_uploaded)
+    {
+        DeleteGLBuffers(SPRITE_BUFFER_RING, vertex_buffers);
+        DeleteGLBuffers(1, &index_buffer);
+        DeleteGLTextures(1, &white_texture);
+        UnloadShader(default_shader);
+        batcher_uploaded = false;
+    }
+
+    if (batcher_created)
+    {
+        DestroyFlatArray(&sprites);
+        DestroyFlatArray(&keys);
+        DestroyFlatArray(&scratch_keys);
+        DestroyFlatArray(&vertices);
+        DestroyFlatArray(&draws);
+        batcher_created = false;
+    }
+}
@@ -0,0 +1,141 @@
+/**
+ * @file Sprite.h
+ * @author Israfiel (https://github.com/israfiel-a)
+ * @brief Provides the sprite batcher. Sprites are collected over the
+ * course of a panel's draw, sorted so that everything sharing a shader
+ * and texture is together, and then streamed to the GPU and drawn with as
+ * few draw calls as possible--ideally one per texture.
+ * @date 2024-08-23
+ *
+ * @copyright (c) 2024 - Israfiel
+ */
+
+#ifndef _MSENG_SPRITE_RENDERING_SYSTEM_
+#define _MSENG_SPRITE_RENDERING_SYSTEM_
+
+#include "Shader.h"
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * @brief The shader files the default sprite shader is built from, within
+ * @ref SHADER_PATH.
+ */
+#define SPRITE_VERTEX_SHADER "Sprite.vert"
+#define SPRITE_FRAGMENT_SHADER "Sprite.frag"
+
+/**
+ * @brief The amount of vertex buffers the batcher cycles through, so that
+ * we're never writing into a buffer the GPU might still be reading.
+ */
+#define SPRITE_BUFFER_RING 3
+
+/**
+ * @brief The most sprites one draw call can cover when the driver only
+ * supports 16-bit indices (65536 vertices, 4 per sprite).
+ */
+#define SPRITE_DRAW_LIMIT_SHORT 16384
+
+/**
+ * @brief The most sprites one draw call can cover when the driver supports
+ * 32-bit indices. This is also the size of the static index buffer.
+ */
+#define SPRITE_DRAW_LIMIT_INT 131072
+
+/**
+ * @brief A single sprite, as submitted to the batcher.
+ */
+typedef struct
+{
+    /**
+     * @brief The X position of the sprite's top-left corner within the
+     * panel, in pixels.
+     */
+    float x;
+    /**
+     * @brief The Y position of the sprite's top-left corner within the
+     * panel, in pixels.
+     */
+    float y;
+    /**
+     * @brief The width of the sprite in pixels.
+     */
+    float width;
+    /**
+     * @brief The height of the sprite in pixels.
+     */
+    float height;
+    /**
+     * @brief The sprite's texture coordinates; the top-left U and V, then
+     * the bottom-right U and V.
+     */
+    float uv[4];
+    /**
+     * @brief The color to multiply the sprite by, in the same 0xAARRGGBB
+     * form as the colors in @file Colors.h. Use WHITE to draw it as-is.
+     */
+    uint32_t tint;
+    /**
+     * @brief The OpenGL texture the sprite samples. If this is 0, the
+     * sprite is a solid block of its tint.
+     */
+    uint32_t texture;
+    /**
+     * @brief The shader to draw the sprite with, or NULL for the default
+     * sprite shader. Custom shaders must take the same attributes and
+     * uniforms as the default one.
+     */
+    shader_t* shader;
+    /**
+     * @brief The layer the sprite is on. Higher layers draw over lower
+     * ones; within a layer, sprites are grouped by shader and texture,
+     * then drawn in the order they were submitted.
+     */
+    uint16_t layer;
+} sprite_t;
+
+/**
+ * @brief Begin collecting sprites for a panel.
+ * @param width The width of the panel in pixels.
+ * @param height The height of the panel in pixels.
+ */
+void BeginSpriteBatch(uint32_t width, uint32_t height);
+
+/**
+ * @brief Add a sprite to the batch. The sprite is copied, so it doesn't
+ * need to outlive the call.
+ * @param sprite The sprite.
+ */
+void DrawSprite(const sprite_t* sprite);
+
+/**
+ * @brief Sort the batch and build its vertices and draw calls. This is the
+ * CPU half of @ref EndSpriteBatch, and doesn't touch OpenGL.
+ */
+void BuildSpriteBatch(void);
+
+/**
+ * @brief Upload a built batch and draw it. This is the GPU half of @ref
+ * EndSpriteBatch, and must be called with a context current.
+ */
+void FlushSpriteBatch(void);
+
+/**
+ * @brief Build, upload, and draw everything submitted since @ref
+ * BeginSpriteBatch.
+ */
+void EndSpriteBatch(void);
+
+/**
+ * @brief Get the amount of draw calls the last built batch needed.
+ * @return The draw call count.
+ */
+size_t GetSpriteDrawCalls(void);
+
+/**
+ * @brief Destroy the batcher's OpenGL objects and free its memory. This
+ * must be called on the rendering thread, with a context current.
+ */
+void DestroySpriteBatcher(void);
+
+#endif // _MSENG_SPRITE_RENDERING_SYSTEM_
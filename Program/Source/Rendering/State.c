@@ -0,0 +1,286 @@
+#include "State.h"
+#include <GLAD/opengl.h>     // OpenGL function prototypes
+#include <Output/Messages.h> // Statistics reporting
+
+/**
+ * @brief The value of a piece of shadowed state we know nothing about. No
+ * real object, enum, or viewport size is ever this.
+ */
+#define GL_STATE_UNKNOWN UINT32_MAX
+
+/**
+ * @brief Everything shadowed for the context current on one thread.
+ */
+typedef struct
+{
+    /**
+     * @brief Whether the rest of this has been set up yet.
+     */
+    bool valid;
+    uint32_t program;
+    /**
+     * @brief The active texture unit, counting up from 0.
+     */
+    uint32_t active_unit;
+    uint32_t textures[GL_STATE_TEXTURE_UNITS];
+    uint32_t array_buffer;
+    uint32_t element_buffer;
+    uint32_t framebuffer;
+    /**
+     * @brief 1 if blending is on, 0 if it's off.
+     */
+    uint32_t blending;
+    uint32_t blend_source;
+    uint32_t blend_destination;
+    int32_t viewport_x;
+    int32_t viewport_y;
+    uint32_t viewport_width;
+    uint32_t viewport_height;
+    /**
+     * @brief 1 if the scissor test is on, 0 if it's off.
+     */
+    uint32_t scissor_test;
+    int32_t scissor_x;
+    int32_t scissor_y;
+    uint32_t scissor_width;
+    uint32_t scissor_height;
+    /**
+     * @brief The calls passed to the driver and skipped since the last
+     * @ref EndGLStateFrame.
+     */
+    size_t issued;
+    size_t skipped;
+} gl_state_t;
+
+/**
+ * @brief The shadowed state. Every thread with a context has its own,
+ * since bindings belong to the context and a thread only ever has one
+ * current at a time.
+ */
+static _Thread_local gl_state_t state = {false};
+
+/**
+ * @brief The rendering thread's totals over every frame so far, along
+ * with the last and most calls skipped in a frame.
+ */
+static uint64_t issued_total = 0, skipped_total = 0, frames_counted = 0;
+static size_t skipped_last = 0, skipped_peak = 0;
+
+/**
+ * @brief Check a piece of shadowed state against the value a call would
+ * set it to, counting the call either way.
+ * @param shadow The shadowed value.
+ * @param value The new value.
+ * @return true The value changed, and the call has to be made.
+ * @return false The call can be skipped.
+ */
+static bool UpdateGLState(uint32_t* shadow, uint32_t value)
+{
+    if (!state.valid) InvalidateGLState();
+    if (*shadow == value)
+    {
+        state.skipped++;
+        return false;
+    }
+
+    *shadow = value;
+    state.issued++;
+    return true;
+}
+
+void InvalidateGLState(void)
+{
+    state.valid = true;
+    state.program = GL_STATE_UNKNOWN;
+    state.active_unit = GL_STATE_UNKNOWN;
+    for (size_t i = 0; i < GL_STATE_TEXTURE_UNITS; i++)
+        state.textures[i] = GL_STATE_UNKNOWN;
+    state.array_buffer = GL_STATE_UNKNOWN;
+    state.element_buffer = GL_STATE_UNKNOWN;
+    state.framebuffer = GL_STATE_UNKNOWN;
+    state.blending = GL_STATE_UNKNOWN;
+    state.blend_source = GL_STATE_UNKNOWN;
+    state.blend_destination = GL_STATE_UNKNOWN;
+    state.viewport_width = GL_STATE_UNKNOWN;
+    state.scissor_test = GL_STATE_UNKNOWN;
+    state.scissor_width = GL_STATE_UNKNOWN;
+}
+
+void UseGLProgram(uint32_t program)
+{
+    if (UpdateGLState(&state.program, program)) glUseProgram(program);
+}
+
+void BindGLTexture(uint32_t unit, uint32_t texture)
+{
+    if (UpdateGLState(&state.active_unit, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+
+    if (unit >= GL_STATE_TEXTURE_UNITS)
+    {
+        state.issued++;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        return;
+    }
+    if (UpdateGLState(&state.textures[unit], texture))
+        glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void BindGLBuffer(uint32_t target, uint32_t buffer)
+{
+    uint32_t* shadow = target == GL_ELEMENT_ARRAY_BUFFER
+                           ? &state.element_buffer
+                           : &state.array_buffer;
+    if (UpdateGLState(shadow, buffer)) glBindBuffer(target, buffer);
+}
+
+void BindGLFramebuffer(uint32_t framebuffer)
+{
+    if (UpdateGLState(&state.framebuffer, framebuffer))
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void SetGLBlending(bool enabled)
+{
+    if (!UpdateGLState(&state.blending, enabled)) return;
+
+    if (enabled) glEnable(GL_BLEND);
+    else glDisable(GL_BLEND);
+}
+
+void SetGLBlendFunction(uint32_t source, uint32_t destination)
+{
+    // Both factors go in one call, so it only counts once.
+    if (!state.valid) InvalidateGLState();
+    if (state.blend_source == source &&
+        state.blend_destination == destination)
+    {
+        state.skipped++;
+        return;
+    }
+
+    state.blend_source = source;
+    state.blend_destination = destination;
+    state.issued++;
+    glBlendFunc(source, destination);
+}
+
+void SetGLViewport(int32_t x, int32_t y, uint32_t width, uint32_t height)
+{
+    if (!state.valid) InvalidateGLState();
+    if (state.viewport_x == x && state.viewport_y == y &&
+        state.viewport_width == width && state.viewport_height == height)
+    {
+        state.skipped++;
+        return;
+    }
+
+    state.viewport_x = x;
+    state.viewport_y = y;
+    state.viewport_width = width;
+    state.viewport_height = height;
+    state.issued++;
+    glViewport(x, y, width, height);
+}
+
+void SetGLScissorTest(bool enabled)
+{
+    if (!UpdateGLState(&state.scissor_test, enabled)) return;
+
+    if (enabled) glEnable(GL_SCISSOR_TEST);
+    else glDisable(GL_SCISSOR_TEST);
+}
+
+void SetGLScissor(int32_t x, int32_t y, uint32_t width, uint32_t height)
+{
+    if (!state.valid) InvalidateGLState();
+    if (state.scissor_x == x && state.scissor_y == y &&
+        state.scissor_width == width && state.scissor_height == height)
+    {
+        state.skipped++;
+        return;
+    }
+
+    state.scissor_x = x;
+    state.scissor_y = y;
+    state.scissor_width = width;
+    state.scissor_height = height;
+    state.issued++;
+    glScissor(x, y, width, height);
+}
+
+void SetShaderViewport(shader_t* shader, uint32_t width, uint32_t height)
+{
+    UseGLProgram(shader->id);
+    if (shader->viewport_width == width &&
+        shader->viewport_height == height)
+    {
+        state.skipped++;
+        return;
+    }
+
+    shader->viewport_width = width;
+    shader->viewport_height = height;
+    state.issued++;
+    glUniform2f(shader->uniforms[viewport_uniform], width, height);
+}
+
+void DeleteGLProgram(uint32_t program)
+{
+    if (state.valid && state.program == program)
+        state.program = GL_STATE_UNKNOWN;
+    glDeleteProgram(program);
+}
+
+void DeleteGLTextures(size_t count, const uint32_t* textures)
+{
+    // Deleting a bound texture binds 0 in its place.
+    for (size_t i = 0; i < count && state.valid; i++)
+        for (size_t j = 0; j < GL_STATE_TEXTURE_UNITS; j++)
+            if (state.textures[j] == textures[i]) state.textures[j] = 0;
+    glDeleteTextures(count, textures);
+}
+
+void DeleteGLBuffers(size_t count, const uint32_t* buffers)
+{
+    for (size_t i = 0; i < count && state.valid; i++)
+    {
+        if (state.array_buffer == buffers[i]) state.array_buffer = 0;
+        if (state.element_buffer == buffers[i]) state.element_buffer = 0;
+    }
+    glDeleteBuffers(count, buffers);
+}
+
+void DeleteGLFramebuffers(size_t count, const uint32_t* framebuffers)
+{
+    // Deleting the bound framebuffer puts the window surface back.
+    for (size_t i = 0; i < count && state.valid; i++)
+        if (state.framebuffer == framebuffers[i]) state.framebuffer = 0;
+    glDeleteFramebuffers(count, framebuffers);
+}
+
+void EndGLStateFrame(void)
+{
+    issued_total += state.issued;
+    skipped_total += state.skipped;
+    frames_counted++;
+    skipped_last = state.skipped;
+    if (state.skipped > skipped_peak) skipped_peak = state.skipped;
+    state.issued = 0;
+    state.skipped = 0;
+}
+
+size_t GetSkippedGLCalls(void) { return skipped_last; }
+
+void ReportGLStateStatistics(void)
+{
+    const uint64_t total = issued_total + skipped_total;
+    ReportMessage("gl state: %lu of %lu call(s) skipped (%.1f%%), %.1f "
+                  "per frame on average, %zu at most",
+                  skipped_total, total,
+                  total == 0 ? 0.0 : 100.0 * skipped_total / total,
+                  frames_counted == 0
+                      ? 0.0
+                      : (double)skipped_total / frames_counted,
+                  skipped_peak);
+}
@@ -0,0 +1,155 @@
+/**
+ * @file State.h
+ * @author Israfiel (https://github.com/israfiel-a)
+ * @brief Provides the GL state tracker. The program, texture, buffer,
+ * framebuffer, blend, and viewport state most recently set through here
+ * is shadowed on the CPU, and calls that wouldn't change anything are
+ * never handed to the driver. Everything that binds or deletes these
+ * objects on a thread that draws has to go through here, or the shadow
+ * goes stale.
+ * @date 2024-08-28
+ *
+ * @copyright (c) 2024 - Israfiel
+ */
+
+#ifndef _MSENG_STATE_RENDERING_SYSTEM_
+#define _MSENG_STATE_RENDERING_SYSTEM_
+
+#include "Shader.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief The amount of texture units whose bindings are shadowed. Binding
+ * to a unit past these goes straight to the driver.
+ */
+#define GL_STATE_TEXTURE_UNITS 8
+
+/**
+ * @brief Forget everything that's been shadowed, so the next call of each
+ * kind goes to the driver. This has to be called whenever the calling
+ * thread's context changes, and after anything touches state without
+ * going through here.
+ */
+void InvalidateGLState(void);
+
+/**
+ * @brief Make a program current.
+ * @param program The program.
+ */
+void UseGLProgram(uint32_t program);
+
+/**
+ * @brief Bind a 2D texture to a texture unit, switching units if needed.
+ * @param unit The unit, counting up from 0 for GL_TEXTURE0.
+ * @param texture The texture.
+ */
+void BindGLTexture(uint32_t unit, uint32_t texture);
+
+/**
+ * @brief Bind a buffer.
+ * @param target Either GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER.
+ * @param buffer The buffer.
+ */
+void BindGLBuffer(uint32_t target, uint32_t buffer);
+
+/**
+ * @brief Bind a framebuffer.
+ * @param framebuffer The framebuffer, or 0 for the window surface.
+ */
+void BindGLFramebuffer(uint32_t framebuffer);
+
+/**
+ * @brief Turn blending on or off.
+ * @param enabled Whether to blend.
+ */
+void SetGLBlending(bool enabled);
+
+/**
+ * @brief Set the blend function.
+ * @param source The source factor.
+ * @param destination The destination factor.
+ */
+void SetGLBlendFunction(uint32_t source, uint32_t destination);
+
+/**
+ * @brief Set the viewport.
+ * @param x The X position of the viewport's bottom-left corner.
+ * @param y The Y position of the viewport's bottom-left corner.
+ * @param width The width of the viewport.
+ * @param height The height of the viewport.
+ */
+void SetGLViewport(int32_t x, int32_t y, uint32_t width, uint32_t height);
+
+/**
+ * @brief Turn the scissor test on or off.
+ * @param enabled Whether to scissor.
+ */
+void SetGLScissorTest(bool enabled);
+
+/**
+ * @brief Set the scissor box.
+ * @param x The X position of the box's bottom-left corner.
+ * @param y The Y position of the box's bottom-left corner.
+ * @param width The width of the box.
+ * @param height The height of the box.
+ */
+void SetGLScissor(int32_t x, int32_t y, uint32_t width, uint32_t height);
+
+/**
+ * @brief Set a shader's viewport uniform, making the shader current on the
+ * way. The last value is kept in the shader itself, since uniforms belong
+ * to the program rather than the context.
+ * @param shader The shader.
+ * @param width The width of the viewport in pixels.
+ * @param height The height of the viewport in pixels.
+ */
+void SetShaderViewport(shader_t* shader, uint32_t width, uint32_t height);
+
+/**
+ * @brief Delete a program, forgetting it if it's current.
+ * @param program The program.
+ */
+void DeleteGLProgram(uint32_t program);
+
+/**
+ * @brief Delete textures, forgetting any that are bound.
+ * @param count The amount of textures.
+ * @param textures The textures.
+ */
+void DeleteGLTextures(size_t count, const uint32_t* textures);
+
+/**
+ * @brief Delete buffers, forgetting any that are bound.
+ * @param count The amount of buffers.
+ * @param buffers The buffers.
+ */
+void DeleteGLBuffers(size_t count, const uint32_t* buffers);
+
+/**
+ * @brief Delete framebuffers, forgetting any that are bound.
+ * @param count The amount of framebuffers.
+ * @param framebuffers The framebuffers.
+ */
+void DeleteGLFramebuffers(size_t count, const uint32_t* framebuffers);
+
+/**
+ * @brief Close out the rendering thread's counts for the frame. This must
+ * be called on the rendering thread once every frame.
+ */
+void EndGLStateFrame(void);
+
+/**
+ * @brief Get the amount of calls skipped during the last frame.
+ * @return The skipped call count.
+ */
+size_t GetSkippedGLCalls(void);
+
+/**
+ * @brief Report how many calls have been skipped and passed through over
+ * every frame so far.
+ */
+void ReportGLStateStatistics(void);
+
+#endif // _MSENG_STATE_RENDERING_SYSTEM_
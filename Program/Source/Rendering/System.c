@@ -1,12 +1,16 @@
 #include "System.h"
-#include <GLAD/opengl.h>  // OpenGL function prototypes
-#include <Output/Error.h> // Error reporting
+#include "State.h"
+#include <Diagnostic/Time.h> // Context creation timing
+#include <GLAD/opengl.h>     // OpenGL function prototypes
+#include <Output/Error.h>    // Error reporting
+#include <Output/Messages.h>
 #include <Output/Warning.h>
 #include <Windowing/Wayland.h> // Wayland display
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wayland-egl-core.h>
 
 /**
@@ -22,13 +26,92 @@ static EGLDisplay display = NULL;
 static EGLConfig config = NULL;
 
 /**
- * @brief A list of contexts that we use to store the rendering contexts
- * for all surfaces.
+ * @brief A record of a single panel's rendering context. Each context is
+ * created exactly once, when its panel is bound, and lives until that
+ * panel is unbound.
  */
-static EGLContext* contexts = NULL;
+typedef struct
+{
+    /**
+     * @brief The EGL context itself, or EGL_NO_CONTEXT if the slot's
+     * context has already been destroyed.
+     */
+    EGLContext handle;
+    /**
+     * @brief How long, in nanoseconds, the driver took to create the
+     * context.
+     */
+    uint64_t creation_cost;
+    /**
+     * @brief How many times the context has actually been made current.
+     * Redundant binds are skipped and not counted.
+     */
+    uint64_t bind_count;
+    /**
+     * @brief Whether or not the swap interval of the panel's surface has
+     * been set yet. This can only be done while the surface is current.
+     */
+    bool interval_set;
+} context_record_t;
+
+/**
+ * @brief The rendering contexts of all surfaces, indexed by panel index.
+ * This is never reallocated, because the rendering thread writes into its
+ * panels' records while the main thread may still be binding new panels.
+ */
+static context_record_t contexts[PANEL_TYPE_COUNT];
 
+/**
+ * @brief The amount of slots within @ref contexts, live or not.
+ */
 static size_t context_count = 0;
 
+/**
+ * @brief The amount of contexts that currently exist, including the root
+ * context.
+ */
+static size_t live_context_count = 0;
+
+/**
+ * @brief The root rendering context, created by @ref SetupEGL. In @enum
+ * single_context mode every panel renders through this context; in @enum
+ * grouped_contexts mode every panel's context shares its objects with it.
+ * Either way, anything uploaded through one panel is visible to all of
+ * them.
+ */
+static EGLContext root_context = EGL_NO_CONTEXT;
+
+/**
+ * @brief How long, in nanoseconds, the driver took to create the root
+ * context.
+ */
+static uint64_t root_context_cost = 0;
+
+/**
+ * @brief The way panels are given rendering contexts. This can only be
+ * changed before the first panel is bound.
+ */
+static egl_context_mode_t context_mode = single_context;
+
+/**
+ * @brief The signature shared by the KHR and EXT versions of
+ * eglSwapBuffersWithDamage.
+ */
+typedef EGLBoolean (*swap_with_damage_t)(EGLDisplay, EGLSurface, EGLint*,
+                                         EGLint);
+
+/**
+ * @brief The driver's eglSwapBuffersWithDamage, or NULL if it doesn't have
+ * one. This is looked up by @ref SetupEGL.
+ */
+static swap_with_damage_t swap_with_damage = NULL;
+
+/**
+ * @brief The amount of times panels have actually been made current, and
+ * had their buffers swapped.
+ */
+static uint64_t bind_total = 0, swap_total = 0;
+
 void SetupEGL(void)
 {
     if (GetDisplay() == NULL)
@@ -37,7 +120,7 @@ void SetupEGL(void)
         return;
     }
 
-    if (display != NULL || config != NULL || contexts != NULL)
+    if (display != NULL || config != NULL)
     {
         ReportWarning(double_egl_setup);
         return;
@@ -48,6 +131,15 @@ void SetupEGL(void)
     if (!eglInitialize(display, NULL, NULL))
         ReportError(egl_initialization_failure);
 
+    const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (extensions == NULL) extensions = "";
+    if (strstr(extensions, "EGL_KHR_swap_buffers_with_damage"))
+        swap_with_damage = (swap_with_damage_t)eglGetProcAddress(
+            "eglSwapBuffersWithDamageKHR");
+    else if (strstr(extensions, "EGL_EXT_swap_buffers_with_damage"))
+        swap_with_damage = (swap_with_damage_t)eglGetProcAddress(
+            "eglSwapBuffersWithDamageEXT");
+
     EGLint n, config_attribs[] = {EGL_SURFACE_TYPE,
                                   EGL_WINDOW_BIT,
                                   EGL_RED_SIZE,
@@ -63,7 +155,15 @@ void SetupEGL(void)
                                   EGL_NONE};
     if (!eglChooseConfig(display, config_attribs, &config, 1, &n))
         ReportError(egl_config_failure);
-    contexts = malloc(sizeof(void*));
+
+    // Create the root context up front, so that every context we make
+    // afterward can join its share group.
+    uint64_t creation_start = GetCurrentTimeNS();
+    root_context = CreateEGLContext(EGL_NO_CONTEXT);
+    if (root_context == EGL_NO_CONTEXT)
+        ReportError(egl_context_create_failure);
+    root_context_cost = GetCurrentTimeNS() - creation_start;
+    live_context_count = 1;
 }
 
 void DestroyEGL(void)
@@ -74,10 +174,18 @@ void DestroyEGL(void)
         return;
     }
 
+    if (eglGetCurrentContext() == root_context)
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                       EGL_NO_CONTEXT);
+    eglDestroyContext(display, root_context);
+    root_context = EGL_NO_CONTEXT;
+
     eglTerminate(display);
     display = NULL;
+    swap_with_damage = NULL;
     config = NULL;
-    free(contexts);
+    context_count = 0;
+    live_context_count = 0;
 
     eglReleaseThread();
 }
@@ -94,14 +202,31 @@ void BindEGLContext(panel_t* panel)
         ReportWarning(unknown_egl_context);
         return;
     }
+    if (context_count >= PANEL_TYPE_COUNT)
+    {
+        ReportWarning(excess_egl_context_creation);
+        return;
+    }
 
-    // Fill out each context with the information we need, including the
-    // fact that we're using OpenGL ES v2.0.
-    EGLint context_attribs[] = {EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE};
+    // In single-context mode the panel simply borrows the root context,
+    // and the rendering loop only ever switches surfaces. Otherwise, the
+    // panel's context is created once, here, inside the root context's
+    // share group, and the rendering loop reuses it every frame.
+    EGLContext context = root_context;
+    uint64_t creation_cost = 0;
+    if (context_mode == grouped_contexts)
+    {
+        uint64_t creation_start = GetCurrentTimeNS();
+        context = CreateEGLContext(root_context);
+        if (context == EGL_NO_CONTEXT)
+            ReportError(egl_context_create_failure);
+        creation_cost = GetCurrentTimeNS() - creation_start;
+        live_context_count++;
+    }
+
+    contexts[context_count] =
+        (context_record_t){context, creation_cost, 0, false};
     context_count++;
-    contexts = realloc(contexts, sizeof(void*) * context_count);
-    contexts[context_count - 1] =
-        eglCreateContext(display, config, NULL, context_attribs);
 
     panel->_es = wl_egl_window_create(panel->_s, 1, 1);
     if (panel->_es == NULL) ReportError(allocation_failure);
@@ -124,12 +249,77 @@ void UnbindEGLContext(panel_t* panel, size_t panel_index)
         return;
     }
 
-    wl_egl_window_destroy(panel->_es);
+    if (panel_index >= context_count ||
+        contexts[panel_index].handle == EGL_NO_CONTEXT)
+    {
+        ReportWarning(unknown_egl_context);
+        return;
+    }
+
+    // If the context or surface is still current on this thread, release
+    // them first so the destruction below actually happens now instead of
+    // whenever the thread next switches contexts.
+    if (eglGetCurrentContext() == contexts[panel_index].handle ||
+        eglGetCurrentSurface(EGL_DRAW) == panel->_rt)
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                       EGL_NO_CONTEXT);
+
     eglDestroySurface(display, panel->_rt);
+    wl_egl_window_destroy(panel->_es);
     panel->_es = NULL;
     panel->_rt = NULL;
 
-    eglDestroyContext(display, contexts[panel_index]);
+    // The root context is shared by every panel, and is only destroyed by
+    // DestroyEGL.
+    if (contexts[panel_index].handle != root_context)
+    {
+        eglDestroyContext(display, contexts[panel_index].handle);
+        live_context_count--;
+    }
+    contexts[panel_index].handle = EGL_NO_CONTEXT;
+}
+
+void MakeEGLContextCurrent(panel_t* panel, size_t panel_index)
+{
+    if (panel == NULL || panel->_rt == NULL ||
+        panel_index >= context_count)
+    {
+        ReportWarning(unknown_egl_context);
+        return;
+    }
+
+    context_record_t* record = &contexts[panel_index];
+    // Only switch if something actually changed; with one panel this
+    // means we bind exactly once for the lifetime of the thread.
+    EGLContext current = eglGetCurrentContext();
+    if (current == record->handle &&
+        eglGetCurrentSurface(EGL_DRAW) == panel->_rt)
+        return;
+
+    if (!eglMakeCurrent(display, panel->_rt, panel->_rt, record->handle))
+        ReportError(egl_window_made_current_failure);
+    record->bind_count++;
+    bind_total++;
+    // Bindings belong to the context, so whatever we knew about the last
+    // context's is meaningless for this one. A surface-only switch keeps
+    // them all.
+    if (current != record->handle) InvalidateGLState();
+
+    // Pacing is done by the frame scheduler, so swaps shouldn't also block
+    // on EGL's own frame callbacks.
+    if (!record->interval_set)
+    {
+        eglSwapInterval(display, 0);
+        record->interval_set = true;
+    }
+}
+
+void ReleaseEGLContext(void)
+{
+    if (display == NULL) return;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                   EGL_NO_CONTEXT);
+    eglReleaseThread();
 }
 
 void ResizeEGLRenderingArea(panel_t* panel)
@@ -139,11 +329,87 @@ void ResizeEGLRenderingArea(panel_t* panel)
     wl_egl_window_resize(panel->_es, panel->width, panel->height, 0, 0);
 }
 
+void SwapPanelBuffers(panel_t* panel, const damage_rect_t* rects,
+                      size_t count)
+{
+    if (count > DAMAGE_RECT_LIMIT) count = DAMAGE_RECT_LIMIT;
+
+    EGLBoolean swapped;
+    if (swap_with_damage != NULL)
+    {
+        // EGL counts rectangles up from the bottom-left corner.
+        EGLint flipped[DAMAGE_RECT_LIMIT * 4];
+        for (size_t i = 0; i < count; i++)
+        {
+            flipped[i * 4] = rects[i].x;
+            flipped[i * 4 + 1] = (EGLint)panel->height - rects[i].y -
+                                 (EGLint)rects[i].height;
+            flipped[i * 4 + 2] = rects[i].width;
+            flipped[i * 4 + 3] = rects[i].height;
+        }
+        swapped =
+            swap_with_damage(display, panel->_rt, flipped, (EGLint)count);
+    }
+    else
+    {
+        // The swap commits the surface, so this damage goes in with it.
+        for (size_t i = 0; i < count; i++)
+            DamageSurfaceBuffer(panel->_s, rects[i].x, rects[i].y,
+                                rects[i].width, rects[i].height);
+        swapped = eglSwapBuffers(display, panel->_rt);
+    }
+
+    if (!swapped) ReportError(egl_swap_buffer_failure);
+    swap_total++;
+}
+
+uint64_t GetEGLBindCount(void) { return bind_total; }
+uint64_t GetEGLSwapCount(void) { return swap_total; }
+
 EGLDisplay GetEGLDisplay(void) { return display; }
 
 EGLContext GetEGLContext(size_t panel_index)
 {
-    return contexts[panel_index];
+    if (panel_index >= context_count) return EGL_NO_CONTEXT;
+    return contexts[panel_index].handle;
+}
+
+EGLContext GetSharedEGLContext(void) { return root_context; }
+
+void SetEGLContextMode(egl_context_mode_t mode)
+{
+    if (context_count != 0)
+    {
+        ReportWarning(late_egl_context_mode_set);
+        return;
+    }
+    context_mode = mode;
+}
+
+egl_context_mode_t GetEGLContextMode(void) { return context_mode; }
+
+size_t GetEGLContextCount(void) { return live_context_count; }
+
+uint64_t GetEGLContextCost(size_t panel_index)
+{
+    if (panel_index >= context_count) return 0;
+    return contexts[panel_index].creation_cost;
+}
+
+void ReportEGLContexts(void)
+{
+    ReportMessage("%zu live EGL context(s), %s mode, root created in "
+                  "%lu us",
+                  live_context_count,
+                  context_mode == single_context ? "single" : "grouped",
+                  root_context_cost / 1000);
+    for (size_t i = 0; i < context_count; i++)
+    {
+        if (contexts[i].handle == EGL_NO_CONTEXT) continue;
+        ReportMessage("panel %zu: created in %lu us, bound %lu time(s)",
+                      i, contexts[i].creation_cost / 1000,
+                      contexts[i].bind_count);
+    }
 }
 
 void* CreateEGLContext(EGLContext share_context)
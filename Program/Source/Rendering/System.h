@@ -12,9 +12,31 @@
 #ifndef _MSENG_SYSTEM_RENDERING_SYSTEM_
 #define _MSENG_SYSTEM_RENDERING_SYSTEM_
 
+#include "Damage.h"
 // The subwindow interface.
 #include <Windowing/Windowing-Types.h>
 
+/**
+ * @brief The ways panels can be given rendering contexts. In both modes,
+ * every context lives in the same share group, so shaders, textures, and
+ * buffers only ever need to be uploaded once.
+ */
+typedef enum
+{
+    /**
+     * @brief Every panel renders through the one root context, and moving
+     * between panels only switches the current surface. This is the
+     * default.
+     */
+    single_context,
+    /**
+     * @brief Every panel gets its own context, each sharing its objects
+     * with the root context. This costs a context per panel, but keeps
+     * things like bound state separate between panels.
+     */
+    grouped_contexts
+} egl_context_mode_t;
+
 /**
  * @brief Setup our OpenGL ES bridge, EGL. This will fail if the Wayland
  * display has not been initialized. We configure EGL with the config
@@ -31,7 +53,8 @@ void DestroyEGL(void);
 /**
  * @brief Bind an EGL context to the given subwindow. This creates both an
  * EGL window and EGL surface, and stores both within the @struct
- * subwindow_t passed into the function.
+ * subwindow_t passed into the function. Only one context can be bound per
+ * panel type; binds past that are refused with a warning.
  * @param subwindow The subwindow we want to create a rendering context
  * for. If this is NULL, we, of course, do nothing.
  * @param type The type of window being passed in. If this value is @enum
@@ -61,10 +84,96 @@ void UnbindEGLContext(panel_t* subwindow, size_t panel_index);
  */
 void ResizeEGLRenderingArea(panel_t* subwindow);
 
+/**
+ * @brief Make the given panel's rendering context current on the calling
+ * thread, targeting the panel's surface. If the context and surface are
+ * already current, nothing is done, so this is cheap to call every frame.
+ * @param panel The panel to render to.
+ * @param panel_index The index of the panel, which is also the index of
+ * its rendering context.
+ */
+void MakeEGLContextCurrent(panel_t* panel, size_t panel_index);
+
+/**
+ * @brief Release whatever context is current on the calling thread. This
+ * should be called by a rendering thread before it exits, so its contexts
+ * can be destroyed cleanly.
+ */
+void ReleaseEGLContext(void);
+
+/**
+ * @brief Swap a panel's buffers, telling the compositor which parts of
+ * the new frame changed. This goes through
+ * EGL_KHR_swap_buffers_with_damage when the driver has it, and straight
+ * onto the panel's surface otherwise. The panel's context must be
+ * current.
+ * @param panel The panel.
+ * @param rects The damage, in surface pixels from the top-left corner.
+ * @param count The amount of rectangles.
+ */
+void SwapPanelBuffers(panel_t* panel, const damage_rect_t* rects,
+                      size_t count);
+
+/**
+ * @brief Get the amount of times a panel's context has actually been made
+ * current; that is, not counting the binds skipped because nothing
+ * changed.
+ * @return The amount of eglMakeCurrent calls.
+ */
+uint64_t GetEGLBindCount(void);
+
+/**
+ * @brief Get the amount of times a panel's buffers have been swapped.
+ * @return The amount of swaps, with or without damage.
+ */
+uint64_t GetEGLSwapCount(void);
+
 void* GetEGLDisplay(void);
 
 void* GetEGLContext(size_t panel_index);
 
 void* CreateEGLContext(void* share_context);
 
+/**
+ * @brief Get the root rendering context, the one every other context
+ * shares its objects with. This is what a loader thread should pass to
+ * @ref CreateEGLContext to upload resources for the panels.
+ * @return The root context, or NULL if EGL is not set up.
+ */
+void* GetSharedEGLContext(void);
+
+/**
+ * @brief Choose how panels are given rendering contexts. This must be
+ * called before the first panel is created; afterward, the warning @enum
+ * late_egl_context_mode_set is raised and nothing is changed.
+ * @param mode The requested mode.
+ */
+void SetEGLContextMode(egl_context_mode_t mode);
+
+/**
+ * @brief Get the way panels are currently given rendering contexts.
+ * @return The context mode.
+ */
+egl_context_mode_t GetEGLContextMode(void);
+
+/**
+ * @brief Get the amount of EGL rendering contexts currently alive.
+ * @return The context count.
+ */
+size_t GetEGLContextCount(void);
+
+/**
+ * @brief Get how long the given panel's context took to create.
+ * @param panel_index The index of the panel.
+ * @return The creation time in nanoseconds, or 0 if there is no such
+ * context.
+ */
+uint64_t GetEGLContextCost(size_t panel_index);
+
+/**
+ * @brief Report the count, creation cost, and bind count of every living
+ * EGL context through the message interface.
+ */
+void ReportEGLContexts(void);
+
 #endif // _MSENG_SYSTEM_RENDERING_SYSTEM_
@@ -0,0 +1,290 @@
+#include "Target.h"
+#include "Shader.h"
+#include "State.h"
+#include <GLAD/opengl.h> // OpenGL function prototypes
+#include <Globals.h>     // Monitor dimensions
+#include <Output/Warning.h>
+
+/**
+ * @brief A panel's render target.
+ */
+typedef struct
+{
+    uint32_t framebuffer;
+    /**
+     * @brief The texture the framebuffer draws into.
+     */
+    uint32_t texture;
+    /**
+     * @brief The logical size of the target, in pixels, or 0 if it hasn't
+     * been made yet.
+     */
+    uint32_t width;
+    uint32_t height;
+    /**
+     * @brief The context the framebuffer was made in. Unlike textures,
+     * framebuffers aren't shared between contexts.
+     */
+    void* context;
+    /**
+     * @brief Whether the driver refused to complete the framebuffer, in
+     * which case the panel is drawn straight to its surface from then on.
+     */
+    bool failed;
+} panel_target_t;
+
+/**
+ * @brief Every panel's render target, by panel index.
+ */
+static panel_target_t targets[PANEL_TYPE_COUNT];
+
+/**
+ * @brief The quad targets are presented with, covering the whole
+ * viewport as a triangle strip.
+ */
+static uint32_t quad_buffer = 0;
+
+/**
+ * @brief The presenting shader.
+ */
+static shader_t* present_shader = NULL;
+
+/**
+ * @brief Get the whole number the center panel is scaled up by, which
+ * every other panel shares.
+ * @return The scale, which is at least 1.
+ */
+static uint32_t GetCenterScale(void)
+{
+    const uint32_t scale = dimensions.shortest_side / TARGET_CENTER_SIZE;
+    return scale == 0 ? 1 : scale;
+}
+
+void GetPanelResolution(const panel_t* panel, uint32_t* width,
+                        uint32_t* height)
+{
+    // A monitor too small for the center panel's logical size gets a
+    // target shrunk to fit, drawn at 1x, rather than one that's cropped.
+    if (panel->type == center_filler)
+    {
+        *width = panel->width < TARGET_CENTER_SIZE ? panel->width
+                                                   : TARGET_CENTER_SIZE;
+        *height = panel->height < TARGET_CENTER_SIZE ? panel->height
+                                                     : TARGET_CENTER_SIZE;
+        return;
+    }
+
+    // Rounding down keeps the panel's pixels the same size as the center
+    // panel's; rounding up could leave too few whole multiples to reach
+    // the center's scale. What doesn't divide evenly goes to the bars.
+    const uint32_t scale = GetCenterScale();
+    *width = panel->width / scale;
+    *height = panel->height / scale;
+    if (*width == 0 && panel->width != 0) *width = 1;
+    if (*height == 0 && panel->height != 0) *height = 1;
+}
+
+uint32_t GetPanelScale(const panel_t* panel)
+{
+    uint32_t width, height;
+    GetPanelResolution(panel, &width, &height);
+    if (width == 0 || height == 0) return 1;
+
+    uint32_t scale_x = panel->width / width;
+    uint32_t scale_y = panel->height / height;
+    uint32_t scale = scale_x < scale_y ? scale_x : scale_y;
+    // A sliver narrower than the scale could fit more multiples of its
+    // one pixel than the center panel uses.
+    const uint32_t center_scale = GetCenterScale();
+    if (scale > center_scale) scale = center_scale;
+    return scale == 0 ? 1 : scale;
+}
+
+/**
+ * @brief Delete a target's objects. The framebuffer is only deleted if
+ * the context it was made in is current.
+ * @param target The target.
+ */
+static void DeletePanelTarget(panel_target_t* target)
+{
+    if (target->texture != 0) DeleteGLTextures(1, &target->texture);
+    if (target->framebuffer != 0 &&
+        target->context == eglGetCurrentContext())
+        DeleteGLFramebuffers(1, &target->framebuffer);
+    target->framebuffer = 0;
+    target->texture = 0;
+    target->width = 0;
+    target->height = 0;
+}
+
+/**
+ * @brief Make a target's texture and framebuffer, replacing any that
+ * already exist.
+ * @param target The target.
+ * @param width The logical width, in pixels.
+ * @param height The logical height, in pixels.
+ * @return true The target is ready to draw into.
+ * @return false The driver wouldn't complete the framebuffer.
+ */
+static bool CreatePanelTarget(panel_target_t* target, uint32_t width,
+                              uint32_t height)
+{
+    DeletePanelTarget(target);
+
+    glGenTextures(1, &target->texture);
+    BindGLTexture(0, target->texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, NULL);
+
+    glGenFramebuffers(1, &target->framebuffer);
+    BindGLFramebuffer(target->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, target->texture, 0);
+    target->context = eglGetCurrentContext();
+    target->width = width;
+    target->height = height;
+
+    const uint32_t status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        ReportWarning(incomplete_panel_target);
+        DeletePanelTarget(target);
+        target->failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool BeginPanelTarget(panel_t* panel, size_t panel_index, uint32_t* width,
+                      uint32_t* height)
+{
+    uint32_t logical_width, logical_height;
+    GetPanelResolution(panel, &logical_width, &logical_height);
+
+    panel_target_t* target =
+        panel_index < PANEL_TYPE_COUNT ? &targets[panel_index] : NULL;
+    bool ready = target != NULL && !target->failed &&
+                 logical_width != 0 && logical_height != 0;
+    if (ready && (target->width != logical_width ||
+                  target->height != logical_height))
+        ready = CreatePanelTarget(target, logical_width, logical_height);
+
+    if (!ready)
+    {
+        BindGLFramebuffer(0);
+        SetGLViewport(0, 0, panel->width, panel->height);
+        *width = panel->width;
+        *height = panel->height;
+        return false;
+    }
+
+    BindGLFramebuffer(target->framebuffer);
+    SetGLViewport(0, 0, logical_width, logical_height);
+    *width = logical_width;
+    *height = logical_height;
+    return true;
+}
+
+/**
+ * @brief Create the presenting quad and shader. This happens the first
+ * time a target is presented, since that's the first time we're sure a
+ * context is current.
+ */
+static void UploadPresenter(void)
+{
+    const float quad[8] = {-1.0f, -1.0f, 1.0f, -1.0f,
+                           -1.0f, 1.0f,  1.0f, 1.0f};
+    glGenBuffers(1, &quad_buffer);
+    BindGLBuffer(GL_ARRAY_BUFFER, quad_buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+
+    present_shader =
+        LoadShader(PRESENT_VERTEX_SHADER, PRESENT_FRAGMENT_SHADER);
+}
+
+void PresentPanelTarget(panel_t* panel, size_t panel_index)
+{
+    if (panel_index >= PANEL_TYPE_COUNT) return;
+    if (present_shader == NULL) UploadPresenter();
+
+    const panel_target_t* target = &targets[panel_index];
+    const uint32_t scale = GetPanelScale(panel);
+    const uint32_t width = target->width * scale;
+    const uint32_t height = target->height * scale;
+
+    BindGLFramebuffer(0);
+    // The bars are the only part of the surface the quad doesn't cover,
+    // so there's only something to clear if there are bars.
+    if (width != panel->width || height != panel->height)
+    {
+        SetGLViewport(0, 0, panel->width, panel->height);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    SetGLViewport(((int32_t)panel->width - (int32_t)width) / 2,
+                  ((int32_t)panel->height - (int32_t)height) / 2, width,
+                  height);
+    SetGLBlending(false);
+    UseGLProgram(present_shader->id);
+    BindGLTexture(0, target->texture);
+    BindGLBuffer(GL_ARRAY_BUFFER, quad_buffer);
+
+    const int32_t position =
+        present_shader->attributes[position_attribute];
+    glVertexAttribPointer(position, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+    glEnableVertexAttribArray(position);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glDisableVertexAttribArray(position);
+}
+
+void MapTargetDamage(const panel_t* panel, size_t panel_index,
+                     damage_rect_t* rects, size_t count)
+{
+    if (panel_index >= PANEL_TYPE_COUNT) return;
+
+    const panel_target_t* target = &targets[panel_index];
+    const uint32_t scale = GetPanelScale(panel);
+    const int32_t offset_x =
+        ((int32_t)panel->width - (int32_t)(target->width * scale)) / 2;
+    const int32_t offset_y =
+        ((int32_t)panel->height - (int32_t)(target->height * scale)) / 2;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        damage_rect_t* rect = &rects[i];
+        // The bars never change, so they only need to go to the
+        // compositor alongside the whole of the target.
+        if (rect->x == 0 && rect->y == 0 &&
+            rect->width == target->width && rect->height == target->height)
+        {
+            *rect = (damage_rect_t){0, 0, panel->width, panel->height};
+            continue;
+        }
+
+        rect->x = rect->x * (int32_t)scale + offset_x;
+        rect->y = rect->y * (int32_t)scale + offset_y;
+        rect->width *= scale;
+        rect->height *= scale;
+    }
+}
+
+void DestroyPanelTargets(void)
+{
+    for (size_t i = 0; i < PANEL_TYPE_COUNT; i++)
+    {
+        DeletePanelTarget(&targets[i]);
+        targets[i].failed = false;
+    }
+
+    if (present_shader != NULL)
+    {
+        DeleteGLBuffers(1, &quad_buffer);
+        UnloadShader(present_shader);
+        present_shader = NULL;
+    }
+}
@@ -0,0 +1,101 @@
+/**
+ * @file Target.h
+ * @author Israfiel (https://github.com/israfiel-a)
+ * @brief Provides the panels' offscreen render targets. Every panel is
+ * drawn at a fixed, low logical resolution into its own framebuffer, which
+ * is then scaled up to the panel by a whole number with nearest-neighbour
+ * filtering and centered, with black bars around whatever doesn't divide
+ * evenly. Fill and fragment costs are then set by the logical resolution
+ * rather than the monitor's.
+ * @date 2024-08-29
+ *
+ * @copyright (c) 2024 - Israfiel
+ */
+
+#ifndef _MSENG_TARGET_RENDERING_SYSTEM_
+#define _MSENG_TARGET_RENDERING_SYSTEM_
+
+#include "Damage.h"
+#include <Windowing/Windowing-Types.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief The shader files panels are presented with, within @ref
+ * SHADER_PATH.
+ */
+#define PRESENT_VERTEX_SHADER "Present.vert"
+#define PRESENT_FRAGMENT_SHADER "Present.frag"
+
+/**
+ * @brief The logical width and height of the center panel, in pixels,
+ * unless the panel is smaller than that, in which case its target shrinks
+ * to fit. Every other panel is given whatever logical size puts its
+ * pixels at the same scale as the center panel's.
+ */
+#define TARGET_CENTER_SIZE 320
+
+/**
+ * @brief Get the logical resolution a panel is drawn at.
+ * @param panel The panel.
+ * @param width Where to write the logical width in pixels.
+ * @param height Where to write the logical height in pixels.
+ */
+void GetPanelResolution(const panel_t* panel, uint32_t* width,
+                        uint32_t* height);
+
+/**
+ * @brief Get the whole number a panel's logical pixels are scaled up by
+ * when it's presented.
+ * @param panel The panel.
+ * @return The scale, which is at least 1.
+ */
+uint32_t GetPanelScale(const panel_t* panel);
+
+/**
+ * @brief Bind a panel's render target, creating or resizing it first if
+ * need be, and set the viewport to cover it. If the target can't be made,
+ * the panel's surface is bound instead and the panel is drawn at its full
+ * size. This must be called on the rendering thread, with the panel's
+ * context current.
+ * @param panel The panel.
+ * @param panel_index The panel's index.
+ * @param width Where to write the width to draw at, in pixels.
+ * @param height Where to write the height to draw at, in pixels.
+ * @return true The target is bound, and has to be presented with @ref
+ * PresentPanelTarget once the panel is drawn.
+ * @return false The panel's surface is bound.
+ */
+bool BeginPanelTarget(panel_t* panel, size_t panel_index, uint32_t* width,
+                      uint32_t* height);
+
+/**
+ * @brief Scale a panel's render target up onto its surface. This has the
+ * same requirements as @ref BeginPanelTarget.
+ * @param panel The panel.
+ * @param panel_index The panel's index.
+ */
+void PresentPanelTarget(panel_t* panel, size_t panel_index);
+
+/**
+ * @brief Turn damage on a panel's render target into damage on its
+ * surface, as it lands once @ref PresentPanelTarget scales it up. Damage
+ * covering the whole target grows to cover the bars around it too.
+ * @param panel The panel.
+ * @param panel_index The panel's index.
+ * @param rects The damage, in logical pixels, which is overwritten with
+ * the damage in surface pixels.
+ * @param count The amount of rectangles.
+ */
+void MapTargetDamage(const panel_t* panel, size_t panel_index,
+                     damage_rect_t* rects, size_t count);
+
+/**
+ * @brief Delete every render target, and the objects used to present
+ * them. Framebuffers belong to the context that made them, so any made in
+ * a context that isn't current are left for that context's destruction.
+ * This must be called on the rendering thread, with a context current.
+ */
+void DestroyPanelTargets(void);
+
+#endif // _MSENG_TARGET_RENDERING_SYSTEM_
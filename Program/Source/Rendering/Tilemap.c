@@ -0,0 +1,469 @@
+#include "Tilemap.h"
+#include "Atlas.h"
+#include "Damage.h"
+#include "Shader.h"
+#include "State.h"
+#include <Memory/Thread.h> // Contended locks
+#include <pthread.h>
+#include <string.h>
+
+/**
+ * @brief The amount of tiles in a chunk.
+ */
+#define TILEMAP_CHUNK_TILES (TILEMAP_CHUNK_SIZE * TILEMAP_CHUNK_SIZE)
+
+/**
+ * @brief A single corner of a tile, as it's laid out in a chunk's vertex
+ * buffer. Tiles aren't tinted, so the tint is a constant attribute rather
+ * than part of every vertex.
+ */
+typedef struct
+{
+    float x;
+    float y;
+    float u;
+    float v;
+} tilemap_vertex_t;
+
+/**
+ * @brief A run of a chunk's tiles that all sit on the same atlas page,
+ * and so can be drawn with one call.
+ */
+typedef struct
+{
+    uint16_t page;
+    size_t first;
+    size_t count;
+} tilemap_run_t;
+
+/**
+ * @brief A single chunk of a map.
+ */
+typedef struct
+{
+    /**
+     * @brief The chunk's tiles, row by row.
+     */
+    uint16_t tiles[TILEMAP_CHUNK_TILES];
+    /**
+     * @brief The chunk's vertex buffer, or 0 if it's never been built.
+     */
+    uint32_t buffer;
+    /**
+     * @brief Whether a tile has changed since the chunk was last built.
+     */
+    bool dirty;
+    /**
+     * @brief The chunk's draw calls, one per atlas page it uses.
+     */
+    flat_array_t runs;
+} tilemap_chunk_t;
+
+/**
+ * @brief Guards the active map and the contents of every map, since tiles
+ * are set from the game's side and read from the rendering thread.
+ */
+static pthread_mutex_t tilemap_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief The map drawn to the center panel.
+ */
+static tilemap_t* active_tilemap = NULL;
+
+/**
+ * @brief Vertex buffers belonging to destroyed maps, waiting for the
+ * rendering thread to delete them.
+ */
+static flat_array_t retired_buffers = {{NULL, 0}, sizeof(uint32_t), 0, 0};
+
+/**
+ * @brief Scratch space for the vertices of the chunk being built.
+ */
+static tilemap_vertex_t chunk_vertices[TILEMAP_CHUNK_TILES * 4];
+
+/**
+ * @brief Whether the renderer's OpenGL objects have been created.
+ */
+static bool renderer_uploaded = false;
+
+/**
+ * @brief The index buffer shared by every chunk, holding the two
+ * triangles of every tile a chunk can have.
+ */
+static uint32_t index_buffer = 0;
+
+/**
+ * @brief The tilemap shader.
+ */
+static shader_t* tilemap_shader = NULL;
+
+/**
+ * @brief The amount of chunks drawn and rebuilt by the last draw.
+ */
+static size_t chunks_drawn = 0, chunks_rebuilt = 0;
+
+tilemap_t CreateTilemap(uint32_t width, uint32_t height,
+                        uint32_t tile_size)
+{
+    // Maps that don't divide evenly into chunks round up; the tiles past
+    // the edge of the map are left empty forever.
+    tilemap_t map = {width,
+                     height,
+                     tile_size,
+                     (width + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE,
+                     (height + TILEMAP_CHUNK_SIZE - 1) /
+                         TILEMAP_CHUNK_SIZE,
+                     0,
+                     0,
+                     {{NULL, 0}, 0, 0, 0}};
+
+    const size_t chunk_count = (size_t)map.chunks_wide * map.chunks_high;
+    map._c = CreateFlatArray(sizeof(tilemap_chunk_t), chunk_count);
+    map._c.occupied = chunk_count;
+
+    tilemap_chunk_t* chunks = map._c._a._p;
+    for (size_t i = 0; i < chunk_count; i++)
+    {
+        memset(chunks[i].tiles, 0xFF, sizeof(chunks[i].tiles));
+        chunks[i].buffer = 0;
+        chunks[i].dirty = false;
+        chunks[i].runs = CreateFlatArray(sizeof(tilemap_run_t), 0);
+    }
+    return map;
+}
+
+void DestroyTilemap(tilemap_t* map)
+{
+    LockMutex(&tilemap_mutex, "tilemap lock");
+    const bool active = active_tilemap == map;
+    if (active) active_tilemap = NULL;
+
+    tilemap_chunk_t* chunks = map->_c._a._p;
+    for (size_t i = 0; i < map->_c.occupied; i++)
+    {
+        if (chunks[i].buffer != 0)
+            AddFlatArrayValue(&retired_buffers, &chunks[i].buffer);
+        DestroyFlatArray(&chunks[i].runs);
+    }
+    DestroyFlatArray(&map->_c);
+    pthread_mutex_unlock(&tilemap_mutex);
+
+    if (active) DamageWholePanel(center_filler);
+}
+
+/**
+ * @brief Find the chunk a tile lives in.
+ * @param map The map.
+ * @param x The X position of the tile, in tiles.
+ * @param y The Y position of the tile, in tiles.
+ * @return The chunk.
+ */
+static tilemap_chunk_t* GetTileChunk(tilemap_t* map, uint32_t x,
+                                     uint32_t y)
+{
+    return (tilemap_chunk_t*)map->_c._a._p +
+           (size_t)(y / TILEMAP_CHUNK_SIZE) * map->chunks_wide +
+           x / TILEMAP_CHUNK_SIZE;
+}
+
+void SetTile(tilemap_t* map, uint32_t x, uint32_t y, uint16_t tile)
+{
+    if (x >= map->width || y >= map->height) return;
+
+    LockMutex(&tilemap_mutex, "tilemap lock");
+    tilemap_chunk_t* chunk = GetTileChunk(map, x, y);
+    uint16_t* current = &chunk->tiles[(y % TILEMAP_CHUNK_SIZE) *
+                                          TILEMAP_CHUNK_SIZE +
+                                      x % TILEMAP_CHUNK_SIZE];
+    const bool changed = *current != tile;
+    if (changed)
+    {
+        *current = tile;
+        chunk->dirty = true;
+    }
+    const bool visible = changed && active_tilemap == map;
+    const int64_t left = (int64_t)x * map->tile_size - map->camera_x;
+    const int64_t top = (int64_t)y * map->tile_size - map->camera_y;
+    pthread_mutex_unlock(&tilemap_mutex);
+
+    // Only the active map is on screen, so only its tiles damage the
+    // panel.
+    if (visible)
+        DamagePanel(center_filler, left, top, map->tile_size,
+                    map->tile_size);
+}
+
+uint16_t GetTile(tilemap_t* map, uint32_t x, uint32_t y)
+{
+    if (x >= map->width || y >= map->height) return TILEMAP_EMPTY_TILE;
+
+    LockMutex(&tilemap_mutex, "tilemap lock");
+    uint16_t tile =
+        GetTileChunk(map, x, y)->tiles[(y % TILEMAP_CHUNK_SIZE) *
+                                           TILEMAP_CHUNK_SIZE +
+                                       x % TILEMAP_CHUNK_SIZE];
+    pthread_mutex_unlock(&tilemap_mutex);
+    return tile;
+}
+
+void SetTilemapCamera(tilemap_t* map, int32_t x, int32_t y)
+{
+    LockMutex(&tilemap_mutex, "tilemap lock");
+    const bool moved = map->camera_x != x || map->camera_y != y;
+    map->camera_x = x;
+    map->camera_y = y;
+    const bool visible = moved && active_tilemap == map;
+    pthread_mutex_unlock(&tilemap_mutex);
+
+    if (visible) DamageWholePanel(center_filler);
+}
+
+void SetActiveTilemap(tilemap_t* map)
+{
+    LockMutex(&tilemap_mutex, "tilemap lock");
+    const bool changed = active_tilemap != map;
+    active_tilemap = map;
+    pthread_mutex_unlock(&tilemap_mutex);
+
+    if (changed) DamageWholePanel(center_filler);
+}
+
+/**
+ * @brief Create the renderer's OpenGL objects. This happens the first
+ * time there's a map to draw, since that's the first time we're sure a
+ * context is current.
+ */
+static void UploadTilemapRenderer(void)
+{
+    // Every tile is two triangles over its four corners. A chunk has at
+    // most 4096 corners, so 16-bit indices always do.
+    static uint16_t indices[TILEMAP_CHUNK_TILES * 6];
+    for (size_t i = 0; i < TILEMAP_CHUNK_TILES; i++)
+    {
+        const uint16_t corner = i * 4;
+        const uint16_t quad[6] = {corner,     corner + 1, corner + 2,
+                                  corner + 2, corner + 3, corner};
+        memcpy(&indices[i * 6], quad, sizeof(quad));
+    }
+    glGenBuffers(1, &index_buffer);
+    BindGLBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices,
+                 GL_STATIC_DRAW);
+
+    tilemap_shader =
+        LoadShader(TILEMAP_VERTEX_SHADER, TILEMAP_FRAGMENT_SHADER);
+
+    renderer_uploaded = true;
+}
+
+/**
+ * @brief Rebuild a chunk's vertices and draw calls, and upload them into
+ * its vertex buffer. Tiles are grouped by atlas page with a counting
+ * sort, so each page the chunk uses is one contiguous run.
+ * @param map The map the chunk belongs to.
+ * @param chunk The chunk.
+ */
+static void BuildTilemapChunk(const tilemap_t* map, tilemap_chunk_t* chunk)
+{
+    ClearFlatArray(&chunk->runs);
+    chunk->dirty = false;
+
+    for (size_t i = 0; i < TILEMAP_CHUNK_TILES; i++)
+    {
+        const atlas_region_t* region = GetAtlasRegion(chunk->tiles[i]);
+        if (region == NULL || region->page == ATLAS_INVALID_PAGE) continue;
+
+        // Pages are few and tiles usually share one, so the runs are
+        // searched rather than indexed.
+        tilemap_run_t* runs = chunk->runs._a._p;
+        size_t run = 0;
+        while (run < chunk->runs.occupied &&
+               runs[run].page != region->page)
+            run++;
+        if (run == chunk->runs.occupied)
+        {
+            tilemap_run_t new_run = {region->page, 0, 0};
+            AddFlatArrayValue(&chunk->runs, &new_run);
+        }
+        ((tilemap_run_t*)chunk->runs._a._p)[run].count++;
+    }
+    if (chunk->runs.occupied == 0) return;
+
+    tilemap_run_t* runs = chunk->runs._a._p;
+    size_t offset = 0;
+    for (size_t i = 0; i < chunk->runs.occupied; i++)
+    {
+        runs[i].first = offset;
+        offset += runs[i].count;
+        runs[i].count = 0;
+    }
+
+    const float size = map->tile_size;
+    for (size_t i = 0; i < TILEMAP_CHUNK_TILES; i++)
+    {
+        const atlas_region_t* region = GetAtlasRegion(chunk->tiles[i]);
+        if (region == NULL || region->page == ATLAS_INVALID_PAGE) continue;
+
+        size_t run = 0;
+        while (runs[run].page != region->page) run++;
+        tilemap_vertex_t* corners =
+            &chunk_vertices[(runs[run].first + runs[run].count++) * 4];
+
+        const float left = (i % TILEMAP_CHUNK_SIZE) * size;
+        const float top = (i / TILEMAP_CHUNK_SIZE) * size;
+        const float* uv = region->uv;
+        corners[0] = (tilemap_vertex_t){left, top, uv[0], uv[1]};
+        corners[1] = (tilemap_vertex_t){left + size, top, uv[2], uv[1]};
+        corners[2] =
+            (tilemap_vertex_t){left + size, top + size, uv[2], uv[3]};
+        corners[3] = (tilemap_vertex_t){left, top + size, uv[0], uv[3]};
+    }
+
+    if (chunk->buffer == 0) glGenBuffers(1, &chunk->buffer);
+    BindGLBuffer(GL_ARRAY_BUFFER, chunk->buffer);
+    glBufferData(GL_ARRAY_BUFFER, offset * 4 * sizeof(tilemap_vertex_t),
+                 chunk_vertices, GL_STATIC_DRAW);
+}
+
+/**
+ * @brief Delete the vertex buffers of destroyed maps.
+ */
+static void DeleteRetiredBuffers(void)
+{
+    if (retired_buffers.occupied == 0) return;
+    DeleteGLBuffers(retired_buffers.occupied, retired_buffers._a._p);
+    ClearFlatArray(&retired_buffers);
+}
+
+/**
+ * @brief Find the range of chunks along one axis that the camera can see.
+ * @param camera The camera's position along the axis, in pixels.
+ * @param extent The size of the panel along the axis, in pixels.
+ * @param chunk_extent The size of a chunk, in pixels.
+ * @param chunk_count The amount of chunks along the axis.
+ * @param first Where to write the first visible chunk.
+ * @param last Where to write one past the last visible chunk.
+ */
+static void CullTilemapAxis(int32_t camera, uint32_t extent,
+                            uint32_t chunk_extent, uint32_t chunk_count,
+                            uint32_t* first, uint32_t* last)
+{
+    const int64_t start = camera, end = (int64_t)camera + extent;
+    *first = *last = 0;
+    if (end <= 0 || chunk_extent == 0) return;
+
+    *first = start <= 0 ? 0 : start / chunk_extent;
+    *last = (end + chunk_extent - 1) / chunk_extent;
+    if (*last > chunk_count) *last = chunk_count;
+    if (*first > *last) *first = *last;
+}
+
+void DrawTilemap(uint32_t width, uint32_t height)
+{
+    chunks_drawn = chunks_rebuilt = 0;
+
+    LockMutex(&tilemap_mutex, "tilemap lock");
+    DeleteRetiredBuffers();
+    tilemap_t* map = active_tilemap;
+    if (map == NULL || GetAtlasPageCount() == 0)
+    {
+        pthread_mutex_unlock(&tilemap_mutex);
+        return;
+    }
+    if (!renderer_uploaded) UploadTilemapRenderer();
+
+    // Only the chunks under the camera are ever looked at, so this is the
+    // same amount of work no matter how big the map is.
+    const uint32_t chunk_extent = TILEMAP_CHUNK_SIZE * map->tile_size;
+    uint32_t first_x, last_x, first_y, last_y;
+    CullTilemapAxis(map->camera_x, width, chunk_extent, map->chunks_wide,
+                    &first_x, &last_x);
+    CullTilemapAxis(map->camera_y, height, chunk_extent, map->chunks_high,
+                    &first_y, &last_y);
+
+    const int32_t* attributes = tilemap_shader->attributes;
+    const int32_t offset = tilemap_shader->uniforms[offset_uniform];
+    SetGLBlending(true);
+    SetGLBlendFunction(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    SetShaderViewport(tilemap_shader, width, height);
+    glVertexAttrib4f(attributes[tint_attribute], 1.0f, 1.0f, 1.0f, 1.0f);
+    glEnableVertexAttribArray(attributes[position_attribute]);
+    glEnableVertexAttribArray(attributes[uv_attribute]);
+    BindGLBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+
+    tilemap_chunk_t* chunks = map->_c._a._p;
+    for (uint32_t y = first_y; y < last_y; y++)
+    {
+        for (uint32_t x = first_x; x < last_x; x++)
+        {
+            tilemap_chunk_t* chunk =
+                &chunks[(size_t)y * map->chunks_wide + x];
+            if (chunk->dirty)
+            {
+                BuildTilemapChunk(map, chunk);
+                chunks_rebuilt++;
+            }
+            if (chunk->runs.occupied == 0) continue;
+
+            BindGLBuffer(GL_ARRAY_BUFFER, chunk->buffer);
+            glVertexAttribPointer(attributes[position_attribute], 2,
+                                  GL_FLOAT, GL_FALSE,
+                                  sizeof(tilemap_vertex_t), NULL);
+            glVertexAttribPointer(
+                attributes[uv_attribute], 2, GL_FLOAT, GL_FALSE,
+                sizeof(tilemap_vertex_t),
+                (void*)(uintptr_t)offsetof(tilemap_vertex_t, u));
+            glUniform2f(offset,
+                        (int64_t)x * chunk_extent - map->camera_x,
+                        (int64_t)y * chunk_extent - map->camera_y);
+
+            const tilemap_run_t* runs = chunk->runs._a._p;
+            for (size_t i = 0; i < chunk->runs.occupied; i++)
+            {
+                BindGLTexture(0, GetAtlasPageTexture(runs[i].page));
+
+                const uintptr_t first = runs[i].first * 6 * 2;
+                glDrawElements(GL_TRIANGLES, runs[i].count * 6,
+                               GL_UNSIGNED_SHORT, (void*)first);
+            }
+            chunks_drawn++;
+        }
+    }
+
+    glDisableVertexAttribArray(attributes[position_attribute]);
+    glDisableVertexAttribArray(attributes[uv_attribute]);
+    pthread_mutex_unlock(&tilemap_mutex);
+}
+
+size_t GetTilemapChunksDrawn(void) { return chunks_drawn; }
+
+size_t GetTilemapChunksRebuilt(void) { return chunks_rebuilt; }
+
+void DestroyTilemapRenderer(void)
+{
+    LockMutex(&tilemap_mutex, "tilemap lock");
+    DeleteRetiredBuffers();
+    DestroyFlatArray(&retired_buffers);
+
+    // The active map outlives its buffers; anything that had been built is
+    // rebuilt if the map is drawn again.
+    if (active_tilemap != NULL)
+    {
+        tilemap_chunk_t* chunks = active_tilemap->_c._a._p;
+        for (size_t i = 0; i < active_tilemap->_c.occupied; i++)
+        {
+            if (chunks[i].buffer == 0) continue;
+            DeleteGLBuffers(1, &chunks[i].buffer);
+            chunks[i].buffer = 0;
+            chunks[i].dirty = true;
+        }
+    }
+
+    if (renderer_uploaded)
+    {
+        DeleteGLBuffers(1, &index_buffer);
+        UnloadShader(tilemap_shader);
+        renderer_uploaded = false;
+    }
+    pthread_mutex_unlock(&tilemap_mutex);
+}
@@ -0,0 +1,161 @@
+/**
+ * @file Tilemap.h
+ * @author Israfiel (https://github.com/israfiel-a)
+ * @brief Provides the tilemap renderer for the center panel. Maps are
+ * split into fixed-size chunks, each of which keeps its geometry in its
+ * own vertex buffer. Only the chunks under the camera are drawn, and a
+ * chunk is only rebuilt when one of its tiles changes, so the cost of a
+ * frame depends on the size of the panel rather than the size of the map.
+ * @date 2024-08-25
+ *
+ * @copyright (c) 2024 - Israfiel
+ */
+
+#ifndef _MSENG_TILEMAP_RENDERING_SYSTEM_
+#define _MSENG_TILEMAP_RENDERING_SYSTEM_
+
+#include <Memory/Array.h>
+#include <inttypes.h>
+#include <stddef.h>
+
+/**
+ * @brief The shader files the tilemap is drawn with, within @ref
+ * SHADER_PATH. The fragment stage is shared with the sprite batcher.
+ */
+#define TILEMAP_VERTEX_SHADER "Tilemap.vert"
+#define TILEMAP_FRAGMENT_SHADER "Sprite.frag"
+
+/**
+ * @brief The width and height of a chunk, in tiles.
+ */
+#define TILEMAP_CHUNK_SIZE 32
+
+/**
+ * @brief The value of a tile with nothing in it.
+ */
+#define TILEMAP_EMPTY_TILE UINT16_MAX
+
+/**
+ * @brief A tilemap. Tiles are indices into the texture atlas (see @file
+ * Atlas.h), which has to be built before the map is first drawn.
+ */
+typedef struct
+{
+    /**
+     * @brief The width of the map in tiles.
+     */
+    uint32_t width;
+    /**
+     * @brief The height of the map in tiles.
+     */
+    uint32_t height;
+    /**
+     * @brief The width and height of a single tile, in pixels.
+     */
+    uint32_t tile_size;
+    /**
+     * @brief The width of the map in chunks.
+     */
+    uint32_t chunks_wide;
+    /**
+     * @brief The height of the map in chunks.
+     */
+    uint32_t chunks_high;
+    /**
+     * @brief The position of the camera's top-left corner within the map,
+     * in pixels. Set this through @ref SetTilemapCamera.
+     */
+    int32_t camera_x;
+    int32_t camera_y;
+    /**
+     * @brief The map's chunks, row by row. @warning Editing these directly
+     * will skip the dirty tracking; use @ref SetTile.
+     */
+    flat_array_t _c;
+} tilemap_t;
+
+/**
+ * @brief Create a tilemap with every tile empty.
+ * @param width The width of the map in tiles.
+ * @param height The height of the map in tiles.
+ * @param tile_size The width and height of a tile in pixels.
+ * @return The new tilemap.
+ */
+tilemap_t CreateTilemap(uint32_t width, uint32_t height,
+                        uint32_t tile_size);
+
+/**
+ * @brief Destroy a tilemap. This can be called from any thread; the map's
+ * vertex buffers are handed to the rendering thread to delete. If the map
+ * is the active one, it's deactivated first.
+ * @param map The map to destroy.
+ */
+void DestroyTilemap(tilemap_t* map);
+
+/**
+ * @brief Set a tile, marking its chunk to be rebuilt the next time it's
+ * drawn. If the map is active, the tile's area of the center panel is
+ * damaged. Tiles outside the map are ignored.
+ * @param map The map.
+ * @param x The X position of the tile, in tiles.
+ * @param y The Y position of the tile, in tiles.
+ * @param tile The atlas image to draw, or @ref TILEMAP_EMPTY_TILE.
+ */
+void SetTile(tilemap_t* map, uint32_t x, uint32_t y, uint16_t tile);
+
+/**
+ * @brief Get a tile.
+ * @param map The map.
+ * @param x The X position of the tile, in tiles.
+ * @param y The Y position of the tile, in tiles.
+ * @return The tile, or @ref TILEMAP_EMPTY_TILE if it's outside the map.
+ */
+uint16_t GetTile(tilemap_t* map, uint32_t x, uint32_t y);
+
+/**
+ * @brief Move the camera. If the map is active, the whole of the center
+ * panel is damaged.
+ * @param map The map.
+ * @param x The X position of the camera's top-left corner, in pixels.
+ * @param y The Y position of the camera's top-left corner, in pixels.
+ */
+void SetTilemapCamera(tilemap_t* map, int32_t x, int32_t y);
+
+/**
+ * @brief Set the map drawn to the center panel. The map must stay alive
+ * until it's deactivated, either by activating another map (or NULL) or by
+ * destroying it.
+ * @param map The map, or NULL to draw nothing.
+ */
+void SetActiveTilemap(tilemap_t* map);
+
+/**
+ * @brief Draw the active map to the current panel, rebuilding any dirty
+ * chunks under the camera on the way. This must be called on the
+ * rendering thread, with a context current.
+ * @param width The width of the panel in pixels.
+ * @param height The height of the panel in pixels.
+ */
+void DrawTilemap(uint32_t width, uint32_t height);
+
+/**
+ * @brief Get the amount of chunks the last @ref DrawTilemap drew.
+ * @return The chunk count.
+ */
+size_t GetTilemapChunksDrawn(void);
+
+/**
+ * @brief Get the amount of chunks the last @ref DrawTilemap rebuilt.
+ * @return The chunk count.
+ */
+size_t GetTilemapChunksRebuilt(void);
+
+/**
+ * @brief Delete every OpenGL object the tilemap renderer holds, including
+ * the active map's vertex buffers. The map itself stays valid; its chunks
+ * are rebuilt if it's drawn again. This must be called on the rendering
+ * thread, with a context current.
+ */
+void DestroyTilemapRenderer(void);
+
+#endif // _MSENG_TILEMAP_RENDERING_SYSTEM_
@@ -0,0 +1,219 @@
+#include "Tick.h"
+#include <Diagnostic/Time.h> // Tick timing
+#include <Globals.h>
+#include <Input/Events.h>   // Input event ring
+#include <Input/Keyboard.h> // Keyboard snapshots
+#include <Memory/Allocate.h>
+#include <Memory/Thread.h>
+#include <Output/Messages.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief The handle of the simulation thread, kept so it can be joined on
+ * shutdown.
+ */
+static pthread_t simulation_thread;
+static bool simulation_running = false;
+
+/**
+ * @brief What's run every tick, and the size of the state it works on.
+ */
+static tick_function_t tick_function = NULL;
+static size_t state_size = 0;
+
+/**
+ * @brief The three copies of the game state. The working state belongs to
+ * the simulation thread alone; the previous and current ones are what the
+ * last two ticks left behind, and are only swapped out under the state
+ * mutex.
+ */
+static ptr_t working_state, previous_state, current_state;
+
+/**
+ * @brief When the current state was due, by @ref GetCurrentTimeNS. Rather
+ * than when the tick actually ran, this is when it would have in a
+ * perfect world, so the interpolation doesn't jitter with scheduling.
+ */
+static uint64_t current_due = 0;
+
+/**
+ * @brief Guards the published states and when they were due.
+ */
+static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief The ticks run, and those dropped by @ref
+ * SIMULATION_CATCH_UP_LIMIT.
+ */
+static atomic_uint_least64_t ticks_run = 0;
+static uint64_t ticks_dropped = 0;
+
+/**
+ * @brief The total time spent running ticks, in nanoseconds.
+ */
+static uint64_t tick_time_total = 0;
+
+void SetTickFunction(tick_function_t func, size_t size)
+{
+    tick_function = func;
+    state_size = size;
+}
+
+/**
+ * @brief Publish the working state as the current one, making the current
+ * one the previous, then carry it on into the next tick.
+ * @param due When the tick was due.
+ */
+static void PublishTick(uint64_t due)
+{
+    LockMutex(&state_mutex, "simulation state lock");
+    ptr_t oldest = previous_state;
+    previous_state = current_state;
+    current_state = working_state;
+    working_state = oldest;
+    current_due = due;
+    pthread_mutex_unlock(&state_mutex);
+
+    // The current state is only ever read from now on, so it can be
+    // copied outside of the lock.
+    if (state_size != 0)
+        memcpy(working_state._p, current_state._p, state_size);
+}
+
+/**
+ * @brief Run a single tick.
+ * @param due When the tick was due.
+ */
+static void RunTick(uint64_t due)
+{
+    const uint64_t start = GetCurrentTimeNS();
+    BeginZone("tick");
+    // The listeners only queue input up; this is where it's actually
+    // handed to the game.
+    DispatchInputEvents();
+    UpdateKeyboardState();
+    const uint64_t tick =
+        atomic_load_explicit(&ticks_run, memory_order_relaxed);
+    if (tick_function != NULL) tick_function(working_state._p, tick);
+    PublishTick(due);
+    EndZone();
+
+    tick_time_total += GetCurrentTimeNS() - start;
+    atomic_store_explicit(&ticks_run, tick + 1, memory_order_relaxed);
+}
+
+/**
+ * @brief The simulation thread.
+ * @param data Nothing of use.
+ * @return Nothing of use.
+ */
+static void* SimulationFunction(void* data)
+{
+    SetZoneThreadName("simulation");
+    uint64_t last = GetCurrentTimeNS(), accumulator = 0;
+
+    while (running)
+    {
+        const uint64_t now = GetCurrentTimeNS();
+        accumulator += now - last;
+        last = now;
+
+        const uint64_t limit =
+            (uint64_t)SIMULATION_CATCH_UP_LIMIT * SIMULATION_TICK_LENGTH;
+        if (accumulator > limit)
+        {
+            ticks_dropped +=
+                (accumulator - limit) / SIMULATION_TICK_LENGTH;
+            accumulator = limit;
+        }
+
+        while (accumulator >= SIMULATION_TICK_LENGTH)
+        {
+            accumulator -= SIMULATION_TICK_LENGTH;
+            RunTick(now - accumulator);
+        }
+
+        // Sleep until the next tick is due.
+        const uint64_t wake = now + (SIMULATION_TICK_LENGTH - accumulator);
+        const struct timespec deadline = {wake / 1000000000,
+                                          wake % 1000000000};
+        BeginZone("wait for tick");
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+        EndZone();
+    }
+    return NULL;
+}
+
+void CreateSimulationThread(void)
+{
+    // Even without any state, the buffers are kept non-null so nothing
+    // has to check.
+    const size_t size = state_size != 0 ? state_size : 1;
+    working_state = AllocateZeroedBlock(size);
+    previous_state = AllocateZeroedBlock(size);
+    current_state = AllocateZeroedBlock(size);
+    current_due = GetCurrentTimeNS();
+
+    simulation_thread = CreateThread(SimulationFunction, NULL);
+    simulation_running = true;
+}
+
+void DestroySimulationThread(void)
+{
+    if (!simulation_running) return;
+
+    // The thread notices the running flag within one tick.
+    pthread_join(simulation_thread, NULL);
+    simulation_running = false;
+    ReportSimulationStatistics();
+
+    // The rendering thread can still be reading the published states.
+    LockMutex(&state_mutex, "simulation state lock");
+    FreeBlock(&working_state);
+    FreeBlock(&previous_state);
+    FreeBlock(&current_state);
+    pthread_mutex_unlock(&state_mutex);
+}
+
+double ReadSimulationState(void* previous, void* current)
+{
+    const uint64_t now = GetCurrentTimeNS();
+    LockMutex(&state_mutex, "simulation state lock");
+    if (current_state._p == NULL)
+    {
+        pthread_mutex_unlock(&state_mutex);
+        return 1.0;
+    }
+    if (previous != NULL && state_size != 0)
+        memcpy(previous, previous_state._p, state_size);
+    if (current != NULL && state_size != 0)
+        memcpy(current, current_state._p, state_size);
+    const uint64_t due = current_due;
+    pthread_mutex_unlock(&state_mutex);
+
+    // We're always drawing one tick behind, so the current state is what
+    // we reach one tick after it was due.
+    if (now <= due) return 0.0;
+    const double alpha = (double)(now - due) / SIMULATION_TICK_LENGTH;
+    return alpha > 1.0 ? 1.0 : alpha;
+}
+
+size_t GetSimulationStateSize(void) { return state_size; }
+
+uint64_t GetSimulationTick(void)
+{
+    return atomic_load_explicit(&ticks_run, memory_order_relaxed);
+}
+
+void ReportSimulationStatistics(void)
+{
+    const uint64_t ticks = GetSimulationTick();
+    ReportMessage("%lu tick(s) run at %d Hz, %lu dropped, %lu us average "
+                  "tick time",
+                  ticks, SIMULATION_TICK_RATE, ticks_dropped,
+                  ticks == 0 ? 0 : tick_time_total / ticks / 1000);
+}
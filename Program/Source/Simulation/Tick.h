@@ -0,0 +1,122 @@
+/**
+ * @file Tick.h
+ * @author Israfiel (https://github.com/israfiel-a)
+ * @brief Provides the simulation thread, which runs game logic at a fixed
+ * tick rate no matter how fast or slow frames are drawn. Time is built up
+ * in an accumulator and spent a whole tick at a time, so the game runs at
+ * the same speed on any monitor. The state each tick leaves behind is
+ * published alongside the state before it, and the rendering thread draws
+ * somewhere between the two, so motion stays smooth even when frames
+ * outnumber ticks.
+ * @date 2024-09-01
+ *
+ * @copyright (c) 2024 - Israfiel
+ */
+
+#ifndef _MSENG_TICK_SIMULATION_SYSTEM_
+#define _MSENG_TICK_SIMULATION_SYSTEM_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The amount of ticks the simulation runs a second.
+ */
+#define SIMULATION_TICK_RATE 60
+
+/**
+ * @brief The length of a tick, in nanoseconds.
+ */
+#define SIMULATION_TICK_LENGTH (1000000000 / SIMULATION_TICK_RATE)
+
+/**
+ * @brief The most ticks run back to back to catch up. If the simulation
+ * falls further behind than this, say because a tick took too long or
+ * the process was suspended, the time past it is dropped and the game
+ * slows down rather than spending all its time catching up.
+ */
+#define SIMULATION_CATCH_UP_LIMIT 5
+
+/**
+ * @brief A function run once per tick.
+ * @param state The game state as the last tick left it, to be updated in
+ * place. This is zeroed before the first tick.
+ * @param tick The number of the tick, starting at 0.
+ */
+typedef void (*tick_function_t)(void* state, uint64_t tick);
+
+/**
+ * @brief What a frame draws from: the last two ticks' states, and how far
+ * between them the frame lands.
+ */
+typedef struct
+{
+    /**
+     * @brief The state before the last tick, or NULL if there's no state.
+     */
+    const void* previous;
+    /**
+     * @brief The state as of the last tick, or NULL if there's no state.
+     */
+    const void* current;
+    /**
+     * @brief How far between the two states to draw, from 0 (previous) to
+     * 1 (current).
+     */
+    double alpha;
+} simulation_frame_t;
+
+/**
+ * @brief Set what the simulation runs every tick. This must be called
+ * before @ref CreateSimulationThread. Without it, ticks only take in
+ * input.
+ * @param func The function.
+ * @param state_size The size of the game state, in bytes.
+ */
+void SetTickFunction(tick_function_t func, size_t state_size);
+
+/**
+ * @brief Start the simulation thread. Input is drained and the keyboard
+ * snapshot is taken on this thread at the start of every tick, so the
+ * callbacks in @file Hardware.h run here too.
+ */
+void CreateSimulationThread(void);
+
+/**
+ * @brief Stop and join the simulation thread. This must only be called
+ * once the global running flag has been cleared.
+ */
+void DestroySimulationThread(void);
+
+/**
+ * @brief Copy out the last two ticks' states, to draw something in
+ * between. This is safe to call from any thread.
+ * @param previous Where to write the state before the last tick, or NULL
+ * to skip it.
+ * @param current Where to write the state as of the last tick, or NULL to
+ * skip it.
+ * @return How far between the two ticks now is, from 0 (the previous tick)
+ * to 1 (the current one). If the simulation isn't running, nothing is
+ * copied and this is 1.
+ */
+double ReadSimulationState(void* previous, void* current);
+
+/**
+ * @brief Get the size of the game state, as given to @ref SetTickFunction.
+ * @return The size in bytes, or 0 if there's no state.
+ */
+size_t GetSimulationStateSize(void);
+
+/**
+ * @brief Get the amount of ticks the simulation has run.
+ * @return The tick count.
+ */
+uint64_t GetSimulationTick(void);
+
+/**
+ * @brief Report how many ticks were run and dropped, and how long they
+ * took on average.
+ */
+void ReportSimulationStatistics(void);
+
+#endif // _MSENG_TICK_SIMULATION_SYSTEM_
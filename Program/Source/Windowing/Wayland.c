@@ -1,13 +1,20 @@
 #include "Wayland.h"
-#include "XDG.h" // Window managing
+#include "XDG.h"               // Window managing
+#include <Diagnostic/Time.h> // Event zones
 #include <Globals.h>
 #include <Input/File.h>     // Shared memory file functionality
 #include <Input/Hardware.h> // Mouse/keyboard functionality
+#include <Memory/Thread.h>  // Event thread creation
 #include <Output/Error.h>   // Error reporting
 #include <Output/Warning.h>
+#include <Rendering/Buffer.h> // Buffer pools
 #include <Rendering/System.h>
 #include <XDGS/xdg-shell.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
 #include <string.h>
+#include <time.h>
 
 /**
  * @brief The application's display object.
@@ -32,6 +39,91 @@ static struct wl_compositor* compositor = NULL;
  */
 static struct wl_subcompositor* subcompositor = NULL;
 
+/**
+ * @brief The event queues that events are sorted into, so each can be
+ * dispatched by the thread that actually consumes it. Anything not on one
+ * of these (registry events and compositor pings) sits on the default
+ * queue and is dispatched by the event thread itself.
+ */
+static struct wl_event_queue* queues[event_queue_count] = {NULL};
+
+/**
+ * @brief The thread that reads every event off of the display's socket.
+ */
+static pthread_t event_thread;
+
+/**
+ * @brief Whether or not @ref event_thread is running.
+ */
+static bool event_thread_running = false;
+
+/**
+ * @brief The mutex guarding @ref event_reads.
+ */
+static pthread_mutex_t event_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Signalled by the event thread every time it reads new events off
+ * of the socket.
+ */
+static pthread_cond_t event_cond = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief The amount of times the event thread has read events. Consumers
+ * compare this against the last value they saw to tell if there's
+ * anything new for them.
+ */
+static uint64_t event_reads = 0;
+
+/**
+ * @brief The Wayland event thread. This never does any real work of its
+ * own, so compositor pings are answered no matter how long the game logic
+ * takes; it reads events into their queues, dispatches the default and
+ * frame queues, and wakes up the main thread for everything else.
+ * @param data Nothing of use.
+ * @return Nothing of use.
+ */
+static void* WaylandEventThread(void* data)
+{
+    SetZoneThreadName("wayland events");
+    struct pollfd display_fd = {wl_display_get_fd(display), POLLIN, 0};
+    while (running)
+    {
+        // Everything already sitting on the default queue has to be
+        // dispatched before we're allowed to read more.
+        while (wl_display_prepare_read(display) != 0)
+            if (wl_display_dispatch_pending(display) == -1)
+                ReportError(server_processing_failure);
+        wl_display_flush(display);
+
+        BeginZone("poll");
+        int ready = poll(&display_fd, 1, WAYLAND_POLL_TIMEOUT);
+        EndZone();
+        if (ready <= 0)
+        {
+            wl_display_cancel_read(display);
+            if (ready == -1 && errno != EINTR)
+                ReportError(server_processing_failure);
+            continue;
+        }
+
+        BeginZone("dispatch");
+        if (wl_display_read_events(display) == -1)
+            ReportError(server_processing_failure);
+        if (wl_display_dispatch_pending(display) == -1 ||
+            wl_display_dispatch_queue_pending(display,
+                                              queues[frame_queue]) == -1)
+            ReportError(server_processing_failure);
+        EndZone();
+
+        pthread_mutex_lock(&event_mutex);
+        event_reads++;
+        pthread_cond_broadcast(&event_cond);
+        pthread_mutex_unlock(&event_mutex);
+    }
+    return NULL;
+}
+
 /**
  * @brief Basically a big switch statement that binds whatever interface
  * Wayland throws at us, so long as we have need of it.
@@ -86,6 +178,11 @@ void SetupWayland(void)
     // Connect to the default Wayland compositor (Wayland-0).
     display = wl_display_connect(0);
     if (display == NULL) ReportError(display_connect_failure);
+    for (size_t i = 0; i < event_queue_count; i++)
+    {
+        queues[i] = wl_display_create_queue(display);
+        if (queues[i] == NULL) ReportError(allocation_failure);
+    }
     registry = wl_display_get_registry(display);
     wl_registry_add_listener(registry, &registry_listener, NULL);
 
@@ -95,15 +192,32 @@ void SetupWayland(void)
         ReportError(server_processing_failure);
 
     if (!full_device_suite) ReportError(compositor_missing_features);
+
+    // From here on, nothing but the event thread reads from the socket.
+    event_thread = CreateThread(WaylandEventThread, NULL);
+    event_thread_running = true;
 }
 
 void DestroyWayland(void)
 {
+    // The event thread notices the running flag within one poll timeout.
+    if (event_thread_running)
+    {
+        pthread_join(event_thread, NULL);
+        event_thread_running = false;
+    }
+
+    DestroyBufferPools();
     UnbindSHM(), UnbindInputGroup();
     UnbindWindowManager();
     wl_subcompositor_destroy(subcompositor);
     wl_compositor_destroy(compositor);
     wl_registry_destroy(registry);
+    for (size_t i = 0; i < event_queue_count; i++)
+    {
+        wl_event_queue_destroy(queues[i]);
+        queues[i] = NULL;
+    }
     wl_display_disconnect(display);
 
     devices.compositor = false;
@@ -112,10 +226,53 @@ void DestroyWayland(void)
 
 void CheckWayland(void)
 {
-    if (wl_display_dispatch(display) == -1)
+    static uint64_t reads_seen = 0;
+
+    // Sleep until the event thread has read something new, but wake up
+    // every so often regardless so the caller can check the running flag.
+    BeginZone("wait for events");
+    pthread_mutex_lock(&event_mutex);
+    if (event_reads == reads_seen)
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += WAYLAND_POLL_TIMEOUT * 1000000;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000;
+        deadline.tv_nsec %= 1000000000;
+        pthread_cond_timedwait(&event_cond, &event_mutex, &deadline);
+    }
+    reads_seen = event_reads;
+    pthread_mutex_unlock(&event_mutex);
+    EndZone();
+
+    BeginZone("dispatch");
+    DispatchEventQueue(window_queue);
+    DispatchEventQueue(input_queue);
+    // Anything the handlers sent back (configure acknowledgements, for
+    // one) should go out now, not on the event thread's next pass.
+    wl_display_flush(display);
+    EndZone();
+}
+
+void DispatchEventQueue(event_queue_t queue)
+{
+    if (wl_display_dispatch_queue_pending(display, queues[queue]) == -1)
         ReportError(server_processing_failure);
 }
 
+struct wl_event_queue* GetEventQueue(event_queue_t queue)
+{
+    return queues[queue];
+}
+
+void* WrapForEventQueue(void* proxy, event_queue_t queue)
+{
+    void* wrapper = wl_proxy_create_wrapper(proxy);
+    if (wrapper == NULL) ReportError(allocation_failure);
+    wl_proxy_set_queue(wrapper, queues[queue]);
+    return wrapper;
+}
+
 struct wl_surface* CreateSurface(void)
 {
     return wl_compositor_create_surface(compositor);
@@ -140,11 +297,25 @@ void DestroySubsurface(struct wl_subsurface** subsurface)
     subsurface = NULL;
 }
 
+void DesyncSubsurface(struct wl_subsurface* subsurface)
+{
+    wl_subsurface_set_desync(subsurface);
+}
+
 void CommitSurface(struct wl_surface* surface)
 {
     wl_surface_commit(surface);
 }
 
+void DamageSurfaceBuffer(struct wl_surface* surface, int32_t x, int32_t y,
+                         int32_t width, int32_t height)
+{
+    if (wl_proxy_get_version((struct wl_proxy*)surface) >=
+        WL_SURFACE_DAMAGE_BUFFER_SINCE_VERSION)
+        wl_surface_damage_buffer(surface, x, y, width, height);
+    else wl_surface_damage(surface, x, y, width, height);
+}
+
 void SetSubsurfacePosition(struct wl_subsurface* subsurface, int32_t x,
                            int32_t y)
 {
@@ -14,11 +14,47 @@
 
 #include <inttypes.h>
 
+/**
+ * @brief How long, in milliseconds, the Wayland event thread waits on the
+ * display before checking if the application's still running.
+ */
+#define WAYLAND_POLL_TIMEOUT 100
+
+/**
+ * @brief The event queues Wayland events are sorted into. Each is
+ * dispatched by the thread that consumes its events, so slow work on one
+ * never holds up another.
+ */
+typedef enum
+{
+    /**
+     * @brief Mouse and keyboard events. Dispatched by the main thread in
+     * @ref CheckWayland.
+     */
+    input_queue,
+    /**
+     * @brief XDG-shell configure and close events. Dispatched by the main
+     * thread in @ref CheckWayland.
+     */
+    window_queue,
+    /**
+     * @brief Frame callbacks. Dispatched by the event thread as soon as
+     * they're read, since all they do is wake up the rendering thread.
+     */
+    frame_queue,
+    /**
+     * @brief The amount of event queues. Not a queue.
+     */
+    event_queue_count
+} event_queue_t;
+
 /**
  * @brief A function to setup the Wayland server, the display environment
  * one used for the Linux distribution of Morningstar. This takes no
  * arguments and returns none, but creates, binds, and does the first poll
- * for the display interface and registry.
+ * for the display interface and registry. Afterward, it starts the
+ * Wayland event thread, which is the only thing to read from the display
+ * from then on.
  */
 void SetupWayland(void);
 
@@ -29,19 +65,60 @@ void SetupWayland(void);
 void DestroyWayland(void);
 
 /**
- * @brief Check to make sure the Wayland display server is still
- * sending/processing events. If the server is no longer processing
- * events, this function kills the process immediately with a code of
- * 8, figuring something must be wrong with the user's computer.
+ * @brief Wait for the event thread to read new events (or for @def
+ * WAYLAND_POLL_TIMEOUT to pass), then dispatch the window and input
+ * queues on the calling thread. If the server is no longer processing
+ * events, the fatal error @enum server_processing_failure is raised.
  */
 void CheckWayland(void);
 
+/**
+ * @brief Dispatch every event already read into the given queue, without
+ * blocking. The handlers run on the calling thread.
+ * @param queue The queue to dispatch.
+ */
+void DispatchEventQueue(event_queue_t queue);
+
+/**
+ * @brief Get the raw Wayland event queue behind one of our queues.
+ * @param queue The queue requested.
+ * @return The queue.
+ */
+struct wl_event_queue* GetEventQueue(event_queue_t queue);
+
+/**
+ * @brief Create a wrapper of the given proxy that places every object
+ * created through it onto the given queue. Doing this instead of moving
+ * the object afterward means no event can land on the wrong queue in
+ * between. The wrapper must be freed with @ref wl_proxy_wrapper_destroy.
+ * @param proxy The proxy to wrap.
+ * @param queue The queue objects created through the wrapper go to.
+ * @return The wrapper, which can be used in place of the proxy for
+ * requests.
+ */
+void* WrapForEventQueue(void* proxy, event_queue_t queue);
+
 struct wl_surface* CreateSurface(void);
 void DestroySurface(struct wl_surface** surface);
 struct wl_subsurface* CreateSubsurface(struct wl_surface** surface,
                                        struct wl_surface* parent);
 void DestroySubsurface(struct wl_subsurface** subsurface);
+void DesyncSubsurface(struct wl_subsurface* subsurface);
 void CommitSurface(struct wl_surface* surface);
+
+/**
+ * @brief Mark part of a surface's next buffer as damaged, so the
+ * compositor only has to recomposite that much of it. Compositors too old
+ * to take damage in buffer pixels are given it in surface pixels instead,
+ * which is the same thing for our unscaled surfaces.
+ * @param surface The surface.
+ * @param x The X position of the area's top-left corner.
+ * @param y The Y position of the area's top-left corner.
+ * @param width The width of the area.
+ * @param height The height of the area.
+ */
+void DamageSurfaceBuffer(struct wl_surface* surface, int32_t x, int32_t y,
+                         int32_t width, int32_t height);
 void SetSubsurfacePosition(struct wl_subsurface* subsurface, int32_t x,
                            int32_t y);
 
@@ -69,6 +69,36 @@ typedef enum
     center_filler
 } panel_type_t;
 
+/**
+ * @brief The amount of different panel types, and so the most panels a
+ * window is expected to hold.
+ */
+#define PANEL_TYPE_COUNT (center_filler + 1)
+
+/**
+ * @brief How often a panel is redrawn.
+ */
+typedef enum
+{
+    /**
+     * @brief The panel is redrawn whole every frame. This is the default
+     * for the center panel, which shows gameplay.
+     */
+    every_frame,
+    /**
+     * @brief The panel is redrawn whole a set amount of times a second,
+     * no matter how often frames are drawn. Anything marked in between
+     * waits for the next redraw.
+     */
+    fixed_rate,
+    /**
+     * @brief The panel is only redrawn when something marks it as
+     * damaged, or it's invalidated. This is the default for every panel
+     * but the center one.
+     */
+    on_demand
+} refresh_policy_t;
+
 /**
  * @brief A specific panel created to actually be rendered onto. Includes
  * vital information like width, height, x, y, type, along with pointers to
@@ -104,6 +134,22 @@ typedef struct
      * Changing this value will do nothing. It is simply here for reading.
      */
     int32_t y;
+    /**
+     * @brief How often the panel is redrawn. @note Change this with @ref
+     * SetPanelRefresh, not directly.
+     */
+    refresh_policy_t refresh;
+    /**
+     * @brief How many times a second the panel is redrawn, if its policy
+     * is @enum fixed_rate. @note Change this with @ref SetPanelRefresh,
+     * not directly.
+     */
+    uint32_t refresh_rate;
+    /**
+     * @brief When the panel was last drawn, in nanoseconds. @note There is
+     * no reason to edit this.
+     */
+    uint64_t _lr;
     /**
      * @brief The Wayland surface of the window. @note There is no
      * reason to edit this. Let functions help you.
@@ -132,7 +178,12 @@ typedef struct
 {
     const char* title;
     const char* id;
-    array_t panels;
+    /**
+     * @brief The window's panels, stored inline. Room is reserved for one
+     * of each panel type up front, and no more panels than that can be
+     * made, so panel pointers handed out to other threads never move.
+     */
+    flat_array_t panels;
 
     struct wl_surface* _s;
     struct xdg_surface* _ws;
@@ -3,15 +3,19 @@
 #include "Rendering/Colors.h"
 #include "Wayland.h" // Wayland wrappers
 #include "XDG.h"     // XDG wrappers
-#include <Globals.h> // Global flags
+#include <Diagnostic/Statistics.h> // Frame time summary
+#include <Diagnostic/Time.h>       // Thread and input zones
+#include <Diagnostic/Trace.h>      // Trace export
+#include <Globals.h>               // Global flags
 #include <Memory/Thread.h>
 #include <Output/System.h> // Output functions
+#include <Rendering/Frame.h>
 #include <Rendering/Loop.h>
 #include <Rendering/System.h> // EGL wrappers
 #include <pthread.h>
 #include <stdio.h>
 
-static window_t window = {NULL, NULL, {NULL, 0, 0}, NULL, NULL};
+static window_t window = {NULL, NULL, {{NULL, 0}, 0, 0, 0}, NULL, NULL};
 
 void SetupWindow(void) { SetupWayland(), SetupEGL(); }
 
@@ -37,7 +41,7 @@ void CreateWindow(const char* window_title)
 
 panel_t* GetPanel(size_t index)
 {
-    return (panel_t*)(window.panels._a[index]._p);
+    return GetFlatArrayValue(window.panels, index);
 }
 
 void IteratePanels(void (*func)(panel_t* panel, size_t panel_index))
@@ -54,22 +58,30 @@ void DestroyWindow(void)
         return;
     }
 
-    if (CheckArrayValidity(window.panels))
+    if (!CheckFlatArrayValidity(window.panels))
     {
         ReportWarning(preemptive_panel_free);
         return;
     }
 
+    // The rendering thread has to let go of the panels' contexts before we
+    // can tear them down.
+    DestroyRenderingThread();
+    ReportFrameStatistics();
+    // Every thread but this one and the event thread is done by now, so
+    // the trace has nearly everything the run did.
+    WriteTrace();
+
     for (size_t i = 0; i < window.panels.occupied; i++)
     {
         panel_t* panel = GetPanel(i);
-        if (panel->_s != NULL && panel->_ss != NULL) continue;
+        if (panel->_s == NULL || panel->_ss == NULL) continue;
 
-        DestroySurface(&panel->_s);
-        DestroySubsurface(&panel->_ss);
         UnbindEGLContext(panel, i);
+        DestroySubsurface(&panel->_ss);
+        DestroySurface(&panel->_s);
     }
-    DestroyArray(&window.panels);
+    DestroyFlatArray(&window.panels);
 
     UnwrapWindow(&window);
     DestroySurface(&window._s);
@@ -89,10 +101,13 @@ static bool dims_recorded = false;
 static void* PanelDimensionListener(void* index)
 {
     size_t index_value = *(size_t*)index;
+    SetZoneThreadName("panel listener");
 
-    pthread_mutex_lock(&panel_mutex);
+    BeginZone("wait for dimensions");
+    LockMutex(&panel_mutex, "panel lock");
     while (!dimensions.set)
         pthread_cond_wait(&panel_dim_cond, &panel_mutex);
+    EndZone();
 
     panel_t* affected = GetPanel(index_value);
 
@@ -111,6 +126,7 @@ static void* PanelDimensionListener(void* index)
     }
     SetSubsurfacePosition(affected->_ss, affected->x, affected->y);
     ResizeEGLRenderingArea(affected);
+    RequestFrame();
 
     pthread_mutex_unlock(&panel_mutex);
 
@@ -144,20 +160,30 @@ panel_t* CreatePanel(panel_type_t type)
         return NULL;
     }
 
-    if (!CheckArrayValidity(window.panels))
+    if (!CheckFlatArrayValidity(window.panels))
     {
         ReportWarning(implicit_panel_array_creation);
-        window.panels = CreateArray(1);
+        window.panels = CreateFlatArray(sizeof(panel_t), PANEL_TYPE_COUNT);
+    }
+
+    // Panels live inline in the array, and other threads hold onto their
+    // pointers; growing the array past what was reserved would move them
+    // all out from under those threads.
+    if (window.panels.occupied >= PANEL_TYPE_COUNT)
+    {
+        ReportWarning(excess_panel_creation);
+        return NULL;
     }
 
     panel_t created_panel = {
         .type = type,
+        .refresh = type == center_filler ? every_frame : on_demand,
         ._s = CreateSurface(),
         ._ss = CreateSubsurface(&created_panel._s, window._s)};
-    ptr_t panel_block = AllocateBlock(sizeof(panel_t));
-    SetBlockContents(&panel_block, &created_panel, sizeof(panel_t));
-    AddArrayValue(&window.panels, panel_block);
-    FreeBlock(&panel_block);
+    // Panels are presented on their own schedule, so their commits can't
+    // wait on the parent surface's.
+    DesyncSubsurface(created_panel._ss);
+    AddFlatArrayValue(&window.panels, &created_panel);
 
     size_t panel_index = window.panels.occupied - 1;
     CreateThread(PanelDimensionListener, &panel_index);
@@ -176,10 +202,11 @@ void WaitForDimensionSignal_(pthread_mutex_t* mutex)
 
 void run(void)
 {
-    while (running)
-    {
-        CheckWayland();
-        TriggerRender();
-        // do all the funny stuff
-    }
+    // Rendering is paced by frame callbacks on the Wayland event thread,
+    // and game logic by the simulation thread's ticks; all this thread
+    // does is handle window and input events as the event thread reads
+    // them in. Input is only queued here, and handed to the game at the
+    // start of the next tick.
+    SetZoneThreadName("main");
+    while (running) CheckWayland();
 }
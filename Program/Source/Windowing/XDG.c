@@ -15,6 +15,13 @@
  */
 static struct xdg_wm_base* base = NULL;
 
+/**
+ * @brief A wrapper of @ref base that places the windows created through
+ * it onto the window event queue. The base itself stays on the default
+ * queue, so pings are answered by the event thread directly.
+ */
+static struct xdg_wm_base* base_wrapper = NULL;
+
 /**
  * @brief The toplevel window of the application.
  */
@@ -136,12 +143,15 @@ void BindWindowManager(uint32_t name, uint32_t version)
     base = wl_registry_bind(GetRegistry(), name, &xdg_wm_base_interface,
                             version);
     xdg_wm_base_add_listener(base, &ponger, NULL);
+    base_wrapper = WrapForEventQueue(base, window_queue);
     devices.window_manager = true;
 }
 
 void UnbindWindowManager(void)
 {
+    wl_proxy_wrapper_destroy(base_wrapper);
     xdg_wm_base_destroy(base);
+    base_wrapper = NULL;
     devices.window_manager = false;
 }
 
@@ -149,7 +159,7 @@ struct xdg_surface* WrapRawWindow(struct wl_surface* raw_window,
                                   const char* title)
 {
     struct xdg_surface* window =
-        xdg_wm_base_get_xdg_surface(base, raw_window);
+        xdg_wm_base_get_xdg_surface(base_wrapper, raw_window);
     xdg_surface_add_listener(window, &surface_listener, NULL);
 
     toplevel = xdg_surface_get_toplevel(window);